@@ -0,0 +1,322 @@
+// Asset loading microbenchmark, each stage of the load path timed in isolation over the scene's
+// real assets (run from the repository root):
+//   loader_bench [--trials N] [--warmup N] [--out file.json] [--filter text] [file ...]
+// Stages of a model (.obj/.fbx/...):
+//   import    Assimp::Importer::ReadFile with Model::IMPORT_FLAGS
+//   convert   Model::ConvertMesh over the node tree, what processNode/processMesh do before the upload
+//   meshlets  rg::buildMeshlets over the converted meshes, what the Mesh constructor does first
+//   upload    the Mesh constructors given those meshlets (VAO, VBO and EBO), followed by glFinish
+// Stages of a texture (.jpg/.jpeg/.png):
+//   decode    stbi_load
+//   upload    glTexImage2D, followed by glFinish
+//   mipmaps   glGenerateMipmap, followed by glFinish
+// The GL stages run on the surfaceless EGL context of the --bench mode. Files given on the command
+// line replace the default asset list.
+#include <glad/glad.h>
+
+#include <learnopengl/model.h>
+#include <rg/Benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// the files SceneAssets loads
+const char *defaultModels[] = {
+        "resources/objects/circus_bear/14089_Circus_Bear_Standing_on_large_ball_v1_l2.obj",
+        "resources/objects/tube/tube.obj",
+        "resources/objects/platform/Rotating_Light_Platform_Final.fbx",
+        "resources/objects/seesaw/10547_Childrens_Seesaw_v2-L3.obj",
+        "resources/objects/flower/12974_crocus_flower_v1_l3.obj",
+        "resources/objects/lamp/Euro Spot LED czarny 1f.obj",
+        "resources/objects/circle-obj/circle.obj"
+};
+
+const char *defaultTextures[] = {
+        "resources/objects/circus_bear/14089_Circus_bear_standing_on_large_ball_diffuse.jpg",
+        "resources/objects/platform/lambert1_metallic.jpg",
+        "resources/objects/platform/lambert1_normal.png",
+        "resources/objects/seesaw/seesaw.jpg",
+        "resources/objects/lamp/metal.jpg",
+        "resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture.jpg",
+        "resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_NORMAL.jpg",
+        "resources/textures/window.png",
+        "resources/textures/skybox/right.png"
+};
+
+struct Options {
+    int trials = 10;
+    int warmup = 1;
+    std::string output = "loader_bench.json";
+    std::string filter;
+    std::vector<std::string> files;
+};
+
+// the timings of one stage of one asset
+struct StageTimes {
+    std::string asset;
+    std::string stage;
+    std::string detail;   // size of the asset, e.g. vertex count or texture dimensions
+    std::vector<double> milliseconds;
+
+    StageTimes(const std::string& asset, const char *stage) : asset(asset), stage(stage) {}
+};
+
+struct Summary {
+    double min, p50, mean, p95, max, stddev;
+};
+
+double milliseconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// nearest rank percentile, like rg::BenchmarkRecorder
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::ceil(p / 100.0 * (double)sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+Summary summarize(std::vector<double> values) {
+    Summary summary = {};
+    if (values.empty())
+        return summary;
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    summary.mean = sum / (double)values.size();
+    double variance = 0.0;
+    for (double value : values)
+        variance += (value - summary.mean) * (value - summary.mean);
+    summary.stddev = values.size() > 1 ? std::sqrt(variance / (double)(values.size() - 1)) : 0.0;
+    summary.min = values.front();
+    summary.max = values.back();
+    summary.p50 = percentile(values, 50.0);
+    summary.p95 = percentile(values, 95.0);
+    return summary;
+}
+
+bool isTexture(const std::string& path) {
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "jpg" || extension == "jpeg" || extension == "png";
+}
+
+void convertNode(const aiNode *node, const aiScene *scene, std::vector<std::vector<Vertex>>& vertices,
+                 std::vector<std::vector<unsigned int>>& indices) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        vertices.emplace_back();
+        indices.emplace_back();
+        Model::ConvertMesh(scene->mMeshes[node->mMeshes[i]], vertices.back(), indices.back());
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        convertNode(node->mChildren[i], scene, vertices, indices);
+}
+
+bool benchmarkModel(const std::string& path, const Options& options, std::vector<StageTimes>& results) {
+    StageTimes import(path, "import"), convert(path, "convert"), meshlets(path, "meshlets"), upload(path, "upload");
+    for (int trial = 0; trial < options.warmup + options.trials; trial++) {
+        bool measured = trial >= options.warmup;
+
+        Assimp::Importer importer;
+        Clock::time_point importStart = Clock::now();
+        const aiScene *scene = importer.ReadFile(path, Model::IMPORT_FLAGS);
+        Clock::time_point imported = Clock::now();
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+            std::cout << "ERROR::LOADER_BENCH:: " << path << ": " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+
+        std::vector<std::vector<Vertex>> vertices;
+        std::vector<std::vector<unsigned int>> indices;
+        Clock::time_point convertStart = Clock::now();
+        convertNode(scene->mRootNode, scene, vertices, indices);
+        Clock::time_point converted = Clock::now();
+
+        std::vector<rg::MeshletSet> meshletSets(vertices.size());
+        Clock::time_point meshletStart = Clock::now();
+        for (size_t i = 0; i < vertices.size(); i++)
+            if (!vertices[i].empty() && !indices[i].empty())
+                meshletSets[i] = rg::buildMeshlets(vertices[i], indices[i]);
+        Clock::time_point meshletsBuilt = Clock::now();
+
+        std::vector<Mesh> meshes;
+        meshes.reserve(vertices.size());
+        Clock::time_point uploadStart = Clock::now();
+        for (size_t i = 0; i < vertices.size(); i++)
+            if (!vertices[i].empty() && !indices[i].empty())
+                meshes.emplace_back(vertices[i], indices[i], std::vector<Texture>(), meshletSets[i]);
+        glFinish();
+        Clock::time_point uploaded = Clock::now();
+        for (Mesh& mesh : meshes)
+            mesh.Release();
+
+        if (!measured)
+            continue;
+        import.milliseconds.push_back(milliseconds(importStart, imported));
+        convert.milliseconds.push_back(milliseconds(convertStart, converted));
+        meshlets.milliseconds.push_back(milliseconds(meshletStart, meshletsBuilt));
+        upload.milliseconds.push_back(milliseconds(uploadStart, uploaded));
+        if (import.detail.empty()) {
+            size_t vertexCount = 0, indexCount = 0;
+            for (size_t i = 0; i < vertices.size(); i++) {
+                vertexCount += vertices[i].size();
+                indexCount += indices[i].size();
+            }
+            import.detail = std::to_string(scene->mNumMeshes) + " meshes";
+            convert.detail = std::to_string(vertexCount) + " vertices";
+            size_t meshletCount = 0;
+            for (const rg::MeshletSet& set : meshletSets)
+                meshletCount += set.count;
+            meshlets.detail = std::to_string(meshletCount) + " meshlets";
+            upload.detail = std::to_string((vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int)) / 1024) + " KiB";
+        }
+    }
+    results.push_back(import);
+    results.push_back(convert);
+    results.push_back(meshlets);
+    results.push_back(upload);
+    return true;
+}
+
+bool benchmarkTexture(const std::string& path, const Options& options, std::vector<StageTimes>& results) {
+    StageTimes decode(path, "decode"), upload(path, "upload"), mipmaps(path, "mipmaps");
+    for (int trial = 0; trial < options.warmup + options.trials; trial++) {
+        bool measured = trial >= options.warmup;
+
+        int width, height, components;
+        Clock::time_point start = Clock::now();
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 0);
+        Clock::time_point decoded = Clock::now();
+        if (!data) {
+            std::cout << "ERROR::LOADER_BENCH:: " << path << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+        GLenum format = components == 1 ? GL_RED : components == 3 ? GL_RGB : GL_RGBA;
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        // rows of 1 and 3 component images are not 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        Clock::time_point uploadStart = Clock::now();
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glFinish();
+        Clock::time_point uploaded = Clock::now();
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+        Clock::time_point mipmapped = Clock::now();
+        glDeleteTextures(1, &texture);
+        stbi_image_free(data);
+
+        if (!measured)
+            continue;
+        decode.milliseconds.push_back(milliseconds(start, decoded));
+        upload.milliseconds.push_back(milliseconds(uploadStart, uploaded));
+        mipmaps.milliseconds.push_back(milliseconds(uploaded, mipmapped));
+        if (decode.detail.empty()) {
+            decode.detail = std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(components);
+            upload.detail = std::to_string(width * height * components / 1024) + " KiB";
+            mipmaps.detail = decode.detail;
+        }
+    }
+    results.push_back(decode);
+    results.push_back(upload);
+    results.push_back(mipmaps);
+    return true;
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trials" && hasValue)
+            options.trials = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--out" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            options.filter = argv[++i];
+        else if (arg.compare(0, 2, "--") == 0)
+            std::cout << "WARNING::LOADER_BENCH:: unknown argument " << arg << std::endl;
+        else
+            options.files.push_back(arg);
+    }
+    if (options.files.empty()) {
+        options.files.assign(std::begin(defaultModels), std::end(defaultModels));
+        options.files.insert(options.files.end(), std::begin(defaultTextures), std::end(defaultTextures));
+    }
+    return options;
+}
+
+void printResults(const std::vector<StageTimes>& results) {
+    std::printf("%-48s %-8s %10s %10s %10s %10s %10s  %s\n", "asset", "stage", "min ms", "p50 ms", "mean ms",
+                "p95 ms", "stddev", "size");
+    for (const StageTimes& times : results) {
+        Summary s = summarize(times.milliseconds);
+        // the end of long paths is the informative part
+        std::string asset = times.asset.size() > 48 ? "..." + times.asset.substr(times.asset.size() - 45) : times.asset;
+        std::printf("%-48s %-8s %10.3f %10.3f %10.3f %10.3f %10.3f  %s\n", asset.c_str(), times.stage.c_str(),
+                    s.min, s.p50, s.mean, s.p95, s.stddev, times.detail.c_str());
+    }
+}
+
+bool writeJson(const std::string& path, const Options& options, const std::vector<StageTimes>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "ERROR::LOADER_BENCH:: could not write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"trials\": " << options.trials << ",\n  \"warmup\": " << options.warmup
+        << ",\n  \"gl_renderer\": \"" << rg::jsonEscape((const char *) glGetString(GL_RENDERER)) << "\",\n  \"stages\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const StageTimes& times = results[i];
+        Summary s = summarize(times.milliseconds);
+        out << "    { \"asset\": \"" << rg::jsonEscape(times.asset) << "\", \"stage\": \"" << rg::jsonEscape(times.stage)
+            << "\", \"size\": \"" << rg::jsonEscape(times.detail) << "\", \"min\": " << s.min << ", \"p50\": " << s.p50
+            << ", \"mean\": " << s.mean << ", \"p95\": " << s.p95 << ", \"max\": " << s.max << ", \"stddev\": " << s.stddev << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options options = parseOptions(argc, argv);
+    rg::HeadlessContext context;
+    if (!context.Create(3, 3))
+        return -1;
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    stbi_set_flip_vertically_on_load(false);
+
+    std::vector<StageTimes> results;
+    bool failed = false;
+    for (const std::string& file : options.files) {
+        if (!options.filter.empty() && file.find(options.filter) == std::string::npos)
+            continue;
+        std::cout << "LOADER_BENCH:: " << file << std::endl;
+        bool ok = isTexture(file) ? benchmarkTexture(file, options, results) : benchmarkModel(file, options, results);
+        failed = failed || !ok;
+    }
+
+    printResults(results);
+    if (!writeJson(options.output, options, results))
+        return -1;
+    return failed ? 1 : 0;
+}
@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/Meshlets.h>
 
 #include <string>
 #include <vector>
@@ -39,6 +40,8 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // clusters of the triangles, `indices` is ordered by them
+    rg::MeshletSet       meshlets;
 
     unsigned int VAO;
     std::string glslIdentifierPrefix;
@@ -48,11 +51,23 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        meshlets = rg::buildMeshlets(this->vertices, this->indices);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
+    // with meshlets already built by rg::buildMeshlets, which `indices` must have been reordered by
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, rg::MeshletSet meshlets)
+    {
+        this->vertices = vertices;
+        this->indices = indices;
+        this->textures = textures;
+        this->meshlets = meshlets;
+
+        setupMesh();
+    }
+
     // render the mesh
     void Draw(Shader &shader)
     {
@@ -93,6 +108,15 @@ public:
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // deletes the GL objects, the mesh is not drawable afterwards
+    void Release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
 private:
     // render data
     unsigned int VBO, EBO;
@@ -0,0 +1,59 @@
+#ifndef PROJECT_BASE_ALLOCTRACKER_H
+#define PROJECT_BASE_ALLOCTRACKER_H
+
+// Heap allocation instrumentation, only built with RG_ALLOC_TRACKER defined (the RG_ALLOC_TRACKER
+// CMake option). src/AllocTracker.cpp then replaces the global operator new/delete and, with glibc,
+// interposes malloc/calloc/realloc/free, counting every allocation of the process:
+//   - totals, per frame (FrameMark) and per thread, the latter is what the profiler zones record
+//   - call sites of every SampleInterval()-th allocation, printed with PrintCallSites
+//   - steady state assertion: after ExpectNoAllocationsFrom(frame) the first frame that allocates
+//     prints its call sites and aborts
+// A realloc counts as an allocation and a free only when it moves the block. aligned_alloc,
+// posix_memalign and memalign are not counted.
+
+#include <cstdint>
+
+namespace rg {
+
+// also defined without RG_ALLOC_TRACKER so that code storing counters needs no #ifdef
+struct AllocationCounters {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+}
+
+#ifdef RG_ALLOC_TRACKER
+
+namespace rg {
+
+class AllocTracker {
+public:
+    // allocations of the whole process since startup
+    static AllocationCounters Totals();
+    // allocations made by the calling thread since it started
+    static AllocationCounters ThreadTotals();
+
+    // ends the current frame, once per frame on the main thread
+    static void FrameMark();
+    static AllocationCounters LastFrame();
+    static uint64_t FrameIndex();
+
+    // 1 records the call site of every allocation, 0 turns sampling off
+    static void SetSampleInterval(uint32_t interval);
+    static uint32_t SampleInterval();
+    // prints the most frequent sampled call sites to stdout
+    static void PrintCallSites(int maxSites = 10);
+    static void ClearCallSites();
+
+    // frames from `frame` on (as counted by FrameMark) must not allocate, UINT64_MAX disables
+    static void ExpectNoAllocationsFrom(uint64_t frame);
+    static bool ExpectingNoAllocations();
+};
+
+}
+
+#endif
+
+#endif //PROJECT_BASE_ALLOCTRACKER_H
@@ -0,0 +1,382 @@
+#ifndef PROJECT_BASE_BENCHMARK_H
+#define PROJECT_BASE_BENCHMARK_H
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/glm.hpp>
+
+#include <rg/StressScene.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Command line of the headless benchmark:
+//   project_base --bench [--frames N] [--warmup N] [--size WxH] [--out file.json]
+//                        [--lights N] [--deferred] [--prepass] [--stats-csv file.csv]
+//                        [--alloc-assert] [--replay file.rgin] [--no-meshlet-culling]
+//                        [--no-occlusion-culling]
+// and, with or without --bench:
+//   --record file.rgin    records the input of the session
+//   --replay file.rgin    plays a recorded session back instead of live input (and the camera path)
+//   --stress-models N --stress-windows M --stress-lights K [--stress-seed S] [--stress-extent R]
+//                         adds N copies of every model, M panes and K lights (rg::StressScene)
+//   --scene file.scene    props, windows and lights to load instead of resources/scenes/arena.scene
+//                         (a text source or its compiled .rgscene, rg::MappedScene)
+//   --jobs N              threads of the job system including the main thread, 0 (default) for all cores
+//   --pipelined           renders on a thread of its own while the main thread simulates the next frame
+//                         (windowed only, the GUI falls back to one thread)
+//   --gpu-driven          asks for a GL 4.3 context and draws the model entities with GPU culling and
+//                         multi-draw-indirect (rg::GpuDrivenScene)
+struct BenchmarkOptions {
+    bool enabled = false;
+    int frames = 600;
+    int warmupFrames = 30;
+    int width = 1920;
+    int height = 1080;
+    std::string output = "benchmark.json";
+    int extraLights = 0;
+    bool deferredShading = false;
+    bool depthPrepass = false;
+    bool meshletCulling = true;
+    bool occlusionCulling = true;
+    std::string statsCsv;   // per-frame draw/state counters, not written when empty
+    bool allocAssert = false;  // abort if a frame after the warm-up allocates (RG_ALLOC_TRACKER builds)
+    std::string recordPath;
+    std::string replayPath;
+    StressSceneOptions stress;
+    std::string scenePath = "resources/scenes/arena.scene";
+    int jobThreads = 0;
+    bool pipelined = false;
+    bool gpuDriven = false;
+};
+
+inline BenchmarkOptions parseBenchmarkOptions(int argc, char **argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--bench")
+            options.enabled = true;
+        else if (arg == "--frames" && hasValue)
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmupFrames = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if (x != std::string::npos) {
+                options.width = std::max(1, std::atoi(size.substr(0, x).c_str()));
+                options.height = std::max(1, std::atoi(size.substr(x + 1).c_str()));
+            }
+        }
+        else if (arg == "--out" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--lights" && hasValue)
+            options.extraLights = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--deferred")
+            options.deferredShading = true;
+        else if (arg == "--prepass")
+            options.depthPrepass = true;
+        else if (arg == "--no-meshlet-culling")
+            options.meshletCulling = false;
+        else if (arg == "--no-occlusion-culling")
+            options.occlusionCulling = false;
+        else if (arg == "--stats-csv" && hasValue)
+            options.statsCsv = argv[++i];
+        else if (arg == "--alloc-assert")
+            options.allocAssert = true;
+        else if (arg == "--record" && hasValue)
+            options.recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            options.replayPath = argv[++i];
+        else if (arg == "--stress-models" && hasValue)
+            options.stress.models = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--stress-windows" && hasValue)
+            options.stress.windows = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--stress-lights" && hasValue)
+            options.stress.lights = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--stress-seed" && hasValue)
+            options.stress.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--stress-extent" && hasValue)
+            options.stress.extent = std::max(1.0f, (float)std::atof(argv[++i]));
+        else if (arg == "--scene" && hasValue)
+            options.scenePath = argv[++i];
+        else if (arg == "--jobs" && hasValue)
+            options.jobThreads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--pipelined")
+            options.pipelined = true;
+        else if (arg == "--gpu-driven")
+            options.gpuDriven = true;
+        else
+            std::cout << "WARNING::BENCHMARK:: unknown argument " << arg << std::endl;
+    }
+    return options;
+}
+
+// OpenGL core context without any window system. Uses Mesa's surfaceless platform when it is
+// available (runs on llvmpipe without a GPU or X server) and the default display otherwise;
+// rendering goes into framebuffer objects only.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+
+    ~HeadlessContext()
+    {
+        if (display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool Create(int major, int minor)
+    {
+        const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint eglMajor, eglMinor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+            std::cout << "ERROR::HEADLESS:: could not initialize an EGL display" << std::endl;
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "ERROR::HEADLESS:: EGL display has no desktop OpenGL" << std::endl;
+            return false;
+        }
+
+        // surfaceless contexts do not need a config when EGL_KHR_no_config_context is present
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        const char *displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!displayExtensions || !std::strstr(displayExtensions, "EGL_KHR_no_config_context")) {
+            const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+            EGLint configCount = 0;
+            if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+                std::cout << "ERROR::HEADLESS:: no EGL config for OpenGL" << std::endl;
+                return false;
+            }
+        }
+
+        const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, major,
+                EGL_CONTEXT_MINOR_VERSION, minor,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            std::cout << "ERROR::HEADLESS:: could not create an OpenGL " << major << "." << minor
+                      << " core context" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+// Closed Catmull-Rom spline through camera positions and look-at targets, sampled with t in [0, 1).
+class CameraSpline {
+public:
+    void AddPoint(const glm::vec3& position, const glm::vec3& target)
+    {
+        positions.push_back(position);
+        targets.push_back(target);
+    }
+
+    void Sample(float t, glm::vec3& position, glm::vec3& target) const
+    {
+        int count = (int)positions.size();
+        float segment = (t - std::floor(t)) * (float)count;
+        int i = std::min((int)segment, count - 1);
+        float u = segment - (float)i;
+        position = catmullRom(positions, i, u);
+        target = catmullRom(targets, i, u);
+    }
+
+private:
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> targets;
+
+    static glm::vec3 catmullRom(const std::vector<glm::vec3>& points, int i, float u)
+    {
+        int count = (int)points.size();
+        const glm::vec3& p0 = points[(i + count - 1) % count];
+        const glm::vec3& p1 = points[i];
+        const glm::vec3& p2 = points[(i + 1) % count];
+        const glm::vec3& p3 = points[(i + 2) % count];
+        float u2 = u * u;
+        float u3 = u2 * u;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+};
+
+// `text` as the contents of a JSON string: quotes, backslashes and control characters escaped
+inline std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char)c < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+// Collects per frame CPU, GPU and wall clock times of the measured frames and writes the
+// percentiles as JSON. Every frame ends with glFinish, standing in for the buffer swap, so the GPU
+// timestamps of the frame can be read back right away. Timestamps are used instead of a
+// GL_TIME_ELAPSED query because the renderer times its own passes with those and they cannot nest.
+class BenchmarkRecorder {
+public:
+    double startupMilliseconds = 0.0;
+
+    explicit BenchmarkRecorder(int warmupFrames)
+        : warmupFrames(warmupFrames)
+    {
+        glGenQueries(2, gpuQueries);
+    }
+
+    ~BenchmarkRecorder()
+    {
+        glDeleteQueries(2, gpuQueries);
+    }
+
+    BenchmarkRecorder(const BenchmarkRecorder&) = delete;
+    BenchmarkRecorder& operator=(const BenchmarkRecorder&) = delete;
+
+    void BeginFrame()
+    {
+        frameStart = Clock::now();
+        glQueryCounter(gpuQueries[0], GL_TIMESTAMP);
+    }
+
+    void EndFrame(unsigned long long drawCalls)
+    {
+        glQueryCounter(gpuQueries[1], GL_TIMESTAMP);
+        Clock::time_point submitted = Clock::now();
+        glFinish();
+        Clock::time_point finished = Clock::now();
+
+        if (frameIndex++ < warmupFrames)
+            return;
+        GLuint64 gpuBegin = 0, gpuEnd = 0;
+        glGetQueryObjectui64v(gpuQueries[0], GL_QUERY_RESULT, &gpuBegin);
+        glGetQueryObjectui64v(gpuQueries[1], GL_QUERY_RESULT, &gpuEnd);
+        cpuTimes.push_back(milliseconds(frameStart, submitted));
+        frameTimes.push_back(milliseconds(frameStart, finished));
+        gpuTimes.push_back((double)(gpuEnd - gpuBegin) / 1.0e6);
+        draws.push_back((double)drawCalls);
+    }
+
+    // `info` is written as extra string fields describing the run (renderer, light count, ...)
+    bool WriteJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& info) const
+    {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::BENCHMARK:: could not write " << path << std::endl;
+            return false;
+        }
+        out << "{\n";
+        for (const auto& field : info)
+            out << "  \"" << jsonEscape(field.first) << "\": \"" << jsonEscape(field.second) << "\",\n";
+        out << "  \"frames\": " << frameTimes.size() << ",\n";
+        out << "  \"warmup_frames\": " << warmupFrames << ",\n";
+        out << "  \"startup_ms\": " << startupMilliseconds << ",\n";
+        writeSeries(out, "cpu_ms", cpuTimes);
+        out << ",\n";
+        writeSeries(out, "gpu_ms", gpuTimes);
+        out << ",\n";
+        writeSeries(out, "frame_ms", frameTimes);
+        out << ",\n";
+        writeSeries(out, "draw_calls", draws);
+        out << "\n}\n";
+        return true;
+    }
+
+    void PrintSummary() const
+    {
+        std::cout << "frames: " << frameTimes.size() << ", startup: " << startupMilliseconds << " ms\n"
+                  << "cpu   p50 " << percentile(cpuTimes, 50.0) << " ms, p95 " << percentile(cpuTimes, 95.0)
+                  << " ms, p99 " << percentile(cpuTimes, 99.0) << " ms\n"
+                  << "gpu   p50 " << percentile(gpuTimes, 50.0) << " ms, p95 " << percentile(gpuTimes, 95.0)
+                  << " ms, p99 " << percentile(gpuTimes, 99.0) << " ms\n"
+                  << "frame p50 " << percentile(frameTimes, 50.0) << " ms, p95 " << percentile(frameTimes, 95.0)
+                  << " ms, p99 " << percentile(frameTimes, 99.0) << " ms\n"
+                  << "draw calls per frame p50 " << percentile(draws, 50.0) << std::endl;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int warmupFrames;
+    int frameIndex = 0;
+    GLuint gpuQueries[2];
+    Clock::time_point frameStart;
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    std::vector<double> frameTimes;
+    std::vector<double> draws;
+
+    static double milliseconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    // nearest rank percentile
+    static double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t rank = (size_t)std::ceil(p / 100.0 * (double)values.size());
+        return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    static void writeSeries(std::ofstream& out, const char *name, const std::vector<double>& values)
+    {
+        double sum = 0.0;
+        double maximum = 0.0;
+        for (double value : values) {
+            sum += value;
+            maximum = std::max(maximum, value);
+        }
+        out << "  \"" << name << "\": { \"mean\": " << (values.empty() ? 0.0 : sum / (double)values.size())
+            << ", \"p50\": " << percentile(values, 50.0) << ", \"p95\": " << percentile(values, 95.0)
+            << ", \"p99\": " << percentile(values, 99.0) << ", \"max\": " << maximum << " }";
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_BENCHMARK_H
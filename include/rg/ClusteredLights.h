@@ -0,0 +1,366 @@
+#ifndef PROJECT_BASE_CLUSTEREDLIGHTS_H
+#define PROJECT_BASE_CLUSTEREDLIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/JobSystem.h>
+#include <rg/Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace rg {
+
+// Light types as stored in LightData::type (must match rb_bear_shader.fs)
+const float LIGHT_TYPE_POINT = 0.0f;
+const float LIGHT_TYPE_SPOT  = 1.0f;
+
+// One light as it is laid out in the light texture buffer: six RGBA32F texels per light.
+// shadowTile is the light's tile in rg::SpotShadowAtlas, or -1 for lights without a shadow.
+struct LightData {
+    glm::vec3 position;  float type;
+    glm::vec3 direction; float cutOff;
+    glm::vec3 ambient;   float outerCutOff;
+    glm::vec3 diffuse;   float constant;
+    glm::vec3 specular;  float linear;
+    float quadratic;     float range;     float shadowTile; float pad;
+};
+static_assert(sizeof(LightData) == 6 * 4 * sizeof(float), "LightData must be six vec4 texels");
+
+const int LIGHT_DATA_TEXELS = sizeof(LightData) / (4 * sizeof(float));
+
+// Distance at which constant/linear/quadratic attenuation drops the strongest colour channel
+// below `threshold`. Used as the light's culling radius.
+inline float attenuationRange(float constant, float linear, float quadratic, float maxChannel, float threshold = 5.0f / 256.0f) {
+    float target = maxChannel / threshold;
+    if (target <= constant)
+        return 0.0f;
+    if (quadratic <= 0.0f)
+        return linear > 0.0f ? (target - constant) / linear : 1e30f;
+    float disc = linear * linear - 4.0f * quadratic * (constant - target);
+    return (-linear + std::sqrt(disc)) / (2.0f * quadratic);
+}
+
+// Bounding sphere of a light's lit volume: a sphere of `range` for point lights and the
+// tightest sphere around the outer cone for spotlights.
+inline glm::vec4 lightBoundingSphere(const LightData& light) {
+    if (light.type != LIGHT_TYPE_SPOT)
+        return glm::vec4(light.position, light.range);
+
+    float cosAngle = light.outerCutOff;
+    float h = light.range;
+    if (cosAngle < 0.70710678f) {
+        float sinAngle = std::sqrt(std::max(0.0f, 1.0f - cosAngle * cosAngle));
+        return glm::vec4(light.position + light.direction * (h * cosAngle), h * sinAngle);
+    }
+    float radius = h / (2.0f * cosAngle);
+    return glm::vec4(light.position + light.direction * radius, radius);
+}
+
+// Clustered forward light binning. The view frustum is split into a froxel grid (screen tiles x
+// exponential depth slices); every frame the lights are assigned to the froxels they touch on the
+// CPU and the result is uploaded into three texture buffers:
+//   lightData    - RGBA32F, LIGHT_DATA_TEXELS texels per light
+//   clusterGrid  - RG32UI,  (offset, count) into lightIndices per froxel
+//   lightIndices - R32UI,   light indices grouped per froxel
+// so the fragment shader only walks the lights of its own froxel.
+class ClusteredLights {
+public:
+    static const int TILES_X = 16;
+    static const int TILES_Y = 9;
+    static const int SLICES = 24;
+    static const int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+    static const int MAX_LIGHTS_PER_CLUSTER = 128;
+    // below this many lights the binning is not worth spreading across threads
+    static const int PARALLEL_LIGHT_THRESHOLD = 32;
+
+    // statistics of the last build
+    unsigned int lightCount = 0;
+    unsigned int indexCount = 0;
+    unsigned int maxLightsInCluster = 0;
+    unsigned int droppedLights = 0;
+
+    ClusteredLights()
+    {
+        static_assert(TILES_X % 4 == 0, "tiles along x are tested four at a time");
+        clusterLightCounts.resize(CLUSTER_COUNT);
+        clusterLightLists.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+        grid.resize(CLUSTER_COUNT * 2);
+        for (int i = 0; i < 6; i++)
+            aabb[i].resize(CLUSTER_COUNT);
+
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    ~ClusteredLights()
+    {
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(3, buffers);
+    }
+
+    ClusteredLights(const ClusteredLights&) = delete;
+    ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+    // assigns `lights` to the froxels of the frustum described by view/fovY/aspect/near/far, the depth
+    // slices are binned by `jobs` when it is given
+    void Build(const std::vector<LightData>& lights, const glm::mat4& view,
+               float fovY, float aspect, float zNear, float zFar, JobSystem *jobs = nullptr)
+    {
+        if (fovY != builtFovY || aspect != builtAspect || zNear != builtNear || zFar != builtFar)
+            computeClusterBounds(fovY, aspect, zNear, zFar);
+
+        this->lights = lights;
+        lightCount = (unsigned int)lights.size();
+
+        // view-space bounding spheres
+        viewSpheres.resize(lights.size());
+        for (unsigned int i = 0; i < lights.size(); i++) {
+            glm::vec4 sphere = lightBoundingSphere(lights[i]);
+            glm::vec4 center = view * glm::vec4(glm::vec3(sphere), 1.0f);
+            viewSpheres[i] = glm::vec4(glm::vec3(center), sphere.w);
+        }
+
+        std::fill(clusterLightCounts.begin(), clusterLightCounts.end(), 0u);
+
+        if (!jobs || lights.size() < (size_t)PARALLEL_LIGHT_THRESHOLD || jobs->ThreadCount() == 1) {
+            binSlices(0, SLICES);
+        } else {
+            // every job owns a contiguous range of depth slices, so no two threads ever write the
+            // same froxel and no synchronisation is needed until the wait
+            int threadCount = std::min(jobs->ThreadCount(), (int)SLICES);
+            uint32_t slicesPerJob = (uint32_t)((SLICES + threadCount - 1) / threadCount);
+            JobCounter binning;
+            jobs->ParallelFor(SLICES, slicesPerJob, [](void *self, uint32_t first, uint32_t last) {
+                ((ClusteredLights *)self)->binSlices((int)first, (int)last);
+            }, this, binning);
+            jobs->Wait(binning);
+        }
+
+        // compact the fixed size per-froxel lists into one index list
+        indices.clear();
+        maxLightsInCluster = 0;
+        droppedLights = 0;
+        for (int c = 0; c < CLUSTER_COUNT; c++) {
+            unsigned int count = clusterLightCounts[c];
+            if (count > MAX_LIGHTS_PER_CLUSTER) {
+                droppedLights += count - MAX_LIGHTS_PER_CLUSTER;
+                count = MAX_LIGHTS_PER_CLUSTER;
+            }
+            grid[2 * c] = (unsigned int)indices.size();
+            grid[2 * c + 1] = count;
+            const unsigned int* list = &clusterLightLists[c * MAX_LIGHTS_PER_CLUSTER];
+            indices.insert(indices.end(), list, list + count);
+            maxLightsInCluster = std::max(maxLightsInCluster, count);
+        }
+        indexCount = (unsigned int)indices.size();
+    }
+
+    // uploads the result of the last Build into the texture buffers
+    void Upload()
+    {
+        uploadBuffer(buffers[0], lights.data(), lights.size() * sizeof(LightData));
+        uploadBuffer(buffers[1], grid.data(), grid.size() * sizeof(unsigned int));
+        uploadBuffer(buffers[2], indices.data(), indices.size() * sizeof(unsigned int));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // binds the texture buffers to firstUnit..firstUnit+2 and sets the cluster uniforms
+    void Bind(Shader& shader, int firstUnit, float screenWidth, float screenHeight)
+    {
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        shader.setInt("lightData", firstUnit);
+        shader.setInt("clusterGrid", firstUnit + 1);
+        shader.setInt("lightIndices", firstUnit + 2);
+        shader.setVec2("clusterTileSize", screenWidth / TILES_X, screenHeight / TILES_Y);
+        // slice = log(depth) * sliceScale - sliceBias
+        float logRatio = std::log(builtFar / builtNear);
+        shader.setFloat("clusterSliceScale", SLICES / logRatio);
+        shader.setFloat("clusterSliceBias", SLICES * std::log(builtNear) / logRatio);
+    }
+
+    // lights of the last Build, in the order they are stored in the light texture buffer
+    const std::vector<LightData>& Lights() const { return lights; }
+    GLuint LightDataTexture() const { return textures[0]; }
+
+private:
+    GLuint buffers[3];
+    GLuint textures[3];
+
+    float builtFovY = -1.0f, builtAspect = -1.0f, builtNear = -1.0f, builtFar = -1.0f;
+
+    // view-space froxel AABBs, SoA: minX, minY, minZ, maxX, maxY, maxZ
+    std::vector<float> aabb[6];
+    // per slice depth range (positive distances)
+    float sliceNear[SLICES];
+    float sliceFar[SLICES];
+    float tanHalfFovY = 1.0f;
+    float aspectRatio = 1.0f;
+
+    std::vector<LightData> lights;
+    std::vector<glm::vec4> viewSpheres;
+    std::vector<unsigned int> clusterLightCounts;
+    std::vector<unsigned int> clusterLightLists;
+    std::vector<unsigned int> grid;
+    std::vector<unsigned int> indices;
+
+    static void uploadBuffer(GLuint buffer, const void* data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        // orphan the previous storage so the driver does not wait for last frame's reads
+        glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, (size_t)16), nullptr, GL_STREAM_DRAW);
+        if (bytes > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+
+    void computeClusterBounds(float fovY, float aspect, float zNear, float zFar)
+    {
+        builtFovY = fovY;
+        builtAspect = aspect;
+        builtNear = zNear;
+        builtFar = zFar;
+        tanHalfFovY = std::tan(fovY * 0.5f);
+        aspectRatio = aspect;
+
+        for (int z = 0; z < SLICES; z++) {
+            sliceNear[z] = zNear * std::pow(zFar / zNear, (float)z / SLICES);
+            sliceFar[z] = zNear * std::pow(zFar / zNear, (float)(z + 1) / SLICES);
+        }
+
+        for (int z = 0; z < SLICES; z++) {
+            for (int y = 0; y < TILES_Y; y++) {
+                for (int x = 0; x < TILES_X; x++) {
+                    float ndcX0 = -1.0f + 2.0f * x / TILES_X, ndcX1 = -1.0f + 2.0f * (x + 1) / TILES_X;
+                    float ndcY0 = -1.0f + 2.0f * y / TILES_Y, ndcY1 = -1.0f + 2.0f * (y + 1) / TILES_Y;
+                    float sx = tanHalfFovY * aspect, sy = tanHalfFovY;
+                    float dn = sliceNear[z], df = sliceFar[z];
+                    int c = clusterIndex(x, y, z);
+                    aabb[0][c] = std::min(ndcX0 * sx * dn, ndcX0 * sx * df);
+                    aabb[1][c] = std::min(ndcY0 * sy * dn, ndcY0 * sy * df);
+                    aabb[2][c] = -df;
+                    aabb[3][c] = std::max(ndcX1 * sx * dn, ndcX1 * sx * df);
+                    aabb[4][c] = std::max(ndcY1 * sy * dn, ndcY1 * sy * df);
+                    aabb[5][c] = -dn;
+                }
+            }
+        }
+    }
+
+    static int clusterIndex(int x, int y, int z)
+    {
+        return x + TILES_X * (y + TILES_Y * z);
+    }
+
+    int sliceOf(float depth) const
+    {
+        if (depth <= builtNear)
+            return 0;
+        int slice = (int)std::floor(std::log(depth / builtNear) / std::log(builtFar / builtNear) * SLICES);
+        return std::min(std::max(slice, 0), SLICES - 1);
+    }
+
+    // conservative screen tile range covered by a view-space sphere between depths dMin and dMax
+    void tileRange(const glm::vec4& s, float dMin, float dMax, int& x0, int& x1, int& y0, int& y1) const
+    {
+        float sx = tanHalfFovY * aspectRatio, sy = tanHalfFovY;
+        auto project = [dMin, dMax](float v) {
+            // the extreme of v/d over d in [dMin, dMax]
+            return v >= 0.0f ? glm::vec2(v / dMax, v / dMin) : glm::vec2(v / dMin, v / dMax);
+        };
+        float minX = project(s.x - s.w).x / sx, maxX = project(s.x + s.w).y / sx;
+        float minY = project(s.y - s.w).x / sy, maxY = project(s.y + s.w).y / sy;
+        x0 = std::max(0, (int)std::floor((minX * 0.5f + 0.5f) * TILES_X));
+        x1 = std::min(TILES_X - 1, (int)std::floor((maxX * 0.5f + 0.5f) * TILES_X));
+        y0 = std::max(0, (int)std::floor((minY * 0.5f + 0.5f) * TILES_Y));
+        y1 = std::min(TILES_Y - 1, (int)std::floor((maxY * 0.5f + 0.5f) * TILES_Y));
+    }
+
+    void binSlices(int firstSlice, int lastSlice)
+    {
+        RG_PROFILE_ZONE("Bin light slices");
+        for (unsigned int l = 0; l < viewSpheres.size(); l++) {
+            const glm::vec4& s = viewSpheres[l];
+            float dMin = -s.z - s.w, dMax = -s.z + s.w;
+            if (dMax < builtNear || dMin > builtFar)
+                continue;
+            int z0 = std::max(sliceOf(dMin), firstSlice);
+            int z1 = std::min(sliceOf(dMax), lastSlice - 1);
+            if (z0 > z1)
+                continue;
+
+            int x0, x1, y0, y1;
+            tileRange(s, std::max(dMin, builtNear), std::min(dMax, builtFar), x0, x1, y0, y1);
+            if (x0 > x1 || y0 > y1)
+                continue;
+
+            for (int z = z0; z <= z1; z++)
+                for (int y = y0; y <= y1; y++)
+                    binRow(l, s, x0, x1, y, z);
+        }
+    }
+
+    void appendLight(int cluster, unsigned int light)
+    {
+        unsigned int n = clusterLightCounts[cluster]++;
+        if (n < MAX_LIGHTS_PER_CLUSTER)
+            clusterLightLists[cluster * MAX_LIGHTS_PER_CLUSTER + n] = light;
+    }
+
+    // sphere vs froxel AABB test for the tiles x0..x1 of one row, four froxels at a time
+    void binRow(unsigned int light, const glm::vec4& s, int x0, int x1, int y, int z)
+    {
+        int row = clusterIndex(0, y, z);
+#ifdef __SSE2__
+        const __m128 cx = _mm_set1_ps(s.x), cy = _mm_set1_ps(s.y), cz = _mm_set1_ps(s.z);
+        const __m128 r2 = _mm_set1_ps(s.w * s.w);
+        const __m128 zero = _mm_setzero_ps();
+        for (int x = x0 & ~3; x <= x1; x += 4) {
+            int c = row + x;
+            __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&aabb[0][c]), cx), zero),
+                                   _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&aabb[3][c])), zero));
+            __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&aabb[1][c]), cy), zero),
+                                   _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&aabb[4][c])), zero));
+            __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&aabb[2][c]), cz), zero),
+                                   _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&aabb[5][c])), zero));
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+            for (int i = 0; i < 4; i++)
+                if ((mask & (1 << i)) && x + i >= x0 && x + i <= x1)
+                    appendLight(c + i, light);
+        }
+#else
+        for (int x = x0; x <= x1; x++) {
+            int c = row + x;
+            float dx = std::max(aabb[0][c] - s.x, 0.0f) + std::max(s.x - aabb[3][c], 0.0f);
+            float dy = std::max(aabb[1][c] - s.y, 0.0f) + std::max(s.y - aabb[4][c], 0.0f);
+            float dz = std::max(aabb[2][c] - s.z, 0.0f) + std::max(s.z - aabb[5][c], 0.0f);
+            if (dx * dx + dy * dy + dz * dz <= s.w * s.w)
+                appendLight(c, light);
+        }
+#endif
+    }
+};
+
+}
+#endif //PROJECT_BASE_CLUSTEREDLIGHTS_H
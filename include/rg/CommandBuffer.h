@@ -0,0 +1,295 @@
+#ifndef PROJECT_BASE_COMMANDBUFFER_H
+#define PROJECT_BASE_COMMANDBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Draw commands recorded on any thread and issued later by the thread owning the GL context. A buffer
+// is a stream of 32 bit words, an op followed by its operands, so recording is a few appends and
+// merging buffers is a copy. Uniforms are referred to by the ids a CommandReplay hands out; they
+// belong to the program bound last, so a buffer starts with BindProgram.
+enum CommandOp : uint32_t {
+    CMD_BIND_PROGRAM,       // program
+    CMD_BIND_TEXTURE,       // unit, 2D texture
+    CMD_SET_INT,            // uniform, value
+    CMD_SET_INTS,           // uniform, count, count values
+    CMD_SET_MAT4,           // uniform, 16 floats column by column
+    CMD_BIND_UNIFORM_RANGE, // binding point, buffer, offset, size
+    CMD_DRAW_ELEMENTS,      // vertex array, index count; triangles with unsigned int indices
+    CMD_DRAW_ELEMENT_RANGE  // vertex array, first index, index count; like CMD_DRAW_ELEMENTS
+};
+
+class CommandBuffer {
+public:
+    void Clear() { words.clear(); }
+    size_t Size() const { return words.size(); }
+
+    void BindProgram(GLuint program)
+    {
+        push(CMD_BIND_PROGRAM);
+        push(program);
+    }
+
+    void BindTexture(uint32_t unit, GLuint texture)
+    {
+        push(CMD_BIND_TEXTURE);
+        push(unit);
+        push(texture);
+    }
+
+    void SetInt(uint32_t uniform, int value)
+    {
+        push(CMD_SET_INT);
+        push(uniform);
+        push((uint32_t)value);
+    }
+
+    void SetInts(uint32_t uniform, const int *values, int count)
+    {
+        push(CMD_SET_INTS);
+        push(uniform);
+        push((uint32_t)count);
+        size_t at = words.size();
+        words.resize(at + count);
+        std::memcpy(&words[at], values, count * sizeof(int));
+    }
+
+    void SetMat4(uint32_t uniform, const glm::mat4& value)
+    {
+        push(CMD_SET_MAT4);
+        push(uniform);
+        size_t at = words.size();
+        words.resize(at + 16);
+        std::memcpy(&words[at], &value[0][0], 16 * sizeof(float));
+    }
+
+    void BindUniformRange(uint32_t binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        push(CMD_BIND_UNIFORM_RANGE);
+        push(binding);
+        push(buffer);
+        push((uint32_t)offset);
+        push((uint32_t)size);
+    }
+
+    void DrawElements(GLuint vertexArray, uint32_t count)
+    {
+        push(CMD_DRAW_ELEMENTS);
+        push(vertexArray);
+        push(count);
+    }
+
+    void DrawElementRange(GLuint vertexArray, uint32_t firstIndex, uint32_t count)
+    {
+        push(CMD_DRAW_ELEMENT_RANGE);
+        push(vertexArray);
+        push(firstIndex);
+        push(count);
+    }
+
+    void Append(const CommandBuffer& other)
+    {
+        words.insert(words.end(), other.words.begin(), other.words.end());
+    }
+
+private:
+    friend class CommandReplay;
+    std::vector<uint32_t> words;
+
+    void push(uint32_t word) { words.push_back(word); }
+};
+
+// Issues CommandBuffers on the GL thread. It remembers what it bound, so binds and integer uniforms
+// that would not change anything are skipped, and looks the uniform locations of a program up once.
+class CommandReplay {
+public:
+    static const uint32_t MAX_TEXTURE_UNITS = 16;
+
+    // commands skipped because the state was already set, since the last ResetStatistics
+    unsigned int skipped = 0;
+
+    CommandReplay() { Reset(); }
+
+    // id of the uniform `name` for the Set commands; ids are stable, the same name gets the same id
+    uint32_t Uniform(const std::string& name)
+    {
+        for (size_t i = 0; i < names.size(); i++)
+            if (names[i] == name)
+                return (uint32_t)i;
+        names.push_back(name);
+        return (uint32_t)names.size() - 1;
+    }
+
+    // forgets the remembered state, other code may have changed it since the last Run
+    void Reset()
+    {
+        program = 0;
+        programIndex = -1;
+        vertexArray = INVALID;
+        activeUnit = INVALID;
+        for (GLuint& texture : textures)
+            texture = INVALID;
+        for (ProgramCache& state : programs)
+            std::fill(state.intKnown.begin(), state.intKnown.end(), 0);
+    }
+
+    void ResetStatistics() { skipped = 0; }
+
+    void Run(const CommandBuffer& buffer)
+    {
+        const uint32_t *word = buffer.words.data();
+        const uint32_t *end = word + buffer.words.size();
+        while (word < end) {
+            switch (*word++) {
+            case CMD_BIND_PROGRAM: {
+                GLuint next = *word++;
+                if (next == program && programIndex >= 0) {
+                    skipped++;
+                    break;
+                }
+                program = next;
+                glUseProgram(program);
+                bindLocations();
+                break;
+            }
+            case CMD_BIND_TEXTURE: {
+                uint32_t unit = word[0];
+                GLuint texture = word[1];
+                word += 2;
+                if (unit < MAX_TEXTURE_UNITS && textures[unit] == texture) {
+                    skipped++;
+                    break;
+                }
+                if (unit != activeUnit) {
+                    glActiveTexture(GL_TEXTURE0 + unit);
+                    activeUnit = unit;
+                }
+                glBindTexture(GL_TEXTURE_2D, texture);
+                if (unit < MAX_TEXTURE_UNITS)
+                    textures[unit] = texture;
+                break;
+            }
+            case CMD_SET_INT: {
+                uint32_t uniform = word[0];
+                int value = (int)word[1];
+                word += 2;
+                ProgramCache& state = uniformState(uniform);
+                if (state.intKnown[uniform] && state.ints[uniform] == value) {
+                    skipped++;
+                    break;
+                }
+                state.intKnown[uniform] = 1;
+                state.ints[uniform] = value;
+                glUniform1i(state.locations[uniform], value);
+                break;
+            }
+            case CMD_SET_INTS: {
+                uint32_t uniform = word[0];
+                int count = (int)word[1];
+                ProgramCache& state = uniformState(uniform);
+                state.intKnown[uniform] = 0;
+                glUniform1iv(state.locations[uniform], count, (const GLint *)(word + 2));
+                word += 2 + count;
+                break;
+            }
+            case CMD_SET_MAT4:
+                glUniformMatrix4fv(uniformState(word[0]).locations[word[0]], 1, GL_FALSE, (const GLfloat *)(word + 1));
+                word += 17;
+                break;
+            case CMD_BIND_UNIFORM_RANGE:
+                glBindBufferRange(GL_UNIFORM_BUFFER, word[0], word[1], (GLintptr)word[2], (GLsizeiptr)word[3]);
+                word += 4;
+                break;
+            case CMD_DRAW_ELEMENTS:
+                if (word[0] != vertexArray) {
+                    glBindVertexArray(word[0]);
+                    vertexArray = word[0];
+                }
+                glDrawElements(GL_TRIANGLES, (GLsizei)word[1], GL_UNSIGNED_INT, 0);
+                word += 2;
+                break;
+            case CMD_DRAW_ELEMENT_RANGE:
+                if (word[0] != vertexArray) {
+                    glBindVertexArray(word[0]);
+                    vertexArray = word[0];
+                }
+                glDrawElements(GL_TRIANGLES, (GLsizei)word[2], GL_UNSIGNED_INT, (const void *)((uintptr_t)word[1] * sizeof(GLuint)));
+                word += 3;
+                break;
+            default:
+                std::cout << "ERROR::COMMAND_BUFFER:: unknown op " << word[-1] << std::endl;
+                return;
+            }
+        }
+    }
+
+    // leaves vertex array 0 bound and texture unit 0 active, like the rest of the renderer expects
+    void Finish()
+    {
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        Reset();
+    }
+
+private:
+    static const GLuint INVALID = 0xffffffffu;
+
+    // locations of every registered uniform in one program and the integer values set since Reset
+    struct ProgramCache {
+        GLuint program;
+        std::vector<GLint> locations;
+        std::vector<int> ints;
+        std::vector<char> intKnown;
+    };
+
+    std::vector<std::string> names;
+    std::vector<ProgramCache> programs;
+    GLuint program = 0;
+    int programIndex = -1;
+    GLuint vertexArray = INVALID;
+    uint32_t activeUnit = INVALID;
+    GLuint textures[MAX_TEXTURE_UNITS];
+
+    void bindLocations()
+    {
+        programIndex = -1;
+        for (size_t i = 0; i < programs.size(); i++)
+            if (programs[i].program == program)
+                programIndex = (int)i;
+        if (programIndex < 0) {
+            programs.push_back(ProgramCache());
+            programs.back().program = program;
+            programIndex = (int)programs.size() - 1;
+        }
+        // names registered after the program was first seen
+        ProgramCache& state = programs[programIndex];
+        for (size_t i = state.locations.size(); i < names.size(); i++) {
+            state.locations.push_back(glGetUniformLocation(program, names[i].c_str()));
+            state.ints.push_back(0);
+            state.intKnown.push_back(0);
+        }
+    }
+
+    // the bound program's cache, holding `uniform` even when it was registered after the cache was built
+    ProgramCache& uniformState(uint32_t uniform)
+    {
+        assert(programIndex >= 0 && "uniform set before any program was bound");
+        if (uniform >= programs[programIndex].locations.size())
+            bindLocations();
+        return programs[programIndex];
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_COMMANDBUFFER_H
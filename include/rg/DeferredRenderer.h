@@ -0,0 +1,274 @@
+#ifndef PROJECT_BASE_DEFERREDRENDERER_H
+#define PROJECT_BASE_DEFERREDRENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/ClusteredLights.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace rg {
+
+// Deferred shading path. The geometry pass writes the opaque scene into a G-buffer
+//   gAlbedoSpec - RGBA8:   diffuse texture colour, specular intensity in alpha
+//   gNormal     - RG16F:   octahedral encoded world space normal (normal/parallax mapping already applied)
+//   gDepth      - DEPTH24_STENCIL8
+// and the lighting pass accumulates the lights into the currently bound framebuffer:
+//   - one full screen triangle for the directional light, which also copies the G-buffer depth
+//     into the target so forward geometry drawn afterwards is depth tested against the scene
+//   - one instanced draw of sphere light volumes for all point and spot lights. Only the back
+//     faces are rasterised with GL_GEQUAL depth testing, so a light only shades pixels whose
+//     surface lies in front of the far side of its volume, also when the camera is inside it.
+// The cost of the point/spot lights therefore scales with covered pixels x overlapping lights.
+class DeferredRenderer {
+public:
+    DeferredRenderer()
+        : geometryShader("resources/shaders/rb_bear_shader.vs", "resources/shaders/gbuffer.fs")
+        , directionalShader("resources/shaders/deferred_dirlight.vs", "resources/shaders/deferred_dirlight.fs")
+        , lightVolumeShader("resources/shaders/deferred_light.vs", "resources/shaders/deferred_light.fs")
+    {
+        directionalShader.use();
+        directionalShader.setInt("gAlbedoSpec", 0);
+        directionalShader.setInt("gNormal", 1);
+        directionalShader.setInt("gDepth", 2);
+        lightVolumeShader.use();
+        lightVolumeShader.setInt("gAlbedoSpec", 0);
+        lightVolumeShader.setInt("gNormal", 1);
+        lightVolumeShader.setInt("gDepth", 2);
+        lightVolumeShader.setInt("lightData", 3);
+
+        // the full screen triangle is generated from gl_VertexID, core profile still wants a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+        setupSphere();
+    }
+
+    ~DeferredRenderer()
+    {
+        destroyGBuffer();
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteVertexArrays(1, &sphereVAO);
+        glDeleteBuffers(1, &sphereVBO);
+        glDeleteBuffers(1, &sphereEBO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // shader used for the geometry pass, it takes the same uniforms and textures as rb_bear_shader
+    Shader& GeometryShader() { return geometryShader; }
+    // shader of the full screen directional light pass, the caller sets the dirLight uniforms
+    Shader& DirectionalShader() { return directionalShader; }
+    // shader of the point/spot light volumes, for uniforms the renderer does not own (shadows)
+    Shader& LightVolumeShader() { return lightVolumeShader; }
+
+    // (re)creates the G-buffer when the framebuffer size changes
+    void Resize(int width, int height)
+    {
+        if (width == this->width && height == this->height)
+            return;
+        destroyGBuffer();
+        this->width = width;
+        this->height = height;
+
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        gAlbedoSpec = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gAlbedoSpec, 0);
+        gNormal = createTexture(GL_RG16F, GL_RG, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+        gDepth = createTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
+
+        const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: G-buffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void BeginGeometryPass()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        // the G-buffer stores raw material data, blending would mix it with the clear value
+        glDisable(GL_BLEND);
+    }
+
+    void EndGeometryPass(GLuint targetFramebuffer = 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glEnable(GL_BLEND);
+    }
+
+    // accumulates all lights into the bound framebuffer, DirectionalShader() must be configured first
+    void LightingPass(const ClusteredLights& lights, const glm::mat4& projection, const glm::mat4& view,
+                      const glm::vec3& viewPos, const glm::vec3& clearColor, bool blinn)
+    {
+        glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        glm::vec2 screenSize((float)width, (float)height);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gNormal);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, gDepth);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_BUFFER, lights.LightDataTexture());
+
+        // directional light + ambient, writes the scene depth
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+        glDepthFunc(GL_ALWAYS);
+        directionalShader.use();
+        directionalShader.setMat4("inverseViewProjection", inverseViewProjection);
+        directionalShader.setVec3("viewPos", viewPos);
+        directionalShader.setVec3("clearColor", clearColor);
+        directionalShader.setBool("blinn", blinn);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // point and spot light volumes
+        const std::vector<LightData>& lightList = lights.Lights();
+        if (!lightList.empty()) {
+            volumes.resize(lightList.size());
+            for (unsigned int i = 0; i < lightList.size(); i++) {
+                volumes[i].sphere = lightBoundingSphere(lightList[i]);
+                volumes[i].lightIndex = (float)i;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, volumes.size() * sizeof(LightVolume), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, volumes.size() * sizeof(LightVolume), volumes.data());
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glDepthMask(GL_FALSE);
+            glDepthFunc(GL_GEQUAL);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+            // volumes reaching past the far plane must still rasterise their back faces
+            glEnable(GL_DEPTH_CLAMP);
+
+            lightVolumeShader.use();
+            lightVolumeShader.setMat4("viewProjection", projection * view);
+            lightVolumeShader.setMat4("inverseViewProjection", inverseViewProjection);
+            lightVolumeShader.setVec2("screenSize", screenSize);
+            lightVolumeShader.setVec3("viewPos", viewPos);
+            lightVolumeShader.setBool("blinn", blinn);
+            glBindVertexArray(sphereVAO);
+            glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0, (GLsizei)volumes.size());
+
+            glDisable(GL_DEPTH_CLAMP);
+            glCullFace(GL_BACK);
+            glDepthMask(GL_TRUE);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+
+        glBindVertexArray(0);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_BLEND);
+        glDepthFunc(GL_LESS);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    struct LightVolume {
+        glm::vec4 sphere;
+        float lightIndex;
+    };
+
+    Shader geometryShader;
+    Shader directionalShader;
+    Shader lightVolumeShader;
+
+    int width = 0, height = 0;
+    GLuint gBuffer = 0;
+    GLuint gAlbedoSpec = 0, gNormal = 0, gDepth = 0;
+
+    GLuint emptyVAO = 0;
+    GLuint sphereVAO = 0, sphereVBO = 0, sphereEBO = 0, instanceVBO = 0;
+    GLsizei sphereIndexCount = 0;
+    std::vector<LightVolume> volumes;
+
+    GLuint createTexture(GLenum internalFormat, GLenum format, GLenum type)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    void destroyGBuffer()
+    {
+        if (gBuffer == 0)
+            return;
+        glDeleteFramebuffers(1, &gBuffer);
+        glDeleteTextures(1, &gAlbedoSpec);
+        glDeleteTextures(1, &gNormal);
+        glDeleteTextures(1, &gDepth);
+        gBuffer = gAlbedoSpec = gNormal = gDepth = 0;
+    }
+
+    // low poly unit UV sphere, outward facing counter-clockwise triangles
+    void setupSphere()
+    {
+        const int segments = 16, rings = 12;
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        for (int i = 0; i <= rings; i++) {
+            float theta = 3.14159265f * (float)i / rings;
+            for (int j = 0; j <= segments; j++) {
+                float phi = 2.0f * 3.14159265f * (float)j / segments;
+                vertices.push_back(std::sin(theta) * std::cos(phi));
+                vertices.push_back(std::cos(theta));
+                vertices.push_back(std::sin(theta) * std::sin(phi));
+            }
+        }
+        for (int i = 0; i < rings; i++) {
+            for (int j = 0; j < segments; j++) {
+                unsigned int a = i * (segments + 1) + j, b = a + segments + 1;
+                unsigned int c = a + 1, d = b + 1;
+                indices.insert(indices.end(), { a, c, b, c, d, b });
+            }
+        }
+        sphereIndexCount = (GLsizei)indices.size();
+
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &sphereEBO);
+        glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+        // per light: bounding sphere and index into the light texture buffer
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)offsetof(LightVolume, sphere));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)offsetof(LightVolume, lightIndex));
+        glVertexAttribDivisor(2, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+}
+#endif //PROJECT_BASE_DEFERREDRENDERER_H
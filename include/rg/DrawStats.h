@@ -0,0 +1,314 @@
+#ifndef PROJECT_BASE_DRAWSTATS_H
+#define PROJECT_BASE_DRAWSTATS_H
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Draw calls and state changes issued through glad since the last BeginFrame, including the ones
+// made inside learnopengl's Mesh::Draw and Shader::set*.
+struct DrawStats {
+    unsigned long long drawCalls = 0;
+    unsigned long long instances = 0;
+    unsigned long long vertices = 0;
+    unsigned long long triangles = 0;
+    unsigned long long programBinds = 0;      // glUseProgram
+    unsigned long long textureBinds = 0;      // glBindTexture
+    unsigned long long vertexArrayBinds = 0;  // glBindVertexArray
+    unsigned long long uniformCalls = 0;      // glUniform*
+    unsigned long long uniformLookups = 0;    // glGetUniformLocation
+    unsigned long long uniformBytes = 0;
+    unsigned long long bufferBytes = 0;       // glBufferData/glBufferSubData
+
+    void BeginFrame() { *this = DrawStats(); }
+};
+
+inline DrawStats& drawStats() {
+    static DrawStats stats;
+    return stats;
+}
+
+// Completed frames, oldest first, for the ImGui counters and the CSV dump.
+class DrawStatsLog {
+public:
+    static const size_t CAPACITY = 3600;
+
+    void Push(const DrawStats& stats)
+    {
+        if (frames.size() == CAPACITY) {
+            frames[first] = stats;
+            first = (first + 1) % CAPACITY;
+        } else {
+            frames.push_back(stats);
+        }
+        frameCount++;
+    }
+
+    bool Empty() const { return frames.empty(); }
+    const DrawStats& Last() const { return frames[(first + frames.size() - 1) % frames.size()]; }
+
+    bool WriteCsv(const std::string& path) const
+    {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::DRAW_STATS:: could not write " << path << std::endl;
+            return false;
+        }
+        out << "frame,draw_calls,instances,vertices,triangles,program_binds,texture_binds,vertex_array_binds,"
+               "uniform_calls,uniform_lookups,uniform_bytes,buffer_bytes\n";
+        unsigned long long frame = frameCount - frames.size();
+        for (size_t i = 0; i < frames.size(); i++) {
+            const DrawStats& s = frames[(first + i) % frames.size()];
+            out << frame++ << ',' << s.drawCalls << ',' << s.instances << ',' << s.vertices << ',' << s.triangles << ','
+                << s.programBinds << ',' << s.textureBinds << ',' << s.vertexArrayBinds << ',' << s.uniformCalls << ','
+                << s.uniformLookups << ',' << s.uniformBytes << ',' << s.bufferBytes << '\n';
+        }
+        return true;
+    }
+
+private:
+    std::vector<DrawStats> frames;
+    size_t first = 0;
+    unsigned long long frameCount = 0;
+};
+
+inline DrawStatsLog& drawStatsLog() {
+    static DrawStatsLog log;
+    return log;
+}
+
+// logs the frame counted so far and starts counting the next one
+inline void beginDrawStatsFrame(bool logPreviousFrame = true) {
+    if (logPreviousFrame)
+        drawStatsLog().Push(drawStats());
+    drawStats().BeginFrame();
+}
+
+namespace detail {
+
+struct DrawEntryPoints {
+    PFNGLDRAWARRAYSPROC drawArrays = nullptr;
+    PFNGLDRAWELEMENTSPROC drawElements = nullptr;
+    PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced = nullptr;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced = nullptr;
+    PFNGLUSEPROGRAMPROC useProgram = nullptr;
+    PFNGLBINDTEXTUREPROC bindTexture = nullptr;
+    PFNGLBINDVERTEXARRAYPROC bindVertexArray = nullptr;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation = nullptr;
+    PFNGLUNIFORM1IPROC uniform1i = nullptr;
+    PFNGLUNIFORM1IVPROC uniform1iv = nullptr;
+    PFNGLUNIFORM1FPROC uniform1f = nullptr;
+    PFNGLUNIFORM2FPROC uniform2f = nullptr;
+    PFNGLUNIFORM2FVPROC uniform2fv = nullptr;
+    PFNGLUNIFORM3FPROC uniform3f = nullptr;
+    PFNGLUNIFORM3FVPROC uniform3fv = nullptr;
+    PFNGLUNIFORM4FPROC uniform4f = nullptr;
+    PFNGLUNIFORM4FVPROC uniform4fv = nullptr;
+    PFNGLUNIFORMMATRIX2FVPROC uniformMatrix2fv = nullptr;
+    PFNGLUNIFORMMATRIX3FVPROC uniformMatrix3fv = nullptr;
+    PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv = nullptr;
+    PFNGLBUFFERDATAPROC bufferData = nullptr;
+    PFNGLBUFFERSUBDATAPROC bufferSubData = nullptr;
+};
+
+inline DrawEntryPoints& originalDrawEntryPoints() {
+    static DrawEntryPoints entryPoints;
+    return entryPoints;
+}
+
+inline unsigned long long trianglesOf(GLenum mode, GLsizei count) {
+    switch (mode) {
+        case GL_TRIANGLES: return (unsigned long long)count / 3;
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN: return count > 2 ? (unsigned long long)count - 2 : 0;
+        default: return 0;
+    }
+}
+
+inline void countDraw(GLenum mode, GLsizei count, GLsizei instanceCount) {
+    DrawStats& stats = drawStats();
+    stats.drawCalls++;
+    stats.instances += (unsigned long long)instanceCount;
+    stats.vertices += (unsigned long long)count * (unsigned long long)instanceCount;
+    stats.triangles += trianglesOf(mode, count) * (unsigned long long)instanceCount;
+}
+
+inline void countUniform(unsigned long long bytes) {
+    drawStats().uniformCalls++;
+    drawStats().uniformBytes += bytes;
+}
+
+inline void APIENTRY countedDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    countDraw(mode, count, 1);
+    originalDrawEntryPoints().drawArrays(mode, first, count);
+}
+
+inline void APIENTRY countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+    countDraw(mode, count, 1);
+    originalDrawEntryPoints().drawElements(mode, count, type, indices);
+}
+
+inline void APIENTRY countedDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) {
+    countDraw(mode, count, instanceCount);
+    originalDrawEntryPoints().drawArraysInstanced(mode, first, count, instanceCount);
+}
+
+inline void APIENTRY countedDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount) {
+    countDraw(mode, count, instanceCount);
+    originalDrawEntryPoints().drawElementsInstanced(mode, count, type, indices, instanceCount);
+}
+
+inline void APIENTRY countedUseProgram(GLuint program) {
+    drawStats().programBinds++;
+    originalDrawEntryPoints().useProgram(program);
+}
+
+inline void APIENTRY countedBindTexture(GLenum target, GLuint texture) {
+    drawStats().textureBinds++;
+    originalDrawEntryPoints().bindTexture(target, texture);
+}
+
+inline void APIENTRY countedBindVertexArray(GLuint array) {
+    drawStats().vertexArrayBinds++;
+    originalDrawEntryPoints().bindVertexArray(array);
+}
+
+inline GLint APIENTRY countedGetUniformLocation(GLuint program, const GLchar *name) {
+    drawStats().uniformLookups++;
+    return originalDrawEntryPoints().getUniformLocation(program, name);
+}
+
+inline void APIENTRY countedUniform1i(GLint location, GLint v0) {
+    countUniform(sizeof(GLint));
+    originalDrawEntryPoints().uniform1i(location, v0);
+}
+
+inline void APIENTRY countedUniform1iv(GLint location, GLsizei count, const GLint *value) {
+    countUniform(sizeof(GLint) * (unsigned long long)count);
+    originalDrawEntryPoints().uniform1iv(location, count, value);
+}
+
+inline void APIENTRY countedUniform1f(GLint location, GLfloat v0) {
+    countUniform(sizeof(GLfloat));
+    originalDrawEntryPoints().uniform1f(location, v0);
+}
+
+inline void APIENTRY countedUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    countUniform(2 * sizeof(GLfloat));
+    originalDrawEntryPoints().uniform2f(location, v0, v1);
+}
+
+inline void APIENTRY countedUniform2fv(GLint location, GLsizei count, const GLfloat *value) {
+    countUniform(2 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniform2fv(location, count, value);
+}
+
+inline void APIENTRY countedUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    countUniform(3 * sizeof(GLfloat));
+    originalDrawEntryPoints().uniform3f(location, v0, v1, v2);
+}
+
+inline void APIENTRY countedUniform3fv(GLint location, GLsizei count, const GLfloat *value) {
+    countUniform(3 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniform3fv(location, count, value);
+}
+
+inline void APIENTRY countedUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    countUniform(4 * sizeof(GLfloat));
+    originalDrawEntryPoints().uniform4f(location, v0, v1, v2, v3);
+}
+
+inline void APIENTRY countedUniform4fv(GLint location, GLsizei count, const GLfloat *value) {
+    countUniform(4 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniform4fv(location, count, value);
+}
+
+inline void APIENTRY countedUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    countUniform(4 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniformMatrix2fv(location, count, transpose, value);
+}
+
+inline void APIENTRY countedUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    countUniform(9 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniformMatrix3fv(location, count, transpose, value);
+}
+
+inline void APIENTRY countedUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    countUniform(16 * sizeof(GLfloat) * (unsigned long long)count);
+    originalDrawEntryPoints().uniformMatrix4fv(location, count, transpose, value);
+}
+
+inline void APIENTRY countedBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    if (data)
+        drawStats().bufferBytes += (unsigned long long)size;
+    originalDrawEntryPoints().bufferData(target, size, data, usage);
+}
+
+inline void APIENTRY countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    drawStats().bufferBytes += (unsigned long long)size;
+    originalDrawEntryPoints().bufferSubData(target, offset, size, data);
+}
+
+}
+
+// Routes glad's draw, bind, uniform and buffer upload entry points through counting wrappers.
+// Call once after gladLoadGLLoader.
+inline void installDrawCounters() {
+    detail::DrawEntryPoints& original = detail::originalDrawEntryPoints();
+    if (original.drawArrays)
+        return;
+    original.drawArrays = glad_glDrawArrays;
+    original.drawElements = glad_glDrawElements;
+    original.drawArraysInstanced = glad_glDrawArraysInstanced;
+    original.drawElementsInstanced = glad_glDrawElementsInstanced;
+    original.useProgram = glad_glUseProgram;
+    original.bindTexture = glad_glBindTexture;
+    original.bindVertexArray = glad_glBindVertexArray;
+    original.getUniformLocation = glad_glGetUniformLocation;
+    original.uniform1i = glad_glUniform1i;
+    original.uniform1iv = glad_glUniform1iv;
+    original.uniform1f = glad_glUniform1f;
+    original.uniform2f = glad_glUniform2f;
+    original.uniform2fv = glad_glUniform2fv;
+    original.uniform3f = glad_glUniform3f;
+    original.uniform3fv = glad_glUniform3fv;
+    original.uniform4f = glad_glUniform4f;
+    original.uniform4fv = glad_glUniform4fv;
+    original.uniformMatrix2fv = glad_glUniformMatrix2fv;
+    original.uniformMatrix3fv = glad_glUniformMatrix3fv;
+    original.uniformMatrix4fv = glad_glUniformMatrix4fv;
+    original.bufferData = glad_glBufferData;
+    original.bufferSubData = glad_glBufferSubData;
+
+    glad_glDrawArrays = detail::countedDrawArrays;
+    glad_glDrawElements = detail::countedDrawElements;
+    glad_glDrawArraysInstanced = detail::countedDrawArraysInstanced;
+    glad_glDrawElementsInstanced = detail::countedDrawElementsInstanced;
+    glad_glUseProgram = detail::countedUseProgram;
+    glad_glBindTexture = detail::countedBindTexture;
+    glad_glBindVertexArray = detail::countedBindVertexArray;
+    glad_glGetUniformLocation = detail::countedGetUniformLocation;
+    glad_glUniform1i = detail::countedUniform1i;
+    glad_glUniform1iv = detail::countedUniform1iv;
+    glad_glUniform1f = detail::countedUniform1f;
+    glad_glUniform2f = detail::countedUniform2f;
+    glad_glUniform2fv = detail::countedUniform2fv;
+    glad_glUniform3f = detail::countedUniform3f;
+    glad_glUniform3fv = detail::countedUniform3fv;
+    glad_glUniform4f = detail::countedUniform4f;
+    glad_glUniform4fv = detail::countedUniform4fv;
+    glad_glUniformMatrix2fv = detail::countedUniformMatrix2fv;
+    glad_glUniformMatrix3fv = detail::countedUniformMatrix3fv;
+    glad_glUniformMatrix4fv = detail::countedUniformMatrix4fv;
+    glad_glBufferData = detail::countedBufferData;
+    glad_glBufferSubData = detail::countedBufferSubData;
+}
+
+}
+
+#endif //PROJECT_BASE_DRAWSTATS_H
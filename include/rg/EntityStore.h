@@ -0,0 +1,231 @@
+#ifndef PROJECT_BASE_ENTITYSTORE_H
+#define PROJECT_BASE_ENTITYSTORE_H
+
+#include <glm/glm.hpp>
+
+#include <rg/ClusteredLights.h>
+#include <rg/LightCulling.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rg {
+
+// Archetype entity/component store. Entities with the same set of components share an archetype
+// that keeps every component in its own contiguous array, row i of each array belonging to the
+// same entity, so a system touches exactly the arrays it needs, front to back. Destroying an entity
+// moves the archetype's last row into its place; rows are therefore only stable until the next
+// Create/Destroy. The component set is fixed, a component is one bit of the mask.
+
+// index in the low 24 bits, generation in the high 8 bits so stale handles are detected
+typedef uint32_t Entity;
+const Entity NULL_ENTITY = 0xffffffffu;
+
+enum ComponentBit : uint32_t {
+    COMPONENT_TRANSFORM = 1u << 0,
+    COMPONENT_MESH = 1u << 1,
+    COMPONENT_MATERIAL = 1u << 2,
+    COMPONENT_BOUNDS = 1u << 3,
+    COMPONENT_LIGHT = 1u << 4,
+    COMPONENT_TRANSPARENCY = 1u << 5
+};
+
+struct TransformComponent {
+    glm::mat4 model = glm::mat4(1.0f);
+    int node = -1;   // TransformHierarchy node the matrix is copied from every frame, -1 when static
+};
+
+struct MeshComponent {
+    uint32_t mesh = 0;   // index into the application's mesh table
+};
+
+struct MaterialComponent {
+    // 0 keeps the textures the mesh binds itself
+    unsigned int diffuse = 0, specular = 0, normal = 0;
+    bool normalMapped = false;
+    bool replacedByReflection = false;   // drawn by the skybox reflection pass instead while it is on
+};
+
+struct BoundsComponent {
+    BoundingSphere local;
+    BoundingSphere world;
+};
+
+struct LightComponent {
+    LightData light;
+};
+
+struct TransparencyComponent {
+    float opacity = 0.5f;
+    float viewDistance = 0.0f;   // written by the sorting system
+};
+
+struct Archetype {
+    uint32_t mask = 0;
+    std::vector<Entity> entities;
+    std::vector<TransformComponent> transforms;
+    std::vector<MeshComponent> meshes;
+    std::vector<MaterialComponent> materials;
+    std::vector<BoundsComponent> bounds;
+    std::vector<LightComponent> lights;
+    std::vector<TransparencyComponent> transparencies;
+
+    size_t Size() const { return entities.size(); }
+};
+
+template<typename T> struct ComponentColumn;
+template<> struct ComponentColumn<TransformComponent> {
+    static const uint32_t BIT = COMPONENT_TRANSFORM;
+    static std::vector<TransformComponent>& Get(Archetype& a) { return a.transforms; }
+};
+template<> struct ComponentColumn<MeshComponent> {
+    static const uint32_t BIT = COMPONENT_MESH;
+    static std::vector<MeshComponent>& Get(Archetype& a) { return a.meshes; }
+};
+template<> struct ComponentColumn<MaterialComponent> {
+    static const uint32_t BIT = COMPONENT_MATERIAL;
+    static std::vector<MaterialComponent>& Get(Archetype& a) { return a.materials; }
+};
+template<> struct ComponentColumn<BoundsComponent> {
+    static const uint32_t BIT = COMPONENT_BOUNDS;
+    static std::vector<BoundsComponent>& Get(Archetype& a) { return a.bounds; }
+};
+template<> struct ComponentColumn<LightComponent> {
+    static const uint32_t BIT = COMPONENT_LIGHT;
+    static std::vector<LightComponent>& Get(Archetype& a) { return a.lights; }
+};
+template<> struct ComponentColumn<TransparencyComponent> {
+    static const uint32_t BIT = COMPONENT_TRANSPARENCY;
+    static std::vector<TransparencyComponent>& Get(Archetype& a) { return a.transparencies; }
+};
+
+class EntityStore {
+public:
+    // the new entity's components are default constructed
+    Entity Create(uint32_t mask)
+    {
+        uint32_t index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        else {
+            index = (uint32_t)locations.size();
+            locations.push_back(Location());
+        }
+        Location& location = locations[index];
+        location.archetype = archetypeFor(mask);
+        Archetype& archetype = *archetypes[location.archetype];
+        location.row = (uint32_t)archetype.Size();
+        Entity entity = index | ((uint32_t)location.generation << 24);
+        archetype.entities.push_back(entity);
+        forEachColumn(archetype, [](auto& column) { column.emplace_back(); });
+        count++;
+        version++;
+        return entity;
+    }
+
+    void Destroy(Entity entity)
+    {
+        if (!Alive(entity))
+            return;
+        Location& location = locations[entity & INDEX_MASK];
+        Archetype& archetype = *archetypes[location.archetype];
+        uint32_t row = location.row;
+        uint32_t last = (uint32_t)archetype.Size() - 1;
+        if (row != last) {
+            Entity moved = archetype.entities[last];
+            archetype.entities[row] = moved;
+            forEachColumn(archetype, [row, last](auto& column) { column[row] = column[last]; });
+            locations[moved & INDEX_MASK].row = row;
+        }
+        archetype.entities.pop_back();
+        forEachColumn(archetype, [](auto& column) { column.pop_back(); });
+        location.generation++;
+        freeIndices.push_back(entity & INDEX_MASK);
+        count--;
+        version++;
+    }
+
+    bool Alive(Entity entity) const
+    {
+        uint32_t index = entity & INDEX_MASK;
+        return entity != NULL_ENTITY && index < locations.size() && locations[index].generation == (uint8_t)(entity >> 24);
+    }
+
+    bool Has(Entity entity, uint32_t mask) const
+    {
+        return Alive(entity) && (archetypes[locations[entity & INDEX_MASK].archetype]->mask & mask) == mask;
+    }
+
+    // the entity must be alive and have the component
+    template<typename T>
+    T& Get(Entity entity)
+    {
+        const Location& location = locations[entity & INDEX_MASK];
+        return ComponentColumn<T>::Get(*archetypes[location.archetype])[location.row];
+    }
+
+    // calls fn(Archetype&) for every non-empty archetype having all components of `mask`
+    template<typename Function>
+    void ForEach(uint32_t mask, Function&& fn)
+    {
+        for (std::unique_ptr<Archetype>& archetype : archetypes)
+            if ((archetype->mask & mask) == mask && archetype->Size() > 0)
+                fn(*archetype);
+    }
+
+    size_t Count() const { return count; }
+    size_t ArchetypeCount() const { return archetypes.size(); }
+    // changes with every Create/Destroy, i.e. whenever rows may have moved
+    uint64_t Version() const { return version; }
+
+private:
+    static const uint32_t INDEX_MASK = 0x00ffffffu;
+
+    struct Location {
+        uint32_t archetype = 0;
+        uint32_t row = 0;
+        uint8_t generation = 0;
+    };
+
+    // archetypes are few, a linear search over their masks is enough
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::vector<Location> locations;
+    std::vector<uint32_t> freeIndices;
+    size_t count = 0;
+    uint64_t version = 0;
+
+    uint32_t archetypeFor(uint32_t mask)
+    {
+        for (size_t i = 0; i < archetypes.size(); i++)
+            if (archetypes[i]->mask == mask)
+                return (uint32_t)i;
+        archetypes.emplace_back(new Archetype());
+        archetypes.back()->mask = mask;
+        return (uint32_t)archetypes.size() - 1;
+    }
+
+    // calls fn(column) for the component arrays the archetype has
+    template<typename Function>
+    static void forEachColumn(Archetype& archetype, Function&& fn)
+    {
+        if (archetype.mask & COMPONENT_TRANSFORM)
+            fn(archetype.transforms);
+        if (archetype.mask & COMPONENT_MESH)
+            fn(archetype.meshes);
+        if (archetype.mask & COMPONENT_MATERIAL)
+            fn(archetype.materials);
+        if (archetype.mask & COMPONENT_BOUNDS)
+            fn(archetype.bounds);
+        if (archetype.mask & COMPONENT_LIGHT)
+            fn(archetype.lights);
+        if (archetype.mask & COMPONENT_TRANSPARENCY)
+            fn(archetype.transparencies);
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_ENTITYSTORE_H
@@ -0,0 +1,496 @@
+#ifndef PROJECT_BASE_GPUDRIVENSCENE_H
+#define PROJECT_BASE_GPUDRIVENSCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <rg/DrawStats.h>
+#include <rg/LightCulling.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// glad is generated for the 3.3 core profile, the GL 4.3 compute and indirect entry points are loaded by hand
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect,
+                                                            GLsizei drawCount, GLsizei stride);
+#endif
+
+namespace rg {
+
+// Max-reduced mip chain of a depth buffer ("Hi-Z"): every texel of level n holds the farthest depth of
+// the texels it covers in level n - 1. Level 0 is the largest power of two that fits into the depth
+// buffer, so the levels below halve exactly. A sphere whose nearest depth lies behind the farthest
+// depth of the few texels covering its screen rectangle is hidden.
+class DepthPyramid {
+public:
+    DepthPyramid()
+        : reduceShader("resources/shaders/hiz.vs", "resources/shaders/hiz.fs")
+    {
+        glGenFramebuffers(1, &depthFramebuffer);
+        glGenFramebuffers(1, &levelFramebuffer);
+        glGenVertexArrays(1, &emptyVAO);
+        reduceShader.use();
+        reduceShader.setInt("source", 0);
+    }
+
+    ~DepthPyramid()
+    {
+        release();
+        glDeleteFramebuffers(1, &depthFramebuffer);
+        glDeleteFramebuffers(1, &levelFramebuffer);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    // Rebuilds the pyramid from the depth buffer of `framebuffer` (width x height, may be multisampled),
+    // which was drawn with `viewProjection`. Leaves `framebuffer` bound and the viewport covering it.
+    void Build(GLuint framebuffer, int width, int height, const glm::mat4& viewProjection)
+    {
+        // minimized window
+        if (width <= 0 || height <= 0) {
+            valid = false;
+            return;
+        }
+        if (width != depthWidth || height != depthHeight)
+            resize(width, height);
+        this->viewProjection = viewProjection;
+
+        // resolve the depth into a single sampled texture
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST), blend = glIsEnabled(GL_BLEND), cullFace = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+        glBindFramebuffer(GL_FRAMEBUFFER, levelFramebuffer);
+        glBindVertexArray(emptyVAO);
+        reduceShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        for (int level = 0; level < levels; level++) {
+            int levelWidth = std::max(1, size.x >> level), levelHeight = std::max(1, size.y >> level);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, level);
+            glViewport(0, 0, levelWidth, levelHeight);
+            if (level == 0) {
+                glBindTexture(GL_TEXTURE_2D, depthTexture);
+                reduceShader.setVec2("scale", glm::vec2((float)width / (float)levelWidth, (float)height / (float)levelHeight));
+            }
+            else {
+                // only the level read is enabled, texelFetch's level 0 is the base level
+                glBindTexture(GL_TEXTURE_2D, pyramid);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                int sourceWidth = std::max(1, size.x >> (level - 1)), sourceHeight = std::max(1, size.y >> (level - 1));
+                reduceShader.setVec2("scale", glm::vec2((float)sourceWidth / (float)levelWidth, (float)sourceHeight / (float)levelHeight));
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindTexture(GL_TEXTURE_2D, pyramid);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindVertexArray(0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (cullFace)
+            glEnable(GL_CULL_FACE);
+        valid = true;
+    }
+
+    // the next Build starts over, e.g. after frames that did not build it
+    void Invalidate() { valid = false; }
+
+    bool Valid() const { return valid; }
+    GLuint Texture() const { return pyramid; }
+    glm::ivec2 Size() const { return size; }
+    int Levels() const { return levels; }
+    const glm::mat4& ViewProjection() const { return viewProjection; }
+
+private:
+    Shader reduceShader;
+    GLuint depthFramebuffer = 0, levelFramebuffer = 0, emptyVAO = 0;
+    GLuint depthTexture = 0, pyramid = 0;
+    int depthWidth = 0, depthHeight = 0;
+    glm::ivec2 size = glm::ivec2(0);
+    int levels = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    bool valid = false;
+
+    void resize(int width, int height)
+    {
+        release();
+        depthWidth = width;
+        depthHeight = height;
+        // same format as the window's and the benchmark framebuffer's depth, glBlitFramebuffer needs that
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+        size = glm::ivec2(1);
+        while (size.x * 2 <= width)
+            size.x *= 2;
+        while (size.y * 2 <= height)
+            size.y *= 2;
+        levels = 1;
+        while ((std::max(size.x, size.y) >> levels) > 0)
+            levels++;
+        glGenTextures(1, &pyramid);
+        glBindTexture(GL_TEXTURE_2D, pyramid);
+        for (int level = 0; level < levels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(1, size.x >> level), std::max(1, size.y >> level), 0,
+                         GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        valid = false;
+    }
+
+    void release()
+    {
+        glDeleteTextures(1, &depthTexture);
+        glDeleteTextures(1, &pyramid);
+        depthTexture = pyramid = 0;
+    }
+};
+
+// GPU-driven drawing of many instances of a few models (GL 4.3). The meshes of all models share one
+// vertex and one index buffer, the instances (model matrix, world space bounding sphere, model) live in a
+// shader storage buffer. Every frame a compute shader (gpu_cull.comp) culls all instances against the
+// frustum and the previous frame's DepthPyramid and fills one DrawElementsIndirectCommand per mesh,
+// and a single glMultiDrawElementsIndirect draws any range of those meshes with all their visible
+// instances. The CPU only touches instances when they change; the vertex shader reads the model
+// matrix of an instance from the instanceModel attribute (locations 5-8).
+class GpuDrivenScene {
+public:
+    // std430 layout of Instance in gpu_cull.comp
+    struct Instance {
+        glm::mat4 model;
+        glm::vec4 sphere;            // world space centre and radius
+        uint32_t firstCommand = 0;   // filled in by SetInstances from group
+        uint32_t commandCount = 0;
+        uint32_t flags = 0;
+        uint32_t group = 0;          // AddModel's index
+    };
+    static_assert(sizeof(Instance) == 96, "std430 layout of Instance in gpu_cull.comp");
+    enum InstanceFlag : uint32_t {
+        INSTANCE_REPLACED_BY_REFLECTION = 1   // culled while the reflective skybox draws the object instead
+    };
+
+    // glMultiDrawElementsIndirect calls since the last Cull
+    unsigned int multiDraws = 0;
+
+    GpuDrivenScene() = default;
+
+    ~GpuDrivenScene()
+    {
+        if (!cullProgram)
+            return;
+        glDeleteProgram(cullProgram);
+        GLuint buffers[] = { vertexBuffer, indexBuffer, instanceBuffer, commandTemplate, commandBuffer, visibleBuffer };
+        glDeleteBuffers(6, buffers);
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+
+    GpuDrivenScene(const GpuDrivenScene&) = delete;
+    GpuDrivenScene& operator=(const GpuDrivenScene&) = delete;
+
+    // false without a GL 4.3 context or when the culling shader did not build; `load` is the loader
+    // glad was initialized with
+    bool Create(GLADloadproc load)
+    {
+        if (GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 3)) {
+            std::cout << "ERROR::GPU_DRIVEN_SCENE:: needs an OpenGL 4.3 context, this one is "
+                      << GLVersion.major << "." << GLVersion.minor << std::endl;
+            return false;
+        }
+        dispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+        memoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+        multiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+        if (!dispatchCompute || !memoryBarrier || !multiDrawElementsIndirect) {
+            std::cout << "ERROR::GPU_DRIVEN_SCENE:: the GL 4.3 entry points are missing" << std::endl;
+            return false;
+        }
+        cullProgram = compileCompute("resources/shaders/gpu_cull.comp");
+        if (!cullProgram)
+            return false;
+        const char *names[CULL_UNIFORM_COUNT] = {
+            "instanceCount", "frustumPlanes", "skipReplacedByReflection", "occlusion", "hiZ", "hiZViewProjection",
+            "hiZSize", "hiZLevels"
+        };
+        for (int i = 0; i < CULL_UNIFORM_COUNT; i++)
+            cullUniforms[i] = glGetUniformLocation(cullProgram, names[i]);
+        glUseProgram(cullProgram);
+        glUniform1i(cullUniforms[HI_Z], 0);
+        glUseProgram(0);
+
+        glGenVertexArrays(1, &vertexArray);
+        GLuint buffers[6];
+        glGenBuffers(6, buffers);
+        vertexBuffer = buffers[0];
+        indexBuffer = buffers[1];
+        instanceBuffer = buffers[2];
+        commandTemplate = buffers[3];
+        commandBuffer = buffers[4];
+        visibleBuffer = buffers[5];
+        return true;
+    }
+
+    // appends the meshes of a model to the shared geometry, returns the model's group; call BuildGeometry after the last
+    uint32_t AddModel(const std::vector<Mesh>& meshes)
+    {
+        Group group;
+        group.firstCommand = (uint32_t)parts.size();
+        group.commandCount = (uint32_t)meshes.size();
+        for (const Mesh& mesh : meshes) {
+            Part part;
+            part.count = (uint32_t)mesh.indices.size();
+            part.firstIndex = (uint32_t)indices.size();
+            part.baseVertex = (int32_t)vertices.size();
+            parts.push_back(part);
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+        }
+        groups.push_back(group);
+        return (uint32_t)groups.size() - 1;
+    }
+
+    // uploads the geometry of all models and sets the vertex array up like Mesh does, plus instanceModel
+    void BuildGeometry()
+    {
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        const GLint sizes[] = { 3, 3, 2, 3, 3 };
+        const size_t offsets[] = { offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TexCoords),
+                                   offsetof(Vertex, Tangent), offsetof(Vertex, Bitangent) };
+        for (GLuint i = 0; i < 5; i++) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, sizes[i], GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsets[i]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        for (GLuint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(5 + column);
+            glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + column, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // the vertex array keeps the index buffer, the client copies are not needed anymore
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
+
+    // Replaces all instances. Every model gets a range of the visible instance buffer as large as
+    // its instance count, the draw commands of its meshes start there.
+    void SetInstances(const std::vector<Instance>& newInstances)
+    {
+        instances = newInstances;
+        std::vector<uint32_t> groupBase(groups.size() + 1, 0);
+        for (Instance& instance : instances) {
+            const Group& group = groups[instance.group];
+            instance.firstCommand = group.firstCommand;
+            instance.commandCount = group.commandCount;
+            groupBase[instance.group + 1]++;
+        }
+        for (size_t g = 0; g < groups.size(); g++)
+            groupBase[g + 1] += groupBase[g];
+
+        std::vector<DrawCommand> commands(parts.size());
+        for (size_t g = 0; g < groups.size(); g++)
+            for (uint32_t i = 0; i < groups[g].commandCount; i++) {
+                const Part& part = parts[groups[g].firstCommand + i];
+                DrawCommand& command = commands[groups[g].firstCommand + i];
+                command.count = part.count;
+                command.instanceCount = 0;
+                command.firstIndex = part.firstIndex;
+                command.baseVertex = part.baseVertex;
+                command.baseInstance = groupBase[g];
+            }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, commandTemplate);
+        glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, instanceBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, std::max<size_t>(1, instances.size()) * sizeof(Instance), instances.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, visibleBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, std::max<size_t>(1, instances.size()) * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    size_t InstanceCount() const { return instances.size(); }
+    size_t CommandCount() const { return parts.size(); }
+
+    // CPU copy of an instance; changes reach the GPU with UploadInstances
+    Instance& InstanceAt(size_t index) { return instances[index]; }
+
+    void UploadInstances(size_t first, size_t count)
+    {
+        if (count == 0)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, instanceBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(Instance), count * sizeof(Instance), &instances[first]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // Culls all instances and writes this frame's draw commands. `pyramid` (optional) holds the depth
+    // of the previous frame; instances it hides are culled, one frame late when they come into view.
+    void Cull(const Frustum& frustum, bool skipReplacedByReflection, const DepthPyramid *pyramid)
+    {
+        multiDraws = 0;
+        if (parts.empty())
+            return;
+        GLsizeiptr commandBytes = parts.size() * sizeof(DrawCommand);
+        glBindBuffer(GL_COPY_READ_BUFFER, commandTemplate);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commandBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (instances.empty())
+            return;
+
+        glUseProgram(cullProgram);
+        glUniform1ui(cullUniforms[INSTANCE_COUNT], (GLuint)instances.size());
+        glUniform4fv(cullUniforms[FRUSTUM_PLANES], 6, &frustum.planes[0][0]);
+        glUniform1i(cullUniforms[SKIP_REPLACED], skipReplacedByReflection);
+        bool occlusion = pyramid && pyramid->Valid();
+        glUniform1i(cullUniforms[OCCLUSION], occlusion);
+        if (occlusion) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, pyramid->Texture());
+            glUniformMatrix4fv(cullUniforms[HI_Z_VIEW_PROJECTION], 1, GL_FALSE, &pyramid->ViewProjection()[0][0]);
+            glUniform2f(cullUniforms[HI_Z_SIZE], (float)pyramid->Size().x, (float)pyramid->Size().y);
+            glUniform1i(cullUniforms[HI_Z_LEVELS], pyramid->Levels());
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBuffer);
+        dispatchCompute(((GLuint)instances.size() + 63) / 64, 1, 1);
+        // the draws read the commands and the visible instances written above
+        memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        if (occlusion)
+            glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(0);
+    }
+
+    // draws meshes [firstMesh, firstMesh + meshCount) of `group`'s model with all their visible instances
+    // in one call; the program, its textures and the DrawData slice have to be bound
+    void Draw(uint32_t group, uint32_t firstMesh, uint32_t meshCount)
+    {
+        if (meshCount == 0)
+            return;
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        GLintptr offset = (groups[group].firstCommand + firstMesh) * sizeof(DrawCommand);
+        multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *)offset, (GLsizei)meshCount, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+        multiDraws++;
+        drawStats().drawCalls++;
+    }
+
+private:
+    // DrawElementsIndirectCommand
+    struct DrawCommand {
+        uint32_t count, instanceCount, firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+    struct Part {
+        uint32_t count, firstIndex;
+        int32_t baseVertex;
+    };
+    struct Group {
+        uint32_t firstCommand, commandCount;
+    };
+    enum CullUniform {
+        INSTANCE_COUNT, FRUSTUM_PLANES, SKIP_REPLACED, OCCLUSION, HI_Z, HI_Z_VIEW_PROJECTION, HI_Z_SIZE, HI_Z_LEVELS,
+        CULL_UNIFORM_COUNT
+    };
+
+    PFNGLDISPATCHCOMPUTEPROC dispatchCompute = nullptr;
+    PFNGLMEMORYBARRIERPROC memoryBarrier = nullptr;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect = nullptr;
+    GLuint cullProgram = 0;
+    GLint cullUniforms[CULL_UNIFORM_COUNT];
+    GLuint vertexArray = 0;
+    GLuint vertexBuffer = 0, indexBuffer = 0, instanceBuffer = 0, commandTemplate = 0, commandBuffer = 0, visibleBuffer = 0;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Part> parts;
+    std::vector<Group> groups;
+    std::vector<Instance> instances;
+
+    static GLuint compileCompute(const char *path)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::GPU_DRIVEN_SCENE:: cannot read " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char *text = code.c_str();
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        GLint success = 0;
+        GLchar log[1024];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::GPU_DRIVEN_SCENE:: " << path << " does not compile\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cout << "ERROR::GPU_DRIVEN_SCENE:: " << path << " does not link\n" << log << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_GPUDRIVENSCENE_H
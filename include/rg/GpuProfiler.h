@@ -0,0 +1,169 @@
+#ifndef PROJECT_BASE_GPUPROFILER_H
+#define PROJECT_BASE_GPUPROFILER_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <vector>
+
+namespace rg {
+
+// GPU time of the logical passes of a frame. Every BeginPass/EndPass writes a GL_TIMESTAMP with
+// glQueryCounter, so passes may nest (unlike GL_TIME_ELAPSED queries, of which only one can be
+// active) and a pass that runs several times per frame is summed. The queries of a frame are read
+// back LATENCY frames later and only if the GPU already finished them; a frame that is not ready
+// yet is dropped instead of waiting, so the profiler never stalls the pipeline.
+class GpuPassProfiler {
+public:
+    static const int LATENCY = 3;
+    static const int MAX_RECORDS = 64;
+    static const int HISTORY = 120;
+
+    struct Pass {
+        const char *name;
+        int depth;
+        float history[HISTORY];   // ms, oldest first
+        float lastMilliseconds;
+        float averageMilliseconds;
+    };
+
+    GpuPassProfiler()
+    {
+        for (int i = 0; i < LATENCY; i++)
+            glGenQueries(MAX_RECORDS * 2, frames[i].queries);
+    }
+
+    ~GpuPassProfiler()
+    {
+        for (int i = 0; i < LATENCY; i++)
+            glDeleteQueries(MAX_RECORDS * 2, frames[i].queries);
+    }
+
+    GpuPassProfiler(const GpuPassProfiler&) = delete;
+    GpuPassProfiler& operator=(const GpuPassProfiler&) = delete;
+
+    // starts recording into the next frame slot, reading back what was recorded there before
+    void BeginFrame()
+    {
+        current = (current + 1) % LATENCY;
+        Frame& frame = frames[current];
+        if (frame.recordCount > 0)
+            readBack(frame);
+        frame.recordCount = 0;
+        frame.openRecords.clear();
+    }
+
+    // `name` must outlive the profiler, passes are identified by it
+    void BeginPass(const char *name)
+    {
+        Frame& frame = frames[current];
+        if (frame.recordCount == MAX_RECORDS) {
+            // out of queries, the matching EndPass is ignored
+            frame.openRecords.push_back(-1);
+            return;
+        }
+        int record = frame.recordCount++;
+        frame.passes[record] = passIndex(name, (int)frame.openRecords.size());
+        glQueryCounter(frame.queries[record * 2], GL_TIMESTAMP);
+        frame.lastQuery = record * 2;
+        frame.openRecords.push_back(record);
+    }
+
+    void EndPass()
+    {
+        Frame& frame = frames[current];
+        if (frame.openRecords.empty())
+            return;
+        int record = frame.openRecords.back();
+        frame.openRecords.pop_back();
+        if (record < 0)
+            return;
+        frame.lastQuery = record * 2 + 1;
+        glQueryCounter(frame.queries[frame.lastQuery], GL_TIMESTAMP);
+    }
+
+    const std::vector<Pass>& Passes() const { return passes; }
+    unsigned int DroppedFrames() const { return droppedFrames; }
+
+private:
+    struct Frame {
+        GLuint queries[MAX_RECORDS * 2];
+        int passes[MAX_RECORDS];
+        int recordCount = 0;
+        int lastQuery = 0;   // the last timestamp written
+        std::vector<int> openRecords;
+    };
+
+    Frame frames[LATENCY];
+    int current = 0;
+    std::vector<Pass> passes;
+    std::vector<double> milliseconds;   // readBack's per pass sums, only grows with new passes
+    unsigned int droppedFrames = 0;
+
+    int passIndex(const char *name, int depth)
+    {
+        for (size_t i = 0; i < passes.size(); i++)
+            if (passes[i].name == name || std::strcmp(passes[i].name, name) == 0)
+                return (int)i;
+        Pass pass = {};
+        pass.name = name;
+        pass.depth = depth;
+        passes.push_back(pass);
+        return (int)passes.size() - 1;
+    }
+
+    void readBack(Frame& frame)
+    {
+        // timestamps complete in order, so the last one being available means all of them are
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available || !frame.openRecords.empty()) {
+            droppedFrames++;
+            return;
+        }
+
+        milliseconds.assign(passes.size(), 0.0);
+        for (int i = 0; i < frame.recordCount; i++) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+            if (end > begin)
+                milliseconds[frame.passes[i]] += (double)(end - begin) / 1.0e6;
+        }
+        for (size_t p = 0; p < passes.size(); p++) {
+            Pass& pass = passes[p];
+            std::memmove(pass.history, pass.history + 1, (HISTORY - 1) * sizeof(float));
+            pass.history[HISTORY - 1] = (float)milliseconds[p];
+            pass.lastMilliseconds = (float)milliseconds[p];
+            float sum = 0.0f;
+            for (float ms : pass.history)
+                sum += ms;
+            pass.averageMilliseconds = sum / (float)HISTORY;
+        }
+    }
+};
+
+// BeginPass/EndPass for the enclosing scope
+class GpuPassScope {
+public:
+    GpuPassScope(GpuPassProfiler& profiler, const char *name)
+        : profiler(profiler)
+    {
+        profiler.BeginPass(name);
+    }
+
+    ~GpuPassScope()
+    {
+        profiler.EndPass();
+    }
+
+    GpuPassScope(const GpuPassScope&) = delete;
+    GpuPassScope& operator=(const GpuPassScope&) = delete;
+
+private:
+    GpuPassProfiler& profiler;
+};
+
+}
+
+#endif //PROJECT_BASE_GPUPROFILER_H
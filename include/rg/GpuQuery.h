@@ -0,0 +1,58 @@
+#ifndef PROJECT_BASE_GPUQUERY_H
+#define PROJECT_BASE_GPUQUERY_H
+
+#include <glad/glad.h>
+
+namespace rg {
+
+// Ring of GL query objects for one target, e.g. GL_TIME_ELAPSED (nanoseconds) or
+// GL_SAMPLES_PASSED (samples that passed the depth test, i.e. were shaded). Every Begin/End pair
+// uses the next query object and the result of a query is only read back when its object comes
+// around again LATENCY pairs later, so reading never waits for the GPU to catch up.
+class GpuQuery {
+public:
+    static const int LATENCY = 3;
+
+    explicit GpuQuery(GLenum target)
+        : target(target)
+    {
+        glGenQueries(LATENCY, queries);
+    }
+
+    ~GpuQuery()
+    {
+        glDeleteQueries(LATENCY, queries);
+    }
+
+    GpuQuery(const GpuQuery&) = delete;
+    GpuQuery& operator=(const GpuQuery&) = delete;
+
+    void Begin()
+    {
+        if (issued[current])
+            glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &result);
+        glBeginQuery(target, queries[current]);
+    }
+
+    void End()
+    {
+        glEndQuery(target);
+        issued[current] = true;
+        current = (current + 1) % LATENCY;
+    }
+
+    // most recent result that has been read back, LATENCY - 1 frames old
+    GLuint64 Result() const { return result; }
+    double Milliseconds() const { return (double)result / 1.0e6; }
+
+private:
+    GLenum target;
+    GLuint queries[LATENCY];
+    bool issued[LATENCY] = {};
+    int current = 0;
+    GLuint64 result = 0;
+};
+
+}
+
+#endif //PROJECT_BASE_GPUQUERY_H
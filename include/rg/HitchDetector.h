@@ -0,0 +1,163 @@
+#ifndef PROJECT_BASE_HITCHDETECTOR_H
+#define PROJECT_BASE_HITCHDETECTOR_H
+
+#include <rg/AllocTracker.h>
+#include <rg/DrawStats.h>
+#include <rg/Profiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Rolling frame time monitor. A frame longer than `thresholdMultiple` times the median of the
+// recent frames is a hitch; for each one the last `captureFrames` frames are written to
+// hitch_<frame>.json: frame times, draw/state counters, heap allocations (RG_ALLOC_TRACKER) and
+// the profiler zones (RG_PROFILER) as Chrome trace events, so the file opens in chrome://tracing.
+// Nothing is dumped while AllocTracker expects no allocations.
+class HitchDetector {
+public:
+    static const int HISTORY = 240;
+    static const int MIN_FRAMES = 30;   // frames needed before the median means anything
+
+    bool enabled = true;
+    float thresholdMultiple = 2.5f;
+    float minimumMilliseconds = 4.0f;   // shorter frames are never hitches, however small the median
+    int captureFrames = 60;
+    int cooldownFrames = 60;            // no new dump this many frames after one
+    int maxDumps = 20;
+
+    // statistics
+    unsigned int hitches = 0;
+    unsigned int dumps = 0;
+    float lastHitchMilliseconds = 0.0f;
+    float lastHitchMedian = 0.0f;
+    std::string lastDumpPath;
+
+    HitchDetector()
+    {
+        sorted.reserve(HISTORY);
+    }
+
+    // closes the current frame, call once per frame after the profiler, allocation tracker and draw
+    // stats frame marks so their last frame is the one measured here
+    void FrameMark()
+    {
+        Clock::time_point now = Clock::now();
+        if (!started) {
+            started = true;
+            frameStart = now;
+            return;
+        }
+        Frame& frame = frames[frameCount % HISTORY];
+        frame.index = frameCount;
+        frame.milliseconds = std::chrono::duration<float, std::milli>(now - frameStart).count();
+        frame.stats = drawStatsLog().Empty() ? DrawStats() : drawStatsLog().Last();
+#ifdef RG_ALLOC_TRACKER
+        frame.allocations = AllocTracker::LastFrame();
+#endif
+        frameStart = now;
+        frameCount++;
+
+        if (cooldown > 0)
+            cooldown--;
+        if (!enabled || frameCount < (uint64_t)MIN_FRAMES)
+            return;
+        median = medianMilliseconds();
+        if (frame.milliseconds < minimumMilliseconds || frame.milliseconds < thresholdMultiple * median)
+            return;
+
+        hitches++;
+        lastHitchMilliseconds = frame.milliseconds;
+        lastHitchMedian = median;
+#ifdef RG_ALLOC_TRACKER
+        // the dump allocates, which would trip the steady state assertion; the hitch is still counted
+        if (AllocTracker::ExpectingNoAllocations())
+            return;
+#endif
+        if (cooldown == 0 && dumps < (unsigned int)maxDumps) {
+            Dump("hitch_" + std::to_string(frame.index) + ".json");
+            cooldown = cooldownFrames;
+        }
+    }
+
+    float Median() const { return median; }
+
+    bool Dump(const std::string& path)
+    {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::HITCH_DETECTOR:: could not write " << path << std::endl;
+            return false;
+        }
+        int count = (int)std::min<uint64_t>((uint64_t)std::max(captureFrames, 1), std::min<uint64_t>(frameCount, HISTORY));
+        const Frame& hitch = frames[(frameCount - 1) % HISTORY];
+        out << "{\"hitch\":{\"frame\":" << hitch.index << ",\"ms\":" << hitch.milliseconds
+            << ",\"median_ms\":" << median << ",\"threshold_multiple\":" << thresholdMultiple << "},\n\"frames\":[\n";
+        for (int i = count; i >= 1; i--) {
+            const Frame& frame = frames[(frameCount - (uint64_t)i) % HISTORY];
+            const DrawStats& s = frame.stats;
+            out << "{\"frame\":" << frame.index << ",\"ms\":" << frame.milliseconds
+                << ",\"draw_calls\":" << s.drawCalls << ",\"triangles\":" << s.triangles
+                << ",\"program_binds\":" << s.programBinds << ",\"texture_binds\":" << s.textureBinds
+                << ",\"vertex_array_binds\":" << s.vertexArrayBinds << ",\"uniform_calls\":" << s.uniformCalls
+                << ",\"buffer_bytes\":" << s.bufferBytes
+                << ",\"allocations\":" << frame.allocations.allocations << ",\"allocated_bytes\":" << frame.allocations.bytes
+                << "}" << (i > 1 ? ",\n" : "\n");
+        }
+        out << "],\n\"traceEvents\":";
+#ifdef RG_PROFILER
+        uint64_t start, end;
+        Profiler& profiler = Profiler::Get();
+        if (profiler.LastFrames(count, start, end))
+            Profiler::WriteTraceEvents(out, profiler.Collect(start, end + 1));
+        else
+            out << "[]";
+#else
+        out << "[]";
+#endif
+        out << ",\"displayTimeUnit\":\"ms\"}\n";
+        dumps++;
+        lastDumpPath = path;
+        std::cout << "HITCH_DETECTOR:: frame " << hitch.index << " took " << hitch.milliseconds << " ms (median "
+                  << median << " ms), wrote " << path << std::endl;
+        return true;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Frame {
+        uint64_t index = 0;
+        float milliseconds = 0.0f;
+        DrawStats stats;
+        AllocationCounters allocations;
+    };
+
+    Frame frames[HISTORY];
+    uint64_t frameCount = 0;
+    bool started = false;
+    Clock::time_point frameStart;
+    int cooldown = 0;
+    float median = 0.0f;
+    std::vector<float> sorted;
+
+    // median of the frames before the newest one
+    float medianMilliseconds()
+    {
+        sorted.clear();
+        uint64_t count = std::min<uint64_t>(frameCount - 1, HISTORY - 1);
+        for (uint64_t i = 2; i <= count + 1; i++)
+            sorted.push_back(frames[(frameCount - i) % HISTORY].milliseconds);
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_HITCHDETECTOR_H
@@ -0,0 +1,239 @@
+#ifndef PROJECT_BASE_INPUTRECORDING_H
+#define PROJECT_BASE_INPUTRECORDING_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Binary input recordings (.rgin). Layout, all values little endian as written by the host:
+//   header:  "RGIN" u32 version, u32 cameraSize, camera bytes, u32 settingsSize, settings bytes
+//   records: u8 tag followed by
+//     FRAME     f32 time, f32 deltaTime, u32 held key mask   (start of a frame)
+//     SETTINGS  settingsSize bytes                            (only when they changed)
+//     KEY       i32 key, i32 scancode, u8 action, u8 mods
+//     CURSOR    f64 x, f64 y
+//     SCROLL    f64 x, f64 y
+//     END
+// The camera and settings blobs are opaque to the recorder, the application decides what state a
+// replay has to start from and what GUI edits it has to reproduce.
+enum InputRecordTag : uint8_t {
+    INPUT_FRAME = 1,
+    INPUT_SETTINGS = 2,
+    INPUT_KEY = 3,
+    INPUT_CURSOR = 4,
+    INPUT_SCROLL = 5,
+    INPUT_END = 6
+};
+
+struct InputEvent {
+    InputRecordTag tag;
+    int key, scancode, action, mods;   // INPUT_KEY
+    double x, y;                       // INPUT_CURSOR, INPUT_SCROLL
+};
+
+class InputRecorder {
+public:
+    static const uint32_t VERSION = 1;
+
+    ~InputRecorder()
+    {
+        Close();
+    }
+
+    bool Open(const std::string& path, const void *camera, uint32_t cameraSize, const void *settings, uint32_t settingsSize)
+    {
+        out.open(path, std::ios::binary);
+        if (!out) {
+            std::cout << "ERROR::INPUT_RECORDER:: could not write " << path << std::endl;
+            return false;
+        }
+        out.write("RGIN", 4);
+        put(VERSION);
+        put(cameraSize);
+        out.write((const char *)camera, cameraSize);
+        put(settingsSize);
+        out.write((const char *)settings, settingsSize);
+        lastSettings.assign((const char *)settings, (const char *)settings + settingsSize);
+        return true;
+    }
+
+    bool IsOpen() const { return out.is_open(); }
+
+    void Frame(float time, float deltaTime, uint32_t heldKeys)
+    {
+        put(INPUT_FRAME);
+        put(time);
+        put(deltaTime);
+        put(heldKeys);
+    }
+
+    // records `settings` if they differ from the last recorded ones
+    void Settings(const void *settings)
+    {
+        if (std::memcmp(settings, lastSettings.data(), lastSettings.size()) == 0)
+            return;
+        std::memcpy(lastSettings.data(), settings, lastSettings.size());
+        put(INPUT_SETTINGS);
+        out.write(lastSettings.data(), (std::streamsize)lastSettings.size());
+    }
+
+    void Key(int key, int scancode, int action, int mods)
+    {
+        put(INPUT_KEY);
+        put((int32_t)key);
+        put((int32_t)scancode);
+        put((uint8_t)action);
+        put((uint8_t)mods);
+    }
+
+    void Cursor(double x, double y)
+    {
+        put(INPUT_CURSOR);
+        put(x);
+        put(y);
+    }
+
+    void Scroll(double x, double y)
+    {
+        put(INPUT_SCROLL);
+        put(x);
+        put(y);
+    }
+
+    void Close()
+    {
+        if (!out.is_open())
+            return;
+        put(INPUT_END);
+        out.close();
+    }
+
+private:
+    std::ofstream out;
+    std::vector<char> lastSettings;
+
+    template<typename T>
+    void put(const T& value)
+    {
+        out.write((const char *)&value, sizeof(T));
+    }
+};
+
+// Plays a recording back from memory, the whole file is read in Open.
+class InputReplay {
+public:
+    // fills `camera` and `settings` with the state the recording started from; fails if the sizes
+    // differ from the recording's (recorded by an incompatible build)
+    bool Open(const std::string& path, void *camera, uint32_t cameraSize, void *settings, uint32_t settingsSize)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cout << "ERROR::INPUT_REPLAY:: could not read " << path << std::endl;
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        offset = 0;
+        uint32_t version = 0, recordedCameraSize = 0, recordedSettingsSize = 0;
+        if (data.size() < 4 || std::memcmp(data.data(), "RGIN", 4) != 0) {
+            std::cout << "ERROR::INPUT_REPLAY:: " << path << " is not an input recording" << std::endl;
+            return false;
+        }
+        offset = 4;
+        if (!get(version) || version != InputRecorder::VERSION || !get(recordedCameraSize) || recordedCameraSize != cameraSize ||
+            !getBytes(camera, cameraSize) || !get(recordedSettingsSize) || recordedSettingsSize != settingsSize ||
+            !getBytes(settings, settingsSize)) {
+            std::cout << "ERROR::INPUT_REPLAY:: " << path << " was recorded by an incompatible build" << std::endl;
+            return false;
+        }
+        this->settings = settings;
+        this->settingsSize = settingsSize;
+        finished = false;
+        return true;
+    }
+
+    bool Finished() const { return finished; }
+    uint64_t Frame() const { return frame; }
+
+    // reads the next FRAME record, false at the end of the recording
+    bool NextFrame(float& time, float& deltaTime, uint32_t& heldKeys)
+    {
+        uint8_t tag = 0;
+        if (finished || !get(tag) || tag != INPUT_FRAME || !get(time) || !get(deltaTime) || !get(heldKeys)) {
+            finished = true;
+            return false;
+        }
+        this->heldKeys = heldKeys;
+        frame++;
+        return true;
+    }
+
+    bool KeyHeld(uint32_t bit) const { return (heldKeys & (1u << bit)) != 0; }
+
+    // replays everything recorded up to the next frame: settings are copied into the settings
+    // blob given to Open before the handler sees them, events go to handler(const InputEvent&)
+    template<typename Handler>
+    void DispatchEvents(Handler&& handler)
+    {
+        while (!finished && offset < data.size() && (uint8_t)data[offset] != INPUT_FRAME) {
+            uint8_t tag = 0;
+            get(tag);
+            InputEvent event = {};
+            event.tag = (InputRecordTag)tag;
+            bool ok = true;
+            if (tag == INPUT_SETTINGS)
+                ok = getBytes(settings, settingsSize);
+            else if (tag == INPUT_KEY) {
+                int32_t key, scancode;
+                uint8_t action, mods;
+                ok = get(key) && get(scancode) && get(action) && get(mods);
+                event.key = key;
+                event.scancode = scancode;
+                event.action = action;
+                event.mods = mods;
+            }
+            else if (tag == INPUT_CURSOR || tag == INPUT_SCROLL)
+                ok = get(event.x) && get(event.y);
+            else
+                ok = false;   // INPUT_END or garbage
+            if (!ok) {
+                finished = true;
+                return;
+            }
+            handler(event);
+        }
+    }
+
+private:
+    std::vector<char> data;
+    size_t offset = 0;
+    void *settings = nullptr;
+    uint32_t settingsSize = 0;
+    uint32_t heldKeys = 0;
+    uint64_t frame = 0;
+    bool finished = true;
+
+    bool getBytes(void *out, size_t size)
+    {
+        if (offset + size > data.size())
+            return false;
+        std::memcpy(out, data.data() + offset, size);
+        offset += size;
+        return true;
+    }
+
+    template<typename T>
+    bool get(T& value)
+    {
+        return getBytes(&value, sizeof(T));
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_INPUTRECORDING_H
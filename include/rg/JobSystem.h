@@ -0,0 +1,227 @@
+#ifndef PROJECT_BASE_JOBSYSTEM_H
+#define PROJECT_BASE_JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+struct Job;
+
+// Counts the unfinished jobs of a group. Run increments it, the job decrements it when it finished;
+// a counter that reaches zero releases the jobs that were queued with it as their dependency, which
+// is how a frame's work is chained into a graph. Reusable once it is back at zero.
+struct JobCounter {
+    std::atomic<int> pending{0};
+
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::mutex lock;
+    Job *waiting = nullptr;   // jobs released when pending reaches zero
+};
+
+struct Job {
+    void (*function)(void *data, uint32_t begin, uint32_t end);
+    void *data;
+    uint32_t begin, end;
+    JobCounter *counter;
+    Job *next;
+};
+
+// Fixed size work-stealing thread pool. Every thread (the main thread is thread 0) owns a deque of
+// runnable jobs: it pushes and pops its own jobs at the back, idle threads steal from the front of
+// the others'. Jobs are plain function pointers with a data pointer and an index range taken from
+// per-thread rings, so queuing a job never allocates; a thread may have at most JOB_RING_SIZE jobs
+// queued and not yet finished. The main thread runs jobs while it Waits instead of blocking.
+class JobSystem {
+public:
+    static const int JOB_RING_SIZE = 4096;
+
+    // threadCount includes the main thread, 0 uses every hardware thread; must be created on the main thread
+    explicit JobSystem(int threadCount = 0)
+    {
+        if (threadCount <= 0)
+            threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+        queues = std::vector<Queue>(threadCount);
+        ThreadIndex() = 0;
+        for (int i = 1; i < threadCount; i++)
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int ThreadCount() const { return (int)queues.size(); }
+
+    // index of the calling thread in [0, ThreadCount()), for per-thread output buffers
+    static int& ThreadIndex()
+    {
+        thread_local int index = 0;
+        return index;
+    }
+
+    // Queues function(data, begin, end). The job starts once `dependency` (optional) is done and
+    // counts towards `counter` until it finished.
+    void Run(void (*function)(void *, uint32_t, uint32_t), void *data, uint32_t begin, uint32_t end,
+             JobCounter& counter, JobCounter *dependency = nullptr)
+    {
+        Queue& queue = queues[ThreadIndex()];
+        Job& job = queue.ring[queue.ringNext++ % JOB_RING_SIZE];
+        job.function = function;
+        job.data = data;
+        job.begin = begin;
+        job.end = end;
+        job.counter = &counter;
+        job.next = nullptr;
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        if (dependency) {
+            std::lock_guard<std::mutex> guard(dependency->lock);
+            if (!dependency->Done()) {
+                job.next = dependency->waiting;
+                dependency->waiting = &job;
+                return;
+            }
+        }
+        push(job);
+    }
+
+    // splits [0, count) into ranges of at most `grain` and queues a job for each
+    void ParallelFor(uint32_t count, uint32_t grain, void (*function)(void *, uint32_t, uint32_t), void *data,
+                     JobCounter& counter, JobCounter *dependency = nullptr)
+    {
+        grain = std::max(1u, grain);
+        for (uint32_t begin = 0; begin < count; begin += grain)
+            Run(function, data, begin, std::min(count, begin + grain), counter, dependency);
+    }
+
+    // runs queued jobs on the calling thread until `counter` is done
+    void Wait(JobCounter& counter)
+    {
+        int self = ThreadIndex();
+        while (!counter.Done()) {
+            Job *job = take(self);
+            if (job)
+                execute(*job);
+            else
+                std::this_thread::yield();
+        }
+        std::lock_guard<std::mutex> guard(counter.lock);
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::vector<Job *> jobs = std::vector<Job *>(JOB_RING_SIZE);
+        uint32_t front = 0, back = 0;   // jobs[front % size] .. jobs[(back - 1) % size]
+        std::vector<Job> ring = std::vector<Job>(JOB_RING_SIZE);
+        uint32_t ringNext = 0;          // only touched by the owning thread
+    };
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    // jobs sitting in a deque; idle workers sleep until it is non-zero
+    std::atomic<int> queued{0};
+    std::atomic<int> sleeping{0};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void push(Job& job)
+    {
+        Queue& queue = queues[ThreadIndex()];
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.back - queue.front == (uint32_t)JOB_RING_SIZE) {
+                std::cout << "ERROR::JOB_SYSTEM:: more than " << JOB_RING_SIZE << " jobs queued on one thread" << std::endl;
+                std::abort();
+            }
+            queue.jobs[queue.back++ % JOB_RING_SIZE] = &job;
+        }
+        queued.fetch_add(1);
+        if (sleeping.load() > 0) {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            wake.notify_one();
+        }
+    }
+
+    // the newest job of the own deque, else the oldest of another thread's
+    Job *take(int self)
+    {
+        int count = ThreadCount();
+        for (int i = 0; i < count; i++) {
+            int victim = (self + i) % count;
+            Queue& queue = queues[victim];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.front == queue.back)
+                continue;
+            Job *job = victim == self ? queue.jobs[--queue.back % JOB_RING_SIZE] : queue.jobs[queue.front++ % JOB_RING_SIZE];
+            queued.fetch_sub(1);
+            return job;
+        }
+        return nullptr;
+    }
+
+    void execute(Job& job)
+    {
+        job.function(job.data, job.begin, job.end);
+        // decremented under the lock: Wait takes it before returning, so the counter is not touched
+        // here after its owner saw it done and possibly destroyed it
+        Job *released = nullptr;
+        {
+            JobCounter& counter = *job.counter;
+            std::lock_guard<std::mutex> guard(counter.lock);
+            if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                released = counter.waiting;
+                counter.waiting = nullptr;
+            }
+        }
+        // the group is done, release whatever waited for it
+        while (released) {
+            Job *next = released->next;
+            push(*released);
+            released = next;
+        }
+    }
+
+    void workerLoop(int index)
+    {
+        ThreadIndex() = index;
+        for (;;) {
+            Job *job = take(index);
+            if (job) {
+                execute(*job);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            sleeping.fetch_add(1);
+            wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+            sleeping.fetch_sub(1);
+            if (stopping)
+                return;
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_JOBSYSTEM_H
@@ -0,0 +1,150 @@
+#ifndef PROJECT_BASE_LIGHTCULLING_H
+#define PROJECT_BASE_LIGHTCULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/ClusteredLights.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rg {
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// Bounding sphere of `local` after transforming it with `model`, the radius is scaled by the
+// largest axis scale so the result stays conservative for non-uniform scales.
+inline BoundingSphere transformSphere(const glm::mat4& model, const BoundingSphere& local) {
+    BoundingSphere sphere;
+    sphere.center = glm::vec3(model * glm::vec4(local.center, 1.0f));
+    float scaleSq = std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                    std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                             glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))));
+    sphere.radius = local.radius * std::sqrt(scaleSq);
+    return sphere;
+}
+
+// The six planes of a view frustum, normalized and facing inwards.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// planes of projection * view, taken from the rows of the matrix
+inline Frustum makeFrustum(const glm::mat4& viewProjection) {
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    Frustum frustum;
+    for (int axis = 0; axis < 3; axis++) {
+        frustum.planes[axis * 2] = rows[3] + rows[axis];
+        frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+inline bool sphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere) {
+    for (const glm::vec4& plane : frustum.planes)
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    return true;
+}
+
+// Does the light reach any point of `sphere`? Point lights are a sphere of light.range, spot lights
+// additionally test the sphere against the outer cone.
+inline bool lightTouchesSphere(const LightData& light, const BoundingSphere& sphere) {
+    glm::vec3 toSphere = sphere.center - light.position;
+    float reach = light.range + sphere.radius;
+    float distSq = glm::dot(toSphere, toSphere);
+    if (distSq > reach * reach)
+        return false;
+    if (light.type != LIGHT_TYPE_SPOT)
+        return true;
+
+    // distance from the sphere centre to the cone surface, measured perpendicular to it
+    float alongAxis = glm::dot(toSphere, light.direction);
+    float cosAngle = light.outerCutOff;
+    float sinAngle = std::sqrt(std::max(0.0f, 1.0f - cosAngle * cosAngle));
+    float fromAxis = std::sqrt(std::max(0.0f, distSq - alongAxis * alongAxis));
+    float outsideCone = cosAngle * fromAxis - sinAngle * alongAxis;
+    return outsideCone <= sphere.radius && alongAxis >= -sphere.radius;
+}
+
+// Per draw light lists for the forward shader. For each draw the lights whose range (and spot
+// cone) reaches the object's bounding sphere are gathered on the CPU and written into the draw's
+// DrawData block as a small array, so the fragment shader skips the froxel lookup and every light that cannot touch the
+// object. Objects touched by more than MAX_OBJECT_LIGHTS lights fall back to the clustered lists.
+class ObjectLightCuller {
+public:
+    // must match MAX_OBJECT_LIGHTS in rb_bear_shader.fs
+    static const int MAX_OBJECT_LIGHTS = 16;
+
+    bool enabled = true;
+
+    // statistics since the last SetLights
+    unsigned int draws = 0;
+    unsigned int clusteredDraws = 0;
+    unsigned int assignedLights = 0;
+
+    // `lights` must be the list uploaded into the light texture buffer, indices refer into it
+    void SetLights(const std::vector<LightData>& lights)
+    {
+        this->lights = &lights;
+        draws = clusteredDraws = assignedLights = 0;
+    }
+
+    // Appends the indices of the lights touching `bounds` to `out`. When `candidates` is given only
+    // those lights are tested, which lets a group of objects be culled hierarchically.
+    void Gather(const BoundingSphere& bounds, std::vector<int>& out, const std::vector<int>* candidates = nullptr) const
+    {
+        if (candidates) {
+            for (int index : *candidates)
+                if (lightTouchesSphere((*lights)[index], bounds))
+                    out.push_back(index);
+            return;
+        }
+        for (int i = 0; i < (int)lights->size(); i++)
+            if (lightTouchesSphere((*lights)[i], bounds))
+                out.push_back(i);
+    }
+
+    // Writes the indices of the lights for an object with the given bounds to `indices` and returns
+    // their count, or -1 when the froxel lists are to be used. Leaves the statistics alone, so jobs
+    // can select the lists of many objects at once and report them with AddStatistics.
+    int Select(const BoundingSphere& bounds, int *indices, const std::vector<int>* candidates = nullptr) const
+    {
+        if (!enabled)
+            return -1;
+        int count = 0;
+        int candidateCount = candidates ? (int)candidates->size() : (int)lights->size();
+        for (int i = 0; i < candidateCount; i++) {
+            int index = candidates ? (*candidates)[i] : i;
+            if (!lightTouchesSphere((*lights)[index], bounds))
+                continue;
+            if (count == MAX_OBJECT_LIGHTS)
+                return -1;
+            indices[count++] = index;
+        }
+        return count;
+    }
+
+    void AddStatistics(unsigned int drawCount, unsigned int clusteredDrawCount, unsigned int assignedLightCount)
+    {
+        draws += drawCount;
+        clusteredDraws += clusteredDrawCount;
+        assignedLights += assignedLightCount;
+    }
+
+private:
+    const std::vector<LightData>* lights = nullptr;
+};
+
+}
+
+#endif //PROJECT_BASE_LIGHTCULLING_H
@@ -0,0 +1,283 @@
+#ifndef PROJECT_BASE_MESHLETS_H
+#define PROJECT_BASE_MESHLETS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace rg {
+
+// Meshlets: a mesh's triangles split into small clusters of at most MESHLET_MAX_VERTICES vertices
+// and MESHLET_MAX_TRIANGLES triangles, each with a bounding sphere and a normal cone, so the parts of
+// a mesh that are off screen or face away from the camera can be skipped instead of the whole mesh or
+// nothing.
+// buildMeshlets reorders the index buffer so every meshlet is a contiguous range of it; visible
+// meshlets that follow each other are drawn as one range.
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// meshlet ranges of an index buffer and their bounds in model space, structure-of-arrays padded to a
+// multiple of 4 so MeshletSet::Cull tests four meshlets at once with SSE
+struct MeshletSet {
+    std::vector<uint32_t> firstIndex, indexCount;
+    std::vector<float> centerX, centerY, centerZ, radius;
+    // a meshlet faces away from every camera position p with
+    // dot(center - p, axis) >= cutoff * length(center - p) + radius; cutoff 1 disables the test
+    std::vector<float> axisX, axisY, axisZ, cutoff;
+    // meshlets without the padding
+    uint32_t count = 0;
+
+    struct Range {
+        uint32_t firstIndex, indexCount;
+    };
+
+    // statistics of one Cull call
+    struct CullStats {
+        uint32_t tested = 0, frustumCulled = 0, coneCulled = 0, trianglesDrawn = 0;
+    };
+
+    // Replaces `ranges` with the index ranges of the meshlets inside the six `planes` (normalized, model
+    // space) and, with `cones`, not facing away from `camera` (model space), neighbours merged. Only
+    // valid for similarity transforms: the model matrix may rotate and scale, but uniformly.
+    void Cull(const glm::vec4 planes[6], const glm::vec3& camera, bool cones, std::vector<Range>& ranges,
+              CullStats& stats) const
+    {
+        ranges.clear();
+        stats.tested += count;
+        for (uint32_t base = 0; base < count; base += 4) {
+            int frustumMask, coneMask;   // bit i: meshlet base + i is visible to that test
+            testFour(base, planes, camera, cones, frustumMask, coneMask);
+            for (uint32_t i = base; i < std::min(base + 4, count); i++) {
+                int bit = 1 << (i - base);
+                if (!(frustumMask & bit)) {
+                    stats.frustumCulled++;
+                    continue;
+                }
+                if (!(coneMask & bit)) {
+                    stats.coneCulled++;
+                    continue;
+                }
+                stats.trianglesDrawn += indexCount[i] / 3;
+                if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == firstIndex[i])
+                    ranges.back().indexCount += indexCount[i];
+                else
+                    ranges.push_back({ firstIndex[i], indexCount[i] });
+            }
+        }
+    }
+
+private:
+    void testFour(uint32_t base, const glm::vec4 planes[6], const glm::vec3& camera, bool cones,
+                  int& frustumMask, int& coneMask) const
+    {
+#ifdef __SSE2__
+        __m128 x = _mm_loadu_ps(&centerX[base]), y = _mm_loadu_ps(&centerY[base]), z = _mm_loadu_ps(&centerZ[base]);
+        __m128 r = _mm_loadu_ps(&radius[base]);
+        __m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p].x)), _mm_mul_ps(y, _mm_set1_ps(planes[p].y))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeR));
+        }
+        frustumMask = _mm_movemask_ps(inside);
+        coneMask = 0xf;
+        if (cones) {
+            __m128 dx = _mm_sub_ps(x, _mm_set1_ps(camera.x)), dy = _mm_sub_ps(y, _mm_set1_ps(camera.y));
+            __m128 dz = _mm_sub_ps(z, _mm_set1_ps(camera.z));
+            __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&axisX[base])), _mm_mul_ps(dy, _mm_loadu_ps(&axisY[base]))),
+                                      _mm_mul_ps(dz, _mm_loadu_ps(&axisZ[base])));
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[base]), length), r);
+            coneMask = ~_mm_movemask_ps(_mm_cmpge_ps(along, limit)) & 0xf;
+        }
+#else
+        frustumMask = coneMask = 0;
+        for (int i = 0; i < 4; i++) {
+            glm::vec3 center(centerX[base + i], centerY[base + i], centerZ[base + i]);
+            bool inside = true;
+            for (int p = 0; p < 6; p++)
+                if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius[base + i])
+                    inside = false;
+            if (inside)
+                frustumMask |= 1 << i;
+            glm::vec3 toCenter = center - camera;
+            glm::vec3 axis(axisX[base + i], axisY[base + i], axisZ[base + i]);
+            if (!cones || glm::dot(toCenter, axis) < cutoff[base + i] * glm::length(toCenter) + radius[base + i])
+                coneMask |= 1 << i;
+        }
+#endif
+    }
+};
+
+// Splits the triangles of `indices` into meshlets and reorders `indices` so each is a contiguous
+// range. A meshlet grows from the first unused triangle by adding the neighbouring triangle that
+// brings the fewest new vertices, preferring the one whose normal is closest to the meshlet's, so the
+// meshlets stay compact and their normal cones narrow. VertexT needs a glm::vec3 Position.
+template<typename VertexT>
+MeshletSet buildMeshlets(const std::vector<VertexT>& vertices, std::vector<unsigned int>& indices)
+{
+    MeshletSet set;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertices.empty())
+        return set;
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        glm::vec3 a = vertices[indices[t * 3]].Position, b = vertices[indices[t * 3 + 1]].Position;
+        glm::vec3 c = vertices[indices[t * 3 + 2]].Position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    // triangles using each vertex
+    std::vector<uint32_t> adjacencyStart(vertices.size() + 1, 0), adjacency(triangleCount * 3);
+    for (unsigned int index : indices)
+        adjacencyStart[index + 1]++;
+    for (size_t v = 0; v < vertices.size(); v++)
+        adjacencyStart[v + 1] += adjacencyStart[v];
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+
+    std::vector<char> used(triangleCount, 0);
+    // meshlet the vertex was last added to, + 1
+    std::vector<uint32_t> vertexMeshlet(vertices.size(), 0);
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices.size());
+    std::vector<uint32_t> candidates, meshletVertices, meshletTriangles;
+    size_t nextSeed = 0;
+
+    // bounds of the triangles meshletTriangles, which were appended to `ordered` from `first` on
+    auto addMeshlet = [&](size_t first) {
+        glm::vec3 lo(INFINITY), hi(-INFINITY), normalSum(0.0f);
+        for (size_t i = first; i < ordered.size(); i++) {
+            lo = glm::min(lo, vertices[ordered[i]].Position);
+            hi = glm::max(hi, vertices[ordered[i]].Position);
+        }
+        glm::vec3 center = (lo + hi) * 0.5f;
+        float radius = 0.0f;
+        for (size_t i = first; i < ordered.size(); i++)
+            radius = std::max(radius, glm::length(vertices[ordered[i]].Position - center));
+
+        // cone around the average normal, as wide as the triangle normal farthest from it
+        for (uint32_t t : meshletTriangles)
+            normalSum += normals[t];
+        glm::vec3 axis(0.0f);
+        float cutoff = 1.0f;
+        if (glm::length(normalSum) > 0.0f) {
+            axis = glm::normalize(normalSum);
+            float minDot = 1.0f;
+            for (uint32_t t : meshletTriangles)
+                if (normals[t] != glm::vec3(0.0f))
+                    minDot = std::min(minDot, glm::dot(normals[t], axis));
+            // a cone opening wider than about 84 degrees hardly ever faces away
+            if (minDot > 0.1f)
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+            else
+                axis = glm::vec3(0.0f);
+        }
+        set.firstIndex.push_back((uint32_t)first);
+        set.indexCount.push_back((uint32_t)(ordered.size() - first));
+        set.centerX.push_back(center.x);
+        set.centerY.push_back(center.y);
+        set.centerZ.push_back(center.z);
+        set.radius.push_back(radius);
+        set.axisX.push_back(axis.x);
+        set.axisY.push_back(axis.y);
+        set.axisZ.push_back(axis.z);
+        set.cutoff.push_back(cutoff);
+    };
+
+    while (true) {
+        while (nextSeed < triangleCount && used[nextSeed])
+            nextSeed++;
+        if (nextSeed == triangleCount)
+            break;
+        uint32_t meshlet = (uint32_t)set.firstIndex.size() + 1;
+        size_t first = ordered.size();
+        uint32_t triangles = 0;
+        glm::vec3 normalSum(0.0f);
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        candidates.clear();
+        size_t triangle = nextSeed;
+        while (true) {
+            used[triangle] = 1;
+            meshletTriangles.push_back((uint32_t)triangle);
+            triangles++;
+            normalSum += normals[triangle];
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[triangle * 3 + k];
+                ordered.push_back(v);
+                if (vertexMeshlet[v] != meshlet) {
+                    vertexMeshlet[v] = meshlet;
+                    meshletVertices.push_back(v);
+                    for (uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; a++)
+                        if (!used[adjacency[a]])
+                            candidates.push_back(adjacency[a]);
+                }
+            }
+            if (triangles == MESHLET_MAX_TRIANGLES)
+                break;
+
+            // best unused neighbour that still fits
+            size_t best = SIZE_MAX;
+            int bestNew = 4;
+            float bestDot = -2.0f;
+            size_t kept = 0;
+            for (size_t c = 0; c < candidates.size(); c++) {
+                uint32_t t = candidates[c];
+                if (used[t])
+                    continue;
+                candidates[kept++] = t;
+                int newVertices = 0;
+                for (int k = 0; k < 3; k++)
+                    newVertices += vertexMeshlet[indices[t * 3 + k]] != meshlet;
+                if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES)
+                    continue;
+                float dot = glm::dot(normals[t], normalSum);
+                if (newVertices < bestNew || (newVertices == bestNew && dot > bestDot)) {
+                    best = t;
+                    bestNew = newVertices;
+                    bestDot = dot;
+                }
+            }
+            candidates.resize(kept);
+            if (best == SIZE_MAX)
+                break;
+            triangle = best;
+        }
+        addMeshlet(first);
+    }
+    indices.swap(ordered);
+
+    set.count = (uint32_t)set.firstIndex.size();
+    // padding, never visible since Cull stops at count
+    while (set.firstIndex.size() % 4 != 0) {
+        set.firstIndex.push_back(0);
+        set.indexCount.push_back(0);
+        set.centerX.push_back(0.0f);
+        set.centerY.push_back(0.0f);
+        set.centerZ.push_back(0.0f);
+        set.radius.push_back(0.0f);
+        set.axisX.push_back(0.0f);
+        set.axisY.push_back(0.0f);
+        set.axisZ.push_back(0.0f);
+        set.cutoff.push_back(1.0f);
+    }
+    return set;
+}
+
+}
+
+#endif //PROJECT_BASE_MESHLETS_H
@@ -0,0 +1,259 @@
+#ifndef PROJECT_BASE_PROFILER_H
+#define PROJECT_BASE_PROFILER_H
+
+// CPU frame profiler. Scoped zones are recorded with
+//     RG_PROFILE_ZONE("name");        // until the end of the enclosing scope
+//     RG_PROFILE_FRAME();             // once per frame, on the main thread
+// Both macros, and everything else that only exists for the profiler, compile to nothing unless
+// RG_PROFILER is defined (the RG_PROFILER CMake option). Zone names must be string literals or
+// otherwise outlive the profiler, only the pointer is stored. With RG_ALLOC_TRACKER every zone also
+// records the heap allocations its thread made inside it.
+
+#ifdef RG_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <rg/AllocTracker.h>
+
+namespace rg {
+
+struct ProfileEvent {
+    const char *name;
+    uint64_t start;   // ns since the profiler started
+    uint64_t end;
+    uint32_t depth;   // nesting level on its thread
+    uint32_t thread;
+    uint64_t allocations;   // heap allocations inside the zone, 0 without RG_ALLOC_TRACKER
+    uint64_t allocatedBytes;
+};
+
+// Events of one thread. Only the owning thread writes; readers copy the newest events by looking at
+// the published write count, so neither side takes a lock. A reader racing with a writer that wraps
+// around the ring can see a torn event, which is acceptable for a profiler view.
+class ProfileThreadBuffer {
+public:
+    static const uint32_t CAPACITY = 1 << 16;
+
+    explicit ProfileThreadBuffer(uint32_t index)
+        : index(index), events(new ProfileEvent[CAPACITY])
+    {
+    }
+
+    void Push(const char *name, uint64_t start, uint64_t end, uint32_t eventDepth,
+              uint64_t allocations = 0, uint64_t allocatedBytes = 0)
+    {
+        uint64_t count = writeCount.load(std::memory_order_relaxed);
+        events[count % CAPACITY] = ProfileEvent{ name, start, end, eventDepth, index, allocations, allocatedBytes };
+        writeCount.store(count + 1, std::memory_order_release);
+    }
+
+    // appends the events that ended in [from, to) to `out`
+    void Collect(uint64_t from, uint64_t to, std::vector<ProfileEvent>& out) const
+    {
+        uint64_t count = writeCount.load(std::memory_order_acquire);
+        // stay clear of the slots the writer may be overwriting right now
+        uint64_t first = count > CAPACITY - 64 ? count - (CAPACITY - 64) : 0;
+        for (uint64_t i = first; i < count; i++) {
+            const ProfileEvent& event = events[i % CAPACITY];
+            if (event.end >= from && event.end < to)
+                out.push_back(event);
+        }
+    }
+
+    const uint32_t index;
+    uint32_t depth = 0;
+    std::atomic<bool> inUse{ true };
+
+private:
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint64_t> writeCount{ 0 };
+};
+
+class Profiler {
+public:
+    static const int FRAME_HISTORY = 256;
+
+    static Profiler& Get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    uint64_t Now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    // buffer of the calling thread. Threads are registered on first use and their buffer is handed
+    // to the next new thread after they exit, so short lived worker threads do not pile up buffers.
+    ProfileThreadBuffer& ThreadBuffer()
+    {
+        thread_local ThreadSlot slot;
+        if (!slot.buffer)
+            slot.buffer = acquireBuffer();
+        return *slot.buffer;
+    }
+
+    void FrameMark()
+    {
+        uint64_t count = frameCount.load(std::memory_order_relaxed);
+        frameStarts[count % FRAME_HISTORY] = Now();
+        frameCount.store(count + 1, std::memory_order_release);
+    }
+
+    // start/end of the last completed frame, false before two frame marks
+    bool LastFrame(uint64_t& start, uint64_t& end) const
+    {
+        return LastFrames(1, start, end);
+    }
+
+    // start of the `frames`-th last completed frame and end of the last one, `frames` is clamped to
+    // the history; false before two frame marks
+    bool LastFrames(int frames, uint64_t& start, uint64_t& end) const
+    {
+        uint64_t count = frameCount.load(std::memory_order_acquire);
+        if (count < 2)
+            return false;
+        uint64_t back = std::min<uint64_t>((uint64_t)std::max(frames, 1), std::min<uint64_t>(count - 1, FRAME_HISTORY - 1));
+        start = frameStarts[(count - 1 - back) % FRAME_HISTORY];
+        end = frameStarts[(count - 1) % FRAME_HISTORY];
+        return true;
+    }
+
+    // events of all threads that ended in [from, to), sorted by start time
+    std::vector<ProfileEvent> Collect(uint64_t from, uint64_t to)
+    {
+        std::vector<ProfileEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (const auto& buffer : buffers)
+                buffer->Collect(from, to, events);
+        }
+        std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+            return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+        });
+        return events;
+    }
+
+    // writes everything still in the ring buffers as Chrome trace_event JSON (chrome://tracing, Perfetto)
+    bool ExportChromeTrace(const std::string& path)
+    {
+        std::vector<ProfileEvent> events = Collect(0, UINT64_MAX);
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::PROFILER:: could not write " << path << std::endl;
+            return false;
+        }
+        out << "{\"traceEvents\":";
+        WriteTraceEvents(out, events);
+        out << ",\"displayTimeUnit\":\"ms\"}\n";
+        return true;
+    }
+
+    // `events` as a Chrome trace_event JSON array of complete ("X") events
+    static void WriteTraceEvents(std::ostream& out, const std::vector<ProfileEvent>& events)
+    {
+        out << "[\n";
+        for (size_t i = 0; i < events.size(); i++) {
+            const ProfileEvent& event = events[i];
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << (double)event.start / 1000.0 << ",\"dur\":" << (double)(event.end - event.start) / 1000.0
+                << ",\"args\":{\"allocations\":" << event.allocations << ",\"bytes\":" << event.allocatedBytes << "}"
+                << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+        }
+        out << "]";
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct ThreadSlot {
+        ProfileThreadBuffer *buffer = nullptr;
+        ~ThreadSlot()
+        {
+            if (buffer)
+                buffer->inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    Clock::time_point epoch = Clock::now();
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+    uint64_t frameStarts[FRAME_HISTORY] = {};
+    std::atomic<uint64_t> frameCount{ 0 };
+
+    ProfileThreadBuffer *acquireBuffer()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : buffers) {
+            bool expected = false;
+            if (buffer->inUse.compare_exchange_strong(expected, true)) {
+                buffer->depth = 0;
+                return buffer.get();
+            }
+        }
+        buffers.emplace_back(new ProfileThreadBuffer((uint32_t)buffers.size()));
+        return buffers.back().get();
+    }
+};
+
+// RAII zone behind RG_PROFILE_ZONE
+class ProfileZone {
+public:
+    explicit ProfileZone(const char *name)
+        : name(name), buffer(Profiler::Get().ThreadBuffer()), start(Profiler::Get().Now()), depth(buffer.depth++)
+    {
+#ifdef RG_ALLOC_TRACKER
+        startAllocations = AllocTracker::ThreadTotals();
+#endif
+    }
+
+    ~ProfileZone()
+    {
+        buffer.depth--;
+#ifdef RG_ALLOC_TRACKER
+        AllocationCounters allocations = AllocTracker::ThreadTotals();
+        buffer.Push(name, start, Profiler::Get().Now(), depth, allocations.allocations - startAllocations.allocations,
+                    allocations.bytes - startAllocations.bytes);
+#else
+        buffer.Push(name, start, Profiler::Get().Now(), depth);
+#endif
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char *name;
+    ProfileThreadBuffer& buffer;
+    uint64_t start;
+    uint32_t depth;
+#ifdef RG_ALLOC_TRACKER
+    AllocationCounters startAllocations;
+#endif
+};
+
+}
+
+#define RG_PROFILE_CONCAT_INNER(a, b) a##b
+#define RG_PROFILE_CONCAT(a, b) RG_PROFILE_CONCAT_INNER(a, b)
+#define RG_PROFILE_ZONE(name) ::rg::ProfileZone RG_PROFILE_CONCAT(rgProfileZone, __LINE__)(name)
+#define RG_PROFILE_FRAME() ::rg::Profiler::Get().FrameMark()
+
+#else
+
+#define RG_PROFILE_ZONE(name) ((void)0)
+#define RG_PROFILE_FRAME() ((void)0)
+
+#endif
+
+#endif //PROJECT_BASE_PROFILER_H
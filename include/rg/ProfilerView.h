@@ -0,0 +1,270 @@
+#ifndef PROJECT_BASE_PROFILERVIEW_H
+#define PROJECT_BASE_PROFILERVIEW_H
+
+#include <rg/AllocTracker.h>
+#include <rg/DrawStats.h>
+#include <rg/GpuProfiler.h>
+#include <rg/HitchDetector.h>
+#include <rg/Profiler.h>
+#include <rg/ResourceRegistry.h>
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// rolling graph of every GPU pass, nested passes indented under the pass they run in
+inline void DrawGpuProfilerWindow(const GpuPassProfiler& profiler)
+{
+    ImGui::Begin("GPU passes");
+    for (const GpuPassProfiler::Pass& pass : profiler.Passes()) {
+        ImGui::Indent(1.0f + 12.0f * (float)pass.depth);
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.3f ms (avg %.3f)", pass.lastMilliseconds, pass.averageMilliseconds);
+        ImGui::PlotLines(pass.name, pass.history, GpuPassProfiler::HISTORY, 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+        ImGui::Unindent(1.0f + 12.0f * (float)pass.depth);
+    }
+    ImGui::Text("Frames not ready in time: %u", profiler.DroppedFrames());
+    ImGui::End();
+}
+
+// counters of the last completed frame and the CSV dump of the logged frames
+inline void DrawStatisticsWindow()
+{
+    ImGui::Begin("Draw statistics");
+    const DrawStatsLog& log = drawStatsLog();
+    if (!log.Empty()) {
+        const DrawStats& s = log.Last();
+        ImGui::Text("Draw calls: %llu (%llu instances)", s.drawCalls, s.instances);
+        ImGui::Text("Vertices: %llu, triangles: %llu", s.vertices, s.triangles);
+        ImGui::Text("Program binds: %llu", s.programBinds);
+        ImGui::Text("Texture binds: %llu, VAO binds: %llu", s.textureBinds, s.vertexArrayBinds);
+        ImGui::Text("Uniform calls: %llu (%.1f KB), lookups: %llu", s.uniformCalls, (double)s.uniformBytes / 1024.0, s.uniformLookups);
+        ImGui::Text("Buffer uploads: %.1f KB", (double)s.bufferBytes / 1024.0);
+    }
+    if (ImGui::Button("Dump CSV"))
+        log.WriteCsv("draw_stats.csv");
+    ImGui::End();
+}
+
+inline void DrawHitchWindow(HitchDetector& detector)
+{
+    ImGui::Begin("Frame hitches");
+    ImGui::Checkbox("Detect hitches", &detector.enabled);
+    ImGui::SliderFloat("x median", &detector.thresholdMultiple, 1.5f, 10.0f, "%.1f");
+    ImGui::SliderInt("Frames per dump", &detector.captureFrames, 1, HitchDetector::HISTORY);
+    ImGui::Text("Median frame: %.2f ms", detector.Median());
+    ImGui::Text("Hitches: %u, dumps: %u", detector.hitches, detector.dumps);
+    if (detector.hitches > 0)
+        ImGui::Text("Last: %.2f ms (median %.2f ms) %s", detector.lastHitchMilliseconds, detector.lastHitchMedian,
+                    detector.lastDumpPath.c_str());
+    if (ImGui::Button("Dump now"))
+        detector.Dump("hitch_manual.json");
+    ImGui::End();
+}
+
+// every texture, renderbuffer, buffer and CPU mesh copy of the registry, sortable by column
+inline void DrawResourceWindow()
+{
+    struct Row {
+        const char *kind;
+        std::string owner;
+        std::string details;
+        unsigned long long bytes;
+    };
+    static std::vector<Row> rows;
+    static unsigned long long rowsVersion = ~0ull;
+
+    const ResourceRegistry& registry = resourceRegistry();
+    ImGui::Begin("GPU memory");
+    ImGui::Text("Textures: %.2f MB (%d), renderbuffers: %.2f MB (%d), buffers: %.2f MB (%d)",
+                (double)registry.TextureBytes() / 1048576.0, (int)registry.textures.size(),
+                (double)registry.RenderbufferBytes() / 1048576.0, (int)registry.renderbuffers.size(),
+                (double)registry.BufferBytes() / 1048576.0, (int)registry.buffers.size());
+    ImGui::Text("CPU copies of mesh data: %.2f MB", (double)registry.CpuBytes() / 1048576.0);
+
+    bool rebuilt = false;
+    if (rowsVersion != registry.Version()) {
+        rows.clear();
+        char details[128];
+        for (const auto& texture : registry.textures) {
+            snprintf(details, sizeof(details), "%dx%d %s, %d mips", texture.second.width, texture.second.height,
+                     formatName(texture.second.internalFormat), texture.second.levels);
+            rows.push_back({ texture.second.target == GL_TEXTURE_CUBE_MAP ? "cubemap" : "texture",
+                             texture.second.owner, details, texture.second.Bytes() });
+        }
+        for (const auto& renderbuffer : registry.renderbuffers) {
+            snprintf(details, sizeof(details), "%dx%d %s, %dx MSAA", renderbuffer.second.width, renderbuffer.second.height,
+                     formatName(renderbuffer.second.internalFormat), renderbuffer.second.samples);
+            rows.push_back({ "renderbuffer", renderbuffer.second.owner, details, renderbuffer.second.Bytes() });
+        }
+        for (const auto& buffer : registry.buffers) {
+            const char *target = buffer.second.target == GL_ELEMENT_ARRAY_BUFFER ? "index" :
+                                 buffer.second.target == GL_ARRAY_BUFFER ? "vertex" :
+                                 buffer.second.target == GL_TEXTURE_BUFFER ? "texture buffer" :
+                                 buffer.second.target == GL_UNIFORM_BUFFER ? "uniform" : "other";
+            const char *usage = buffer.second.usage == GL_STATIC_DRAW ? "static" :
+                                buffer.second.usage == GL_DYNAMIC_DRAW ? "dynamic" :
+                                buffer.second.usage == GL_STREAM_DRAW ? "stream" : "other";
+            snprintf(details, sizeof(details), "%s, %s", target, usage);
+            rows.push_back({ "buffer", buffer.second.owner, details, buffer.second.size });
+        }
+        for (const auto& copy : registry.cpuCopies) {
+            snprintf(details, sizeof(details), "vertices %.1f KB, indices %.1f KB",
+                     (double)copy.second.vertexBytes / 1024.0, (double)copy.second.indexBytes / 1024.0);
+            rows.push_back({ "CPU mesh copy", copy.first, details, copy.second.vertexBytes + copy.second.indexBytes });
+        }
+        rowsVersion = registry.Version();
+        rebuilt = true;
+    }
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV;
+    if (ImGui::BeginTable("resources", 4, flags, ImVec2(0.0f, 400.0f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("Owner");
+        ImGui::TableSetupColumn("Details", ImGuiTableColumnFlags_NoSort);
+        ImGui::TableSetupColumn("KB", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+
+        ImGuiTableSortSpecs *sortSpecs = ImGui::TableGetSortSpecs();
+        if (sortSpecs && sortSpecs->SpecsCount > 0 && (sortSpecs->SpecsDirty || rebuilt)) {
+            int column = sortSpecs->Specs[0].ColumnIndex;
+            bool ascending = sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+            std::sort(rows.begin(), rows.end(), [column, ascending](const Row& a, const Row& b) {
+                int order = column == 0 ? std::string(a.kind).compare(b.kind) :
+                            column == 1 ? a.owner.compare(b.owner) :
+                            (a.bytes < b.bytes ? -1 : a.bytes > b.bytes ? 1 : 0);
+                return ascending ? order < 0 : order > 0;
+            });
+            sortSpecs->SpecsDirty = false;
+        }
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)rows.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const Row& row = rows[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.kind);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.owner.empty() ? "(unnamed)" : row.owner.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.details.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", (double)row.bytes / 1024.0);
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+#ifdef RG_ALLOC_TRACKER
+// heap allocations of the last frame, call site sampling and the steady state assertion
+inline void DrawAllocationWindow()
+{
+    ImGui::Begin("Allocations");
+    AllocationCounters frame = AllocTracker::LastFrame();
+    AllocationCounters total = AllocTracker::Totals();
+    ImGui::Text("Last frame: %llu allocations, %llu bytes, %llu frees", (unsigned long long)frame.allocations,
+                (unsigned long long)frame.bytes, (unsigned long long)frame.frees);
+    ImGui::Text("Since startup: %llu allocations, %llu bytes", (unsigned long long)total.allocations,
+                (unsigned long long)total.bytes);
+
+    int interval = (int)AllocTracker::SampleInterval();
+    if (ImGui::SliderInt("Sample every n-th", &interval, 0, 256))
+        AllocTracker::SetSampleInterval((uint32_t)interval);
+    if (ImGui::Button("Print call sites"))
+        AllocTracker::PrintCallSites();
+    ImGui::SameLine();
+    if (ImGui::Button("Clear call sites"))
+        AllocTracker::ClearCallSites();
+
+    bool expectNone = AllocTracker::ExpectingNoAllocations();
+    if (ImGui::Checkbox("Abort when a frame allocates", &expectNone))
+        AllocTracker::ExpectNoAllocationsFrom(expectNone ? AllocTracker::FrameIndex() + 1 : UINT64_MAX);
+    ImGui::End();
+}
+#endif
+
+#ifdef RG_PROFILER
+
+// ImGui flame view of the last completed frame: one lane per thread, one row per nesting level,
+// zones laid out on the frame's time axis. Hovering a zone shows its duration.
+inline void DrawProfilerWindow()
+{
+    static std::vector<ProfileEvent> events;
+    static uint64_t frameStart = 0, frameEnd = 1;
+    static bool paused = false;
+
+    ImGui::Begin("CPU profiler");
+    Profiler& profiler = Profiler::Get();
+    uint64_t start, end;
+    if (!paused && profiler.LastFrame(start, end)) {
+        events = profiler.Collect(start, end);
+        frameStart = start;
+        frameEnd = end;
+    }
+
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace"))
+        profiler.ExportChromeTrace("profile_trace.json");
+    double frameMilliseconds = (double)(frameEnd - frameStart) / 1.0e6;
+    ImGui::Text("Frame: %.3f ms, %d zones", frameMilliseconds, (int)events.size());
+
+    // lanes of the threads that recorded something
+    std::map<uint32_t, uint32_t> laneDepth;
+    for (const ProfileEvent& event : events)
+        laneDepth[event.thread] = std::max(laneDepth[event.thread], event.depth + 1);
+    std::map<uint32_t, float> laneOffset;
+    float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    float height = 0.0f;
+    for (const auto& lane : laneDepth) {
+        laneOffset[lane.first] = height;
+        height += (float)lane.second * rowHeight + rowHeight * 0.5f;
+    }
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    double scale = (double)width / (double)(frameEnd - frameStart);
+    for (const ProfileEvent& event : events) {
+        float x0 = origin.x + (float)((double)(std::max(event.start, frameStart) - frameStart) * scale);
+        float x1 = origin.x + (float)((double)(event.end - frameStart) * scale);
+        x1 = std::max(x1, x0 + 1.0f);
+        float y0 = origin.y + laneOffset[event.thread] + (float)event.depth * rowHeight;
+        ImVec2 rectMin(x0, y0), rectMax(x1, y0 + rowHeight - 1.0f);
+
+        // colour by name, the names are literals so their address identifies them
+        float hue = (float)(((uintptr_t)event.name * 2654435761u) % 1000u) / 1000.0f;
+        drawList->AddRectFilled(rectMin, rectMax, ImColor::HSV(hue, 0.45f, 0.75f));
+        if (x1 - x0 > 20.0f) {
+            drawList->PushClipRect(rectMin, rectMax, true);
+            drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), event.name);
+            drawList->PopClipRect();
+        }
+        if (ImGui::IsMouseHoveringRect(rectMin, rectMax))
+            ImGui::SetTooltip("%s\n%.3f ms (thread %u)\n%llu allocations, %llu bytes", event.name,
+                              (double)(event.end - event.start) / 1.0e6, event.thread,
+                              (unsigned long long)event.allocations, (unsigned long long)event.allocatedBytes);
+    }
+    ImGui::Dummy(ImVec2(width, height));
+    ImGui::End();
+}
+
+#endif
+
+}
+
+#endif //PROJECT_BASE_PROFILERVIEW_H
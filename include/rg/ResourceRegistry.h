@@ -0,0 +1,371 @@
+#ifndef PROJECT_BASE_RESOURCEREGISTRY_H
+#define PROJECT_BASE_RESOURCEREGISTRY_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Estimated GPU memory of a texture or renderbuffer. Unsized formats are counted the way drivers
+// usually store them, e.g. GL_RGB as 4 bytes per texel.
+struct TextureResource {
+    GLenum target = GL_TEXTURE_2D;   // GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_RENDERBUFFER
+    GLenum internalFormat = GL_RGBA;
+    int width = 0;
+    int height = 0;
+    int levels = 1;
+    int samples = 1;
+    std::string owner;
+
+    unsigned long long Bytes() const;
+};
+
+struct BufferResource {
+    GLenum target = GL_ARRAY_BUFFER;   // the target it was first filled through
+    GLenum usage = GL_STATIC_DRAW;
+    unsigned long long size = 0;
+    std::string owner;
+};
+
+// CPU-side copies an asset keeps after uploading, e.g. Mesh::vertices/indices
+struct CpuResource {
+    unsigned long long vertexBytes = 0;
+    unsigned long long indexBytes = 0;
+};
+
+inline unsigned int bytesPerTexel(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RED: case GL_R8: return 1;
+        case GL_RG: case GL_RG8: case GL_R16F: return 2;
+        case GL_RGB: case GL_RGB8: case GL_RGBA: case GL_RGBA8: case GL_SRGB8: case GL_SRGB8_ALPHA8:
+        case GL_R32F: case GL_R32UI: case GL_R32I: case GL_RG16F: case GL_R11F_G11F_B10F:
+        case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8: case GL_DEPTH_STENCIL: return 4;
+        case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: case GL_RG32UI: return 8;
+        case GL_RGB32F: return 12;
+        case GL_RGBA32F: case GL_RGBA32UI: return 16;
+        default: return 4;
+    }
+}
+
+inline const char *formatName(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RED: return "RED";
+        case GL_R8: return "R8";
+        case GL_RG: return "RG";
+        case GL_RGB: return "RGB";
+        case GL_RGB8: return "RGB8";
+        case GL_RGBA: return "RGBA";
+        case GL_RGBA8: return "RGBA8";
+        case GL_SRGB8_ALPHA8: return "SRGB8_A8";
+        case GL_R32F: return "R32F";
+        case GL_R32UI: return "R32UI";
+        case GL_RG32UI: return "RG32UI";
+        case GL_RGB16F: return "RGB16F";
+        case GL_RGBA16F: return "RGBA16F";
+        case GL_RGB32F: return "RGB32F";
+        case GL_RGBA32F: return "RGBA32F";
+        case GL_DEPTH_COMPONENT: return "DEPTH";
+        case GL_DEPTH_COMPONENT24: return "DEPTH24";
+        case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+        case GL_DEPTH24_STENCIL8: return "DEPTH24_STENCIL8";
+        default: return "other";
+    }
+}
+
+inline unsigned long long TextureResource::Bytes() const {
+    unsigned long long faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    unsigned long long bytes = 0;
+    for (int level = 0; level < levels; level++) {
+        unsigned long long w = (unsigned long long)std::max(1, width >> level);
+        unsigned long long h = (unsigned long long)std::max(1, height >> level);
+        bytes += w * h;
+    }
+    return bytes * faces * (unsigned long long)samples * bytesPerTexel(internalFormat);
+}
+
+// Every texture, renderbuffer and buffer created through glad since installResourceTracking, with
+// the asset that created it. Loaders name the owner with a ResourceOwnerScope; objects created
+// outside of one have an empty owner.
+class ResourceRegistry {
+public:
+    std::unordered_map<GLuint, TextureResource> textures;
+    std::unordered_map<GLuint, TextureResource> renderbuffers;
+    std::unordered_map<GLuint, BufferResource> buffers;
+    std::unordered_map<std::string, CpuResource> cpuCopies;
+
+    // the innermost ResourceOwnerScope, "" outside of all of them
+    const std::string& Owner() const
+    {
+        static const std::string none;
+        return owners.empty() ? none : owners.back();
+    }
+
+    // incremented on every change, lets views cache their rows
+    unsigned long long Version() const { return version; }
+
+    void SetCpuCopy(const std::string& owner, unsigned long long vertexBytes, unsigned long long indexBytes)
+    {
+        CpuResource& copy = cpuCopies[owner];
+        copy.vertexBytes = vertexBytes;
+        copy.indexBytes = indexBytes;
+        version++;
+    }
+
+    unsigned long long TextureBytes() const { return sumBytes(textures); }
+    unsigned long long RenderbufferBytes() const { return sumBytes(renderbuffers); }
+
+    unsigned long long BufferBytes() const
+    {
+        unsigned long long bytes = 0;
+        for (const auto& buffer : buffers)
+            bytes += buffer.second.size;
+        return bytes;
+    }
+
+    unsigned long long CpuBytes() const
+    {
+        unsigned long long bytes = 0;
+        for (const auto& copy : cpuCopies)
+            bytes += copy.second.vertexBytes + copy.second.indexBytes;
+        return bytes;
+    }
+
+    // --- called by the glad wrappers
+
+    void TextureImage(GLuint id, GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        if (id == 0)
+            return;
+        TextureResource& texture = textures[id];
+        if (level == 0) {
+            texture.target = target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+            texture.internalFormat = internalFormat;
+            texture.width = width;
+            texture.height = height;
+            texture.owner = Owner();
+        }
+        texture.levels = std::max(texture.levels, level + 1);
+        version++;
+    }
+
+    void GenerateMipmap(GLuint id)
+    {
+        auto texture = textures.find(id);
+        if (texture == textures.end())
+            return;
+        int levels = 1;
+        for (int size = std::max(texture->second.width, texture->second.height); size > 1; size >>= 1)
+            levels++;
+        texture->second.levels = levels;
+        version++;
+    }
+
+    void RenderbufferStorage(GLuint id, GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        if (id == 0)
+            return;
+        TextureResource& renderbuffer = renderbuffers[id];
+        renderbuffer.target = GL_RENDERBUFFER;
+        renderbuffer.internalFormat = internalFormat;
+        renderbuffer.width = width;
+        renderbuffer.height = height;
+        renderbuffer.samples = std::max(1, (int)samples);
+        renderbuffer.owner = Owner();
+        version++;
+    }
+
+    void BufferData(GLuint id, GLenum target, GLsizeiptr size, GLenum usage)
+    {
+        if (id == 0)
+            return;
+        auto found = buffers.find(id);
+        // re-uploads of the same size (per-frame streaming) change nothing
+        if (found != buffers.end() && found->second.size == (unsigned long long)size && found->second.usage == usage)
+            return;
+        BufferResource& buffer = buffers[id];
+        if (found == buffers.end()) {
+            buffer.target = target;
+            buffer.owner = Owner();
+        }
+        buffer.size = (unsigned long long)size;
+        buffer.usage = usage;
+        version++;
+    }
+
+    void Delete(std::unordered_map<GLuint, TextureResource>& resources, GLsizei count, const GLuint *ids)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            resources.erase(ids[i]);
+        version++;
+    }
+
+    void DeleteBuffers(GLsizei count, const GLuint *ids)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            buffers.erase(ids[i]);
+        version++;
+    }
+
+private:
+    friend class ResourceOwnerScope;
+
+    std::vector<std::string> owners;
+    unsigned long long version = 0;
+
+    static unsigned long long sumBytes(const std::unordered_map<GLuint, TextureResource>& resources)
+    {
+        unsigned long long bytes = 0;
+        for (const auto& resource : resources)
+            bytes += resource.second.Bytes();
+        return bytes;
+    }
+};
+
+inline ResourceRegistry& resourceRegistry() {
+    static ResourceRegistry registry;
+    return registry;
+}
+
+// names the owner of the GL objects created until the end of the enclosing scope
+class ResourceOwnerScope {
+public:
+    explicit ResourceOwnerScope(const std::string& owner)
+    {
+        resourceRegistry().owners.push_back(owner);
+    }
+
+    ~ResourceOwnerScope()
+    {
+        resourceRegistry().owners.pop_back();
+    }
+
+    ResourceOwnerScope(const ResourceOwnerScope&) = delete;
+    ResourceOwnerScope& operator=(const ResourceOwnerScope&) = delete;
+};
+
+namespace detail {
+
+struct ResourceEntryPoints {
+    PFNGLTEXIMAGE2DPROC texImage2D = nullptr;
+    PFNGLGENERATEMIPMAPPROC generateMipmap = nullptr;
+    PFNGLDELETETEXTURESPROC deleteTextures = nullptr;
+    PFNGLRENDERBUFFERSTORAGEPROC renderbufferStorage = nullptr;
+    PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC renderbufferStorageMultisample = nullptr;
+    PFNGLDELETERENDERBUFFERSPROC deleteRenderbuffers = nullptr;
+    PFNGLBUFFERDATAPROC bufferData = nullptr;
+    PFNGLDELETEBUFFERSPROC deleteBuffers = nullptr;
+};
+
+inline ResourceEntryPoints& originalResourceEntryPoints() {
+    static ResourceEntryPoints entryPoints;
+    return entryPoints;
+}
+
+inline GLuint boundObject(GLenum bindingQuery) {
+    GLint id = 0;
+    glGetIntegerv(bindingQuery, &id);
+    return (GLuint)id;
+}
+
+inline GLuint boundTexture(GLenum target) {
+    if (target == GL_TEXTURE_2D)
+        return boundObject(GL_TEXTURE_BINDING_2D);
+    if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+        return boundObject(GL_TEXTURE_BINDING_CUBE_MAP);
+    return 0;
+}
+
+inline GLuint boundBuffer(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER: return boundObject(GL_ARRAY_BUFFER_BINDING);
+        case GL_ELEMENT_ARRAY_BUFFER: return boundObject(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+        case GL_UNIFORM_BUFFER: return boundObject(GL_UNIFORM_BUFFER_BINDING);
+        case GL_TEXTURE_BUFFER: return boundObject(GL_TEXTURE_BUFFER);
+        case GL_COPY_READ_BUFFER: return boundObject(GL_COPY_READ_BUFFER);
+        case GL_COPY_WRITE_BUFFER: return boundObject(GL_COPY_WRITE_BUFFER);
+        case GL_PIXEL_PACK_BUFFER: return boundObject(GL_PIXEL_PACK_BUFFER_BINDING);
+        case GL_PIXEL_UNPACK_BUFFER: return boundObject(GL_PIXEL_UNPACK_BUFFER_BINDING);
+        default: return 0;
+    }
+}
+
+inline void APIENTRY trackedTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                                       GLint border, GLenum format, GLenum type, const void *pixels) {
+    originalResourceEntryPoints().texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+    resourceRegistry().TextureImage(boundTexture(target), target, level, (GLenum)internalFormat, width, height);
+}
+
+inline void APIENTRY trackedGenerateMipmap(GLenum target) {
+    originalResourceEntryPoints().generateMipmap(target);
+    resourceRegistry().GenerateMipmap(boundTexture(target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target));
+}
+
+inline void APIENTRY trackedDeleteTextures(GLsizei count, const GLuint *ids) {
+    ResourceRegistry& registry = resourceRegistry();
+    registry.Delete(registry.textures, count, ids);
+    originalResourceEntryPoints().deleteTextures(count, ids);
+}
+
+inline void APIENTRY trackedRenderbufferStorage(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height) {
+    originalResourceEntryPoints().renderbufferStorage(target, internalFormat, width, height);
+    resourceRegistry().RenderbufferStorage(boundObject(GL_RENDERBUFFER_BINDING), 1, internalFormat, width, height);
+}
+
+inline void APIENTRY trackedRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalFormat,
+                                                           GLsizei width, GLsizei height) {
+    originalResourceEntryPoints().renderbufferStorageMultisample(target, samples, internalFormat, width, height);
+    resourceRegistry().RenderbufferStorage(boundObject(GL_RENDERBUFFER_BINDING), samples, internalFormat, width, height);
+}
+
+inline void APIENTRY trackedDeleteRenderbuffers(GLsizei count, const GLuint *ids) {
+    ResourceRegistry& registry = resourceRegistry();
+    registry.Delete(registry.renderbuffers, count, ids);
+    originalResourceEntryPoints().deleteRenderbuffers(count, ids);
+}
+
+inline void APIENTRY trackedBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    originalResourceEntryPoints().bufferData(target, size, data, usage);
+    resourceRegistry().BufferData(boundBuffer(target), target, size, usage);
+}
+
+inline void APIENTRY trackedDeleteBuffers(GLsizei count, const GLuint *ids) {
+    resourceRegistry().DeleteBuffers(count, ids);
+    originalResourceEntryPoints().deleteBuffers(count, ids);
+}
+
+}
+
+// Routes glad's texture, renderbuffer and buffer storage entry points through the registry.
+// Call once after gladLoadGLLoader, before anything is loaded.
+inline void installResourceTracking() {
+    detail::ResourceEntryPoints& original = detail::originalResourceEntryPoints();
+    if (original.texImage2D)
+        return;
+    original.texImage2D = glad_glTexImage2D;
+    original.generateMipmap = glad_glGenerateMipmap;
+    original.deleteTextures = glad_glDeleteTextures;
+    original.renderbufferStorage = glad_glRenderbufferStorage;
+    original.renderbufferStorageMultisample = glad_glRenderbufferStorageMultisample;
+    original.deleteRenderbuffers = glad_glDeleteRenderbuffers;
+    original.bufferData = glad_glBufferData;
+    original.deleteBuffers = glad_glDeleteBuffers;
+
+    glad_glTexImage2D = detail::trackedTexImage2D;
+    glad_glGenerateMipmap = detail::trackedGenerateMipmap;
+    glad_glDeleteTextures = detail::trackedDeleteTextures;
+    glad_glRenderbufferStorage = detail::trackedRenderbufferStorage;
+    glad_glRenderbufferStorageMultisample = detail::trackedRenderbufferStorageMultisample;
+    glad_glDeleteRenderbuffers = detail::trackedDeleteRenderbuffers;
+    glad_glBufferData = detail::trackedBufferData;
+    glad_glDeleteBuffers = detail::trackedDeleteBuffers;
+}
+
+}
+
+#endif //PROJECT_BASE_RESOURCEREGISTRY_H
@@ -0,0 +1,293 @@
+#ifndef PROJECT_BASE_SCENEFILE_H
+#define PROJECT_BASE_SCENEFILE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <rg/ClusteredLights.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rg {
+
+// Scene files. The text source (.scene) is meant to be edited by hand, one object per line, angles
+// in degrees and '#' starting a comment:
+//   model  <name> <x> <y> <z> <yaw> <scale>
+//   window <x> <y> <z> <scale> <rotate x> <rotate y> <rotate z>
+//   point  <x> <y> <z> <r> <g> <b> <constant> <linear> <quadratic>
+//   spot   <x> <y> <z> <dir x> <dir y> <dir z> <r> <g> <b> <constant> <linear> <quadratic> <cut off> <outer cut off>
+// compileScene turns it into the binary form (.rgscene) that holds every record the way the
+// application uses it: finished model and window matrices and LightData ready for the light buffer.
+//   header:  SceneFileHeader ("RGSC", version, counts and byte offsets of the arrays, file size)
+//   arrays:  mesh names (char[32]), SceneModel, window matrices, LightData, each 16 byte aligned
+// MappedScene maps the binary read-only and hands out pointers into the mapping, so loading costs one
+// mmap plus the page faults of what is read, nothing is parsed or converted.
+const uint32_t SCENE_FILE_VERSION = 1;
+const int SCENE_MESH_NAME_SIZE = 32;
+
+struct SceneFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t meshNameCount, modelCount, windowCount, lightCount;
+    uint32_t meshNameOffset, modelOffset, windowOffset, lightOffset;
+    uint32_t fileSize;
+};
+
+struct SceneModel {
+    glm::mat4 model;     // translation * yaw * scale
+    uint32_t meshName;   // index into the mesh names
+    uint32_t pad[3];
+};
+static_assert(sizeof(SceneModel) % 16 == 0, "SceneModel records must stay 16 byte aligned");
+
+// the model matrix of a window pane: scaled, then rotated about x, y and z
+inline glm::mat4 windowModelMatrix(glm::vec3 position, float scale, float rotateX, float rotateY, float rotateZ) {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    model = glm::scale(model, glm::vec3(scale));
+    model = glm::rotate(model, glm::radians(rotateX), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotateY), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotateZ), glm::vec3(0.0f, 0.0f, 1.0f));
+    return model;
+}
+
+// "arena.scene" -> "arena.rgscene", other paths are taken to be compiled already
+inline std::string compiledScenePath(const std::string& path) {
+    const std::string source = ".scene";
+    if (path.size() <= source.size() || path.compare(path.size() - source.size(), source.size(), source) != 0)
+        return path;
+    return path.substr(0, path.size() - source.size()) + ".rgscene";
+}
+
+inline bool compileScene(const std::string& sourcePath, const std::string& binaryPath) {
+    std::ifstream in(sourcePath);
+    if (!in) {
+        std::cout << "ERROR::SCENE_FILE:: could not read " << sourcePath << std::endl;
+        return false;
+    }
+    std::vector<std::string> meshNames;
+    std::vector<SceneModel> models;
+    std::vector<glm::mat4> windows;
+    std::vector<LightData> lights;
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+            continue;
+
+        bool valid = false;
+        if (kind == "model") {
+            std::string name;
+            glm::vec3 position;
+            float yaw, scale;
+            valid = (bool)(fields >> name >> position.x >> position.y >> position.z >> yaw >> scale)
+                    && name.size() < (size_t)SCENE_MESH_NAME_SIZE;
+            if (valid) {
+                SceneModel model = {};
+                model.model = glm::translate(glm::mat4(1.0f), position);
+                model.model = glm::rotate(model.model, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+                model.model = glm::scale(model.model, glm::vec3(scale));
+                model.meshName = 0;
+                while (model.meshName < meshNames.size() && meshNames[model.meshName] != name)
+                    model.meshName++;
+                if (model.meshName == meshNames.size())
+                    meshNames.push_back(name);
+                models.push_back(model);
+            }
+        }
+        else if (kind == "window") {
+            glm::vec3 position;
+            float scale, rotateX, rotateY, rotateZ;
+            valid = (bool)(fields >> position.x >> position.y >> position.z >> scale >> rotateX >> rotateY >> rotateZ);
+            if (valid)
+                windows.push_back(windowModelMatrix(position, scale, rotateX, rotateY, rotateZ));
+        }
+        else if (kind == "point" || kind == "spot") {
+            LightData light = {};
+            bool spot = kind == "spot";
+            float cutOff = 0.0f, outerCutOff = 0.0f;
+            valid = (bool)(fields >> light.position.x >> light.position.y >> light.position.z);
+            if (valid && spot)
+                valid = (bool)(fields >> light.direction.x >> light.direction.y >> light.direction.z);
+            valid = valid && (fields >> light.diffuse.r >> light.diffuse.g >> light.diffuse.b
+                                     >> light.constant >> light.linear >> light.quadratic);
+            if (valid && spot)
+                valid = (bool)(fields >> cutOff >> outerCutOff);
+            if (valid) {
+                light.type = spot ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+                light.shadowTile = -1.0f;
+                light.specular = light.diffuse;
+                if (spot) {
+                    light.direction = glm::normalize(light.direction);
+                    light.cutOff = std::cos(glm::radians(cutOff));
+                    light.outerCutOff = std::cos(glm::radians(outerCutOff));
+                }
+                float maxChannel = std::max(std::max(light.diffuse.r, light.diffuse.g), light.diffuse.b);
+                light.range = attenuationRange(light.constant, light.linear, light.quadratic, maxChannel);
+                lights.push_back(light);
+            }
+        }
+        else {
+            std::cout << "ERROR::SCENE_FILE:: " << sourcePath << ":" << lineNumber << ": unknown record " << kind << std::endl;
+            return false;
+        }
+        std::string extra;
+        if (!valid || fields >> extra) {
+            std::cout << "ERROR::SCENE_FILE:: " << sourcePath << ":" << lineNumber << ": malformed " << kind << std::endl;
+            return false;
+        }
+    }
+
+    auto align = [](uint32_t offset) { return (offset + 15u) & ~15u; };
+    SceneFileHeader header = {};
+    std::memcpy(header.magic, "RGSC", 4);
+    header.version = SCENE_FILE_VERSION;
+    header.meshNameCount = (uint32_t)meshNames.size();
+    header.modelCount = (uint32_t)models.size();
+    header.windowCount = (uint32_t)windows.size();
+    header.lightCount = (uint32_t)lights.size();
+    header.meshNameOffset = align(sizeof(SceneFileHeader));
+    header.modelOffset = align(header.meshNameOffset + header.meshNameCount * SCENE_MESH_NAME_SIZE);
+    header.windowOffset = align(header.modelOffset + header.modelCount * (uint32_t)sizeof(SceneModel));
+    header.lightOffset = align(header.windowOffset + header.windowCount * (uint32_t)sizeof(glm::mat4));
+    header.fileSize = header.lightOffset + header.lightCount * (uint32_t)sizeof(LightData);
+
+    std::vector<char> bytes(header.fileSize, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    for (size_t i = 0; i < meshNames.size(); i++)
+        std::memcpy(&bytes[header.meshNameOffset + i * SCENE_MESH_NAME_SIZE], meshNames[i].c_str(), meshNames[i].size());
+    if (!models.empty())
+        std::memcpy(&bytes[header.modelOffset], models.data(), models.size() * sizeof(SceneModel));
+    if (!windows.empty())
+        std::memcpy(&bytes[header.windowOffset], windows.data(), windows.size() * sizeof(glm::mat4));
+    if (!lights.empty())
+        std::memcpy(&bytes[header.lightOffset], lights.data(), lights.size() * sizeof(LightData));
+
+    std::ofstream out(binaryPath, std::ios::binary);
+    if (!out.write(bytes.data(), bytes.size())) {
+        std::cout << "ERROR::SCENE_FILE:: could not write " << binaryPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+class MappedScene {
+public:
+    MappedScene() = default;
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+
+    ~MappedScene()
+    {
+        Close();
+    }
+
+    // Maps a compiled scene. A .scene source is compiled next to itself first when its .rgscene is
+    // missing or older than the source.
+    bool Open(const std::string& path)
+    {
+        Close();
+        std::string binaryPath = compiledScenePath(path);
+        if (binaryPath != path) {
+            struct stat source, binary;
+            if (stat(path.c_str(), &source) != 0) {
+                std::cout << "ERROR::SCENE_FILE:: could not read " << path << std::endl;
+                return false;
+            }
+            if (stat(binaryPath.c_str(), &binary) != 0 || binary.st_mtime < source.st_mtime) {
+                if (!compileScene(path, binaryPath))
+                    return false;
+                compiled = true;
+            }
+        }
+
+        int file = open(binaryPath.c_str(), O_RDONLY);
+        struct stat info;
+        if (file < 0 || fstat(file, &info) != 0 || info.st_size < (off_t)sizeof(SceneFileHeader)) {
+            std::cout << "ERROR::SCENE_FILE:: could not read " << binaryPath << std::endl;
+            if (file >= 0)
+                close(file);
+            return false;
+        }
+        void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (mapping == MAP_FAILED) {
+            std::cout << "ERROR::SCENE_FILE:: could not map " << binaryPath << std::endl;
+            return false;
+        }
+        data = (const char *)mapping;
+        size = (size_t)info.st_size;
+        if (!valid()) {
+            std::cout << "ERROR::SCENE_FILE:: " << binaryPath << " is not a version " << SCENE_FILE_VERSION << " scene" << std::endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+        compiled = false;
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+    // the source was compiled by the last Open
+    bool WasCompiled() const { return compiled; }
+
+    const SceneFileHeader& Header() const { return *(const SceneFileHeader *)data; }
+    // zero terminated, at most SCENE_MESH_NAME_SIZE - 1 characters
+    const char *MeshName(uint32_t index) const { return data + Header().meshNameOffset + index * SCENE_MESH_NAME_SIZE; }
+    const SceneModel *Models() const { return (const SceneModel *)(data + Header().modelOffset); }
+    const glm::mat4 *Windows() const { return (const glm::mat4 *)(data + Header().windowOffset); }
+    const LightData *Lights() const { return (const LightData *)(data + Header().lightOffset); }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    bool compiled = false;
+
+    bool valid() const
+    {
+        const SceneFileHeader& h = Header();
+        if (std::memcmp(h.magic, "RGSC", 4) != 0 || h.version != SCENE_FILE_VERSION || h.fileSize != size)
+            return false;
+        auto fits = [this](uint32_t offset, uint32_t count, uint32_t stride) {
+            return offset % 16 == 0 && (uint64_t)offset + (uint64_t)count * stride <= size;
+        };
+        if (!fits(h.meshNameOffset, h.meshNameCount, SCENE_MESH_NAME_SIZE) || !fits(h.modelOffset, h.modelCount, sizeof(SceneModel))
+            || !fits(h.windowOffset, h.windowCount, sizeof(glm::mat4)) || !fits(h.lightOffset, h.lightCount, sizeof(LightData)))
+            return false;
+        for (uint32_t i = 0; i < h.meshNameCount; i++)
+            if (MeshName(i)[SCENE_MESH_NAME_SIZE - 1] != '\0')
+                return false;
+        for (uint32_t i = 0; i < h.modelCount; i++)
+            if (Models()[i].meshName >= h.meshNameCount)
+                return false;
+        return true;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SCENEFILE_H
@@ -0,0 +1,192 @@
+#ifndef PROJECT_BASE_SHADOWATLAS_H
+#define PROJECT_BASE_SHADOWATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/ClusteredLights.h>
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// View-projection of a spotlight's shadow map: a square perspective frustum around the outer cone
+// that ends at the light's range.
+inline glm::mat4 spotLightMatrix(const LightData& light, float zNear = 0.1f) {
+    float coneAngle = 2.0f * std::acos(glm::clamp(light.outerCutOff, -1.0f, 1.0f));
+    glm::vec3 up = std::abs(light.direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 projection = glm::perspective(glm::min(coneAngle + 0.1f, 3.0f), 1.0f, zNear, glm::max(light.range, zNear * 2.0f));
+    return projection * glm::lookAt(light.position, light.position + light.direction, up);
+}
+
+// Shadow maps of the spotlights, one tile per light in a single depth atlas. Two atlases are kept:
+//   static  - only casters that rarely move, re-rendered per tile when its light or a static
+//             caster moved
+//   final   - the static tile copied over (depth blit) with the dynamic casters drawn on top,
+//             redone when the static tile changed or a dynamic caster moved
+// When nothing moves no shadow map is rendered at all. The final atlas is sampled with hardware
+// depth comparison (sampler2DShadow).
+class SpotShadowAtlas {
+public:
+    static const int MAX_LIGHTS = 4;
+    static const int TILES_PER_ROW = 2;
+    static const int TILE_SIZE = 1024;
+    static const int ATLAS_SIZE = TILES_PER_ROW * TILE_SIZE;
+
+    // statistics of the last Update
+    unsigned int staticTilesRendered = 0;
+    unsigned int dynamicTilesRendered = 0;
+
+    SpotShadowAtlas()
+        : depthShader("resources/shaders/shadow_depth.vs", "resources/shaders/shadow_depth.fs")
+    {
+        for (int i = 0; i < 2; i++) {
+            glGenTextures(1, &atlas[i]);
+            glBindTexture(GL_TEXTURE_2D, atlas[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+            glGenFramebuffers(1, &fbo[i]);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas[i], 0);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::SHADOW_ATLAS:: Framebuffer is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    ~SpotShadowAtlas()
+    {
+        glDeleteFramebuffers(2, fbo);
+        glDeleteTextures(2, atlas);
+    }
+
+    SpotShadowAtlas(const SpotShadowAtlas&) = delete;
+    SpotShadowAtlas& operator=(const SpotShadowAtlas&) = delete;
+
+    // Brings the tiles of the enabled lights up to date. The caster matrices are only compared with
+    // the previous frame to detect movement; drawCasters(shader, dynamic) draws the static or the
+    // dynamic casters with the given depth shader, setting its "model" uniform per object.
+    void Update(const glm::mat4 lightMatrices[MAX_LIGHTS], const bool enabled[MAX_LIGHTS],
+                const std::vector<glm::mat4>& staticCasters, const std::vector<glm::mat4>& dynamicCasters,
+                const std::function<void(Shader&, bool)>& drawCasters)
+    {
+        staticTilesRendered = dynamicTilesRendered = 0;
+        bool staticMoved = changed(staticCasters, cachedStatic);
+        bool dynamicMoved = changed(dynamicCasters, cachedDynamic);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint targetFramebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+        glEnable(GL_SCISSOR_TEST);
+        glDisable(GL_CULL_FACE);
+        // slope scaled offset against shadow acne on surfaces at grazing angles to the light
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        depthShader.use();
+
+        for (int i = 0; i < MAX_LIGHTS; i++) {
+            if (staticMoved)
+                tiles[i].staticValid = false;
+            if (dynamicMoved)
+                tiles[i].dynamicValid = false;
+            if (!enabled[i])
+                continue;
+
+            if (!tiles[i].staticValid || lightMatrices[i] != tiles[i].lightMatrix) {
+                tiles[i].lightMatrix = lightMatrices[i];
+                renderTile(STATIC_ATLAS, i, false, drawCasters);
+                tiles[i].staticValid = true;
+                tiles[i].dynamicValid = false;
+                staticTilesRendered++;
+            }
+            if (!tiles[i].dynamicValid) {
+                int x = (i % TILES_PER_ROW) * TILE_SIZE;
+                int y = (i / TILES_PER_ROW) * TILE_SIZE;
+                glScissor(x, y, TILE_SIZE, TILE_SIZE);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo[STATIC_ATLAS]);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo[FINAL_ATLAS]);
+                glBlitFramebuffer(x, y, x + TILE_SIZE, y + TILE_SIZE, x, y, x + TILE_SIZE, y + TILE_SIZE,
+                                  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                if (!dynamicCasters.empty())
+                    renderTile(FINAL_ATLAS, i, true, drawCasters);
+                tiles[i].dynamicValid = true;
+                dynamicTilesRendered++;
+            }
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)targetFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // binds the final atlas to `unit` and sets spotShadowAtlas/spotShadowMatrices
+    void Bind(Shader& shader, int unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, atlas[FINAL_ATLAS]);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("spotShadowAtlas", unit);
+        for (int i = 0; i < MAX_LIGHTS; i++)
+            shader.setMat4("spotShadowMatrices[" + std::to_string(i) + "]", tiles[i].lightMatrix);
+    }
+
+private:
+    enum { STATIC_ATLAS = 0, FINAL_ATLAS = 1 };
+
+    struct Tile {
+        glm::mat4 lightMatrix = glm::mat4(1.0f);
+        bool staticValid = false;
+        bool dynamicValid = false;
+    };
+
+    Shader depthShader;
+    GLuint atlas[2];
+    GLuint fbo[2];
+    Tile tiles[MAX_LIGHTS];
+    std::vector<glm::mat4> cachedStatic;
+    std::vector<glm::mat4> cachedDynamic;
+
+    static bool changed(const std::vector<glm::mat4>& current, std::vector<glm::mat4>& cached)
+    {
+        bool moved = current.size() != cached.size() ||
+                     std::memcmp(current.data(), cached.data(), current.size() * sizeof(glm::mat4)) != 0;
+        if (moved)
+            cached = current;
+        return moved;
+    }
+
+    void renderTile(int target, int tile, bool dynamic, const std::function<void(Shader&, bool)>& drawCasters)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[target]);
+        int x = (tile % TILES_PER_ROW) * TILE_SIZE;
+        int y = (tile / TILES_PER_ROW) * TILE_SIZE;
+        glViewport(x, y, TILE_SIZE, TILE_SIZE);
+        glScissor(x, y, TILE_SIZE, TILE_SIZE);
+        if (!dynamic)
+            glClear(GL_DEPTH_BUFFER_BIT);
+        depthShader.setMat4("lightSpaceMatrix", tiles[tile].lightMatrix);
+        drawCasters(depthShader, dynamic);
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SHADOWATLAS_H
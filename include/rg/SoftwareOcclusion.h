@@ -0,0 +1,336 @@
+#ifndef PROJECT_BASE_SOFTWAREOCCLUSION_H
+#define PROJECT_BASE_SOFTWAREOCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <rg/JobSystem.h>
+#include <rg/LightCulling.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace rg {
+
+// model space triangles an object is drawn into the occlusion buffer with, three positions each
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+
+    size_t TriangleCount() const { return positions.size() / 3; }
+};
+
+// The maxTriangles largest triangles of the meshes (anything with .vertices[i].Position and .indices).
+// A subset of the real surface never hides more than the object does, so the proxy is conservative;
+// the big triangles are the ones that hide anything.
+template<typename MeshT>
+OccluderMesh buildOccluderMesh(const std::vector<MeshT>& meshes, size_t maxTriangles)
+{
+    struct Candidate {
+        float area;
+        glm::vec3 a, b, c;
+    };
+    std::vector<Candidate> candidates;
+    for (const MeshT& mesh : meshes)
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            Candidate candidate;
+            candidate.a = mesh.vertices[mesh.indices[i]].Position;
+            candidate.b = mesh.vertices[mesh.indices[i + 1]].Position;
+            candidate.c = mesh.vertices[mesh.indices[i + 2]].Position;
+            candidate.area = glm::length(glm::cross(candidate.b - candidate.a, candidate.c - candidate.a));
+            if (candidate.area > 0.0f)
+                candidates.push_back(candidate);
+        }
+    size_t count = std::min(maxTriangles, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const Candidate& x, const Candidate& y) { return x.area > y.area; });
+    OccluderMesh occluder;
+    for (size_t i = 0; i < count; i++) {
+        occluder.positions.push_back(candidates[i].a);
+        occluder.positions.push_back(candidates[i].b);
+        occluder.positions.push_back(candidates[i].c);
+    }
+    return occluder;
+}
+
+// Software occlusion culling on the CPU. Occluders are rasterized into a small depth buffer (WIDTH
+// pixels wide, the height following the aspect ratio) by one job per band of BAND_ROWS rows, four
+// pixels at a time with SSE; the buffer keeps the nearest depth per pixel and a pyramid of max
+// reduced levels ("Hi-Z") is built on top of it. An object is hidden when the nearest depth of its
+// bounding box lies behind the farthest depth of the few pyramid texels covering the box on screen.
+// Depths are window depths in [0, 1] like GL's, the buffer's row 0 is the bottom of the screen.
+// Triangles crossing the near plane are clipped against it in clip space, which matters for the big
+// ones the camera stands on. Coverage is sampled at pixel centres, so a hidden object can be reported
+// visible but not the other way round, up to a pixel of the buffer.
+class OcclusionBuffer {
+public:
+    static const int WIDTH = 256;
+    static const int BAND_ROWS = 8;
+
+    // statistics of the last frame
+    unsigned int occluders = 0;
+    unsigned int triangles = 0;   // set up for rasterization, after the near plane and frustum rejects
+
+    OcclusionBuffer() = default;
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+    OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+    // starts a frame seen through viewProjection; the buffer takes the framebuffer's aspect ratio
+    void Begin(const glm::mat4& viewProjection, int framebufferWidth, int framebufferHeight)
+    {
+        this->viewProjection = viewProjection;
+        int height = framebufferWidth > 0 ? (int)std::lround((double)WIDTH * framebufferHeight / framebufferWidth) : WIDTH;
+        height = (height + BAND_ROWS - 1) / BAND_ROWS * BAND_ROWS;
+        height = height < BAND_ROWS ? BAND_ROWS : height > WIDTH ? WIDTH : height;
+        if (height != levelHeight(0) || levels.empty())
+            resize(height);
+        setups.clear();
+        occluders = 0;
+        triangles = 0;
+    }
+
+    void AddOccluder(const OccluderMesh& mesh, const glm::mat4& model)
+    {
+        occluders++;
+        glm::mat4 matrix = viewProjection * model;
+        const float width = (float)WIDTH, height = (float)levelHeight(0);
+        for (size_t i = 0; i + 2 < mesh.positions.size(); i += 3) {
+            glm::vec4 clip[3];
+            int outside[6] = { 0, 0, 0, 0, 0, 0 };
+            for (int k = 0; k < 3; k++) {
+                clip[k] = matrix * glm::vec4(mesh.positions[i + k], 1.0f);
+                const glm::vec4& c = clip[k];
+                outside[0] += c.x < -c.w;
+                outside[1] += c.x > c.w;
+                outside[2] += c.y < -c.w;
+                outside[3] += c.y > c.w;
+                outside[4] += nearDistance(c) < 0.0f;
+                outside[5] += c.z > c.w;
+            }
+            if (outside[0] == 3 || outside[1] == 3 || outside[2] == 3 || outside[3] == 3 || outside[4] == 3 || outside[5] == 3)
+                continue;
+            // the part in front of the near plane, a triangle or a quad drawn as a fan
+            glm::vec4 polygon[4];
+            int count = 0;
+            if (outside[4] == 0) {
+                for (int k = 0; k < 3; k++)
+                    polygon[count++] = clip[k];
+            }
+            else {
+                for (int k = 0; k < 3; k++) {
+                    const glm::vec4& from = clip[k];
+                    const glm::vec4& to = clip[(k + 1) % 3];
+                    float fromDistance = nearDistance(from), toDistance = nearDistance(to);
+                    if (fromDistance >= 0.0f)
+                        polygon[count++] = from;
+                    if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+                        polygon[count++] = from + (to - from) * (fromDistance / (fromDistance - toDistance));
+                }
+            }
+            glm::vec3 screen[4];
+            for (int k = 0; k < count; k++) {
+                glm::vec3 ndc = glm::vec3(polygon[k]) / (polygon[k].w > NEAR_W ? polygon[k].w : NEAR_W);
+                screen[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+            }
+            for (int k = 2; k < count; k++)
+                addTriangle(screen[0], screen[k - 1], screen[k]);
+        }
+    }
+
+    // rasterizes the occluders on `jobs` and builds the pyramid; waits for the jobs
+    void Rasterize(JobSystem& jobs)
+    {
+        triangles = (unsigned int)setups.size();
+        JobCounter counter;
+        jobs.ParallelFor((uint32_t)(levelHeight(0) / BAND_ROWS), 1, rasterizeBands, this, counter);
+        jobs.Wait(counter);
+        for (size_t level = 1; level < levels.size(); level++)
+            reduce(level);
+    }
+
+    // false when `sphere` is certainly hidden behind the occluders; any thread, after Rasterize
+    bool Visible(const BoundingSphere& sphere) const
+    {
+        if (levels.empty())
+            return true;
+        // screen rectangle and nearest depth of the sphere's bounding box
+        glm::vec2 lo(1.0f), hi(0.0f);
+        float nearest = 1.0f;
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner = sphere.center + sphere.radius * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            if (clip.w < NEAR_W)
+                return true;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            lo = glm::min(lo, glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f);
+            hi = glm::max(hi, glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f);
+            nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+        }
+        if (nearest <= 0.0f)
+            return true;
+        int x0 = std::max(0, (int)std::floor(lo.x * WIDTH)), x1 = std::min(WIDTH - 1, (int)std::floor(hi.x * WIDTH));
+        int y0 = std::max(0, (int)std::floor(lo.y * levelHeight(0))), y1 = std::min(levelHeight(0) - 1, (int)std::floor(hi.y * levelHeight(0)));
+        if (x0 > x1 || y0 > y1)
+            return true;
+        // the level where the rectangle spans at most 4 texels each way
+        size_t level = 0;
+        while (level + 1 < levels.size() && std::max(x1 - x0, y1 - y0) >= 4) {
+            x0 >>= 1; x1 >>= 1; y0 >>= 1; y1 >>= 1;
+            level++;
+        }
+        const std::vector<float>& depth = levels[level];
+        int width = levelWidth(level);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                if (depth[y * width + x] >= nearest)
+                    return true;
+        return false;
+    }
+
+    int Width() const { return WIDTH; }
+    int Height() const { return levelHeight(0); }
+
+private:
+    // clip w below which a vertex counts as behind the camera
+    static constexpr float NEAR_W = 1e-5f;
+
+    // signed distance to the near plane in clip space, z = -w like GL's
+    static float nearDistance(const glm::vec4& c)
+    {
+        return c.z + c.w;
+    }
+
+    // edge functions a * x + b * y + c, positive inside, and the depth plane z = zc + dzdx * x + dzdy * y
+    struct TriangleSetup {
+        int minX, maxX, minY, maxY;
+        float a[3], b[3], c[3];
+        float zc, dzdx, dzdy;
+    };
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<std::vector<float>> levels;   // levels[0] the nearest depth per pixel, then max reduced
+    std::vector<glm::ivec2> levelSizes;
+    std::vector<TriangleSetup> setups;
+
+    int levelWidth(size_t level) const { return levelSizes[level].x; }
+    int levelHeight(size_t level) const { return levelSizes.empty() ? 0 : levelSizes[level].y; }
+
+    void resize(int height)
+    {
+        levels.clear();
+        levelSizes.clear();
+        glm::ivec2 size(WIDTH, height);
+        while (true) {
+            levelSizes.push_back(size);
+            levels.push_back(std::vector<float>((size_t)size.x * size.y, 1.0f));
+            if (size.x == 1 && size.y == 1)
+                break;
+            size = glm::ivec2(std::max(1, (size.x + 1) / 2), std::max(1, (size.y + 1) / 2));
+        }
+    }
+
+    void addTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+    {
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if (std::fabs(area) < 1e-8f)
+            return;
+        // both facings occlude
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+        TriangleSetup setup;
+        setup.minX = std::max(0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+        setup.maxX = std::min(WIDTH - 1, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+        setup.minY = std::max(0, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+        setup.maxY = std::min(levelHeight(0) - 1, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+        if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+            return;
+        const glm::vec3 *v[3] = { &v0, &v1, &v2 };
+        for (int e = 0; e < 3; e++) {
+            const glm::vec3& from = *v[e];
+            const glm::vec3& to = *v[(e + 1) % 3];
+            setup.a[e] = -(to.y - from.y);
+            setup.b[e] = to.x - from.x;
+            setup.c[e] = (to.y - from.y) * from.x - (to.x - from.x) * from.y;
+        }
+        setup.dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+        setup.dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+        setup.zc = v0.z - setup.dzdx * v0.x - setup.dzdy * v0.y;
+        setups.push_back(setup);
+    }
+
+    static void rasterizeBands(void *data, uint32_t begin, uint32_t end)
+    {
+        OcclusionBuffer& buffer = *(OcclusionBuffer *)data;
+        for (uint32_t band = begin; band < end; band++)
+            buffer.rasterizeBand((int)band * BAND_ROWS, (int)band * BAND_ROWS + BAND_ROWS);
+    }
+
+    void rasterizeBand(int rowBegin, int rowEnd)
+    {
+        std::vector<float>& depth = levels[0];
+        std::fill(depth.begin() + rowBegin * WIDTH, depth.begin() + rowEnd * WIDTH, 1.0f);
+        for (const TriangleSetup& t : setups) {
+            int y0 = std::max(t.minY, rowBegin), y1 = std::min(t.maxY, rowEnd - 1);
+            for (int y = y0; y <= y1; y++) {
+                float centerY = (float)y + 0.5f;
+                float *row = &depth[y * WIDTH];
+#ifdef __SSE2__
+                __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+                __m128 zero = _mm_setzero_ps();
+                __m128 a0 = _mm_set1_ps(t.a[0]), a1 = _mm_set1_ps(t.a[1]), a2 = _mm_set1_ps(t.a[2]);
+                __m128 rowEdge0 = _mm_set1_ps(t.b[0] * centerY + t.c[0]), rowEdge1 = _mm_set1_ps(t.b[1] * centerY + t.c[1]);
+                __m128 rowEdge2 = _mm_set1_ps(t.b[2] * centerY + t.c[2]);
+                __m128 dzdx = _mm_set1_ps(t.dzdx), rowZ = _mm_set1_ps(t.zc + t.dzdy * centerY);
+                for (int x = t.minX & ~3; x <= t.maxX; x += 4) {
+                    __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), rowEdge0);
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), rowEdge1);
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), rowEdge2);
+                    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+                    __m128 z = _mm_add_ps(_mm_mul_ps(dzdx, centerX), rowZ);
+                    __m128 old = _mm_loadu_ps(row + x);
+                    __m128 updated = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(old, z)), _mm_andnot_ps(inside, old));
+                    _mm_storeu_ps(row + x, updated);
+                }
+#else
+                for (int x = t.minX; x <= t.maxX; x++) {
+                    float centerX = (float)x + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++)
+                        inside &= t.a[e] * centerX + t.b[e] * centerY + t.c[e] >= 0.0f;
+                    if (inside)
+                        row[x] = std::min(row[x], t.zc + t.dzdx * centerX + t.dzdy * centerY);
+                }
+#endif
+            }
+        }
+    }
+
+    // the farthest depth of the up to 2x2 texels of the level above
+    void reduce(size_t level)
+    {
+        const std::vector<float>& source = levels[level - 1];
+        std::vector<float>& target = levels[level];
+        int sourceWidth = levelWidth(level - 1), sourceHeight = levelHeight(level - 1);
+        int width = levelWidth(level), height = levelHeight(level);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++) {
+                int sx = x * 2, sy = y * 2;
+                int sx1 = std::min(sx + 1, sourceWidth - 1), sy1 = std::min(sy + 1, sourceHeight - 1);
+                target[y * width + x] = std::max(std::max(source[sy * sourceWidth + sx], source[sy * sourceWidth + sx1]),
+                                                 std::max(source[sy1 * sourceWidth + sx], source[sy1 * sourceWidth + sx1]));
+            }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SOFTWAREOCCLUSION_H
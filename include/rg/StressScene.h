@@ -0,0 +1,139 @@
+#ifndef PROJECT_BASE_STRESSSCENE_H
+#define PROJECT_BASE_STRESSSCENE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+// Procedural load for scalability measurements: copies of the scene's models, transparent panes and
+// lights scattered over a square of the floor. Every category is generated from its own random
+// stream derived from the seed, and instance i does not depend on the count, so raising one count
+// keeps the instances that were already there and leaves the other categories untouched.
+enum StressModel {
+    STRESS_BEAR,
+    STRESS_FLOWER,
+    STRESS_LAMP,
+    STRESS_SEESAW,
+    STRESS_PLATFORM,
+    STRESS_MODEL_COUNT
+};
+
+struct StressSceneOptions {
+    int models = 0;        // instances of every StressModel
+    int windows = 0;
+    int lights = 0;        // a quarter of them are spotlights
+    uint32_t seed = 1;
+    float extent = 40.0f;  // half size of the square around the origin
+    float height = 6.0f;   // highest pane and light
+};
+
+struct StressInstance {
+    glm::vec3 position;    // y is 0, the model's own height is added when drawing
+    float yaw;             // radians
+    float scale;           // multiplies the model's usual scale
+};
+
+struct StressPane {
+    glm::vec3 position;
+    float rotateX, rotateY, rotateZ;   // degrees, like Prozor
+    float scale;
+};
+
+struct StressLight {
+    glm::vec3 position;
+    glm::vec3 direction;   // spotlights only
+    glm::vec3 color;
+    bool spot;
+};
+
+// PCG32, the same sequence on every platform unlike the <random> distributions
+class StressRandom {
+public:
+    StressRandom(uint64_t seed, uint64_t stream)
+    {
+        increment = (stream << 1u) | 1u;
+        Next();
+        state += seed;
+        Next();
+    }
+
+    uint32_t Next()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = (uint32_t)(old >> 59u);
+        return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+    }
+
+    // [low, high)
+    float Uniform(float low, float high)
+    {
+        return low + (high - low) * (float)(Next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    uint64_t state = 0;
+    uint64_t increment = 1;
+};
+
+class StressScene {
+public:
+    StressSceneOptions options;
+    std::vector<StressInstance> instances[STRESS_MODEL_COUNT];
+    std::vector<StressPane> panes;
+    std::vector<StressLight> lights;
+
+    void Generate(const StressSceneOptions& stressOptions)
+    {
+        options = stressOptions;
+        float extent = options.extent;
+        for (int model = 0; model < STRESS_MODEL_COUNT; model++) {
+            StressRandom random(options.seed, (uint64_t)model);
+            instances[model].resize((size_t)options.models);
+            for (StressInstance& instance : instances[model]) {
+                instance.position = glm::vec3(random.Uniform(-extent, extent), 0.0f, random.Uniform(-extent, extent));
+                instance.yaw = random.Uniform(0.0f, 6.2831853f);
+                instance.scale = random.Uniform(0.75f, 1.25f);
+            }
+        }
+
+        StressRandom paneRandom(options.seed, STRESS_MODEL_COUNT);
+        panes.resize((size_t)options.windows);
+        for (StressPane& pane : panes) {
+            pane.position = glm::vec3(paneRandom.Uniform(-extent, extent), paneRandom.Uniform(0.5f, options.height),
+                                      paneRandom.Uniform(-extent, extent));
+            pane.rotateX = 0.0f;
+            pane.rotateY = paneRandom.Uniform(0.0f, 360.0f);
+            pane.rotateZ = 0.0f;
+            pane.scale = paneRandom.Uniform(0.5f, 1.5f);
+        }
+
+        StressRandom lightRandom(options.seed, STRESS_MODEL_COUNT + 1);
+        lights.resize((size_t)options.lights);
+        for (StressLight& light : lights) {
+            light.position = glm::vec3(lightRandom.Uniform(-extent, extent), lightRandom.Uniform(0.5f, options.height),
+                                       lightRandom.Uniform(-extent, extent));
+            // mostly downwards, up to ~45 degrees off
+            light.direction = glm::normalize(glm::vec3(lightRandom.Uniform(-1.0f, 1.0f), -1.0f, lightRandom.Uniform(-1.0f, 1.0f)));
+            float hue = lightRandom.Uniform(0.0f, 6.2831853f);
+            light.color = glm::vec3(0.5f + 0.5f * glm::cos(hue), 0.5f + 0.5f * glm::cos(hue + 2.09f), 0.5f + 0.5f * glm::cos(hue + 4.19f));
+            light.spot = (lightRandom.Next() & 3u) == 0;
+        }
+    }
+
+    size_t InstanceCount() const
+    {
+        size_t count = 0;
+        for (const std::vector<StressInstance>& models : instances)
+            count += models.size();
+        return count;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_STRESSSCENE_H
@@ -0,0 +1,229 @@
+#ifndef PROJECT_BASE_TRANSFORMHIERARCHY_H
+#define PROJECT_BASE_TRANSFORMHIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RG_TRANSFORM_SSE 1
+#endif
+
+namespace rg {
+
+// Scene graph of local translation/rotation/scale transforms and their world matrices.
+//  - local TRS is kept structure-of-arrays, padded to a multiple of 4 nodes, so four nodes are
+//    composed into matrices at once with SSE (the scalar path does the same one node at a time)
+//  - nodes are stored parents first: AddNode only accepts a parent that already exists, so a single
+//    forward pass propagates world matrices
+//  - setters mark the node dirty only when the value changes; Update composes the 4-node blocks that
+//    contain a dirty node and recomputes the world matrices of dirty nodes and their descendants,
+//    static nodes cost nothing after the first Update
+// A node can also hold an explicit local matrix (SetLocalMatrix) for transforms that are not TRS.
+class TransformHierarchy {
+public:
+    // statistics of the last Update
+    unsigned int blocksComposed = 0;
+    unsigned int worldsUpdated = 0;
+
+    // returns the node index; parent is -1 for a root
+    int AddNode(int parent = -1)
+    {
+        int node = (int)parents.size();
+        parents.push_back(parent < node ? parent : -1);
+        localDirty.push_back(1);
+        explicitLocal.push_back(0);
+        locals.push_back(glm::mat4(1.0f));
+        worlds.push_back(glm::mat4(1.0f));
+        if (lanes() < parents.size()) {
+            // new block of 4, filled with identity transforms
+            for (int i = 0; i < 4; i++) {
+                tx.push_back(0.0f); ty.push_back(0.0f); tz.push_back(0.0f);
+                qx.push_back(0.0f); qy.push_back(0.0f); qz.push_back(0.0f); qw.push_back(1.0f);
+                sx.push_back(1.0f); sy.push_back(1.0f); sz.push_back(1.0f);
+            }
+        }
+        return node;
+    }
+
+    int Size() const { return (int)parents.size(); }
+    int Parent(int node) const { return parents[node]; }
+
+    void SetTranslation(int node, const glm::vec3& translation)
+    {
+        update(tx[node], translation.x, node);
+        update(ty[node], translation.y, node);
+        update(tz[node], translation.z, node);
+    }
+
+    // like glm::rotate(m, angle, axis)
+    void SetRotation(int node, float angle, const glm::vec3& axis)
+    {
+        glm::vec3 unit = glm::normalize(axis);
+        float s = std::sin(angle * 0.5f);
+        update(qx[node], unit.x * s, node);
+        update(qy[node], unit.y * s, node);
+        update(qz[node], unit.z * s, node);
+        update(qw[node], std::cos(angle * 0.5f), node);
+    }
+
+    void SetScale(int node, const glm::vec3& scale)
+    {
+        update(sx[node], scale.x, node);
+        update(sy[node], scale.y, node);
+        update(sz[node], scale.z, node);
+    }
+
+    void SetLocalMatrix(int node, const glm::mat4& local)
+    {
+        explicitLocal[node] = 1;
+        if (std::memcmp(&locals[node], &local, sizeof(glm::mat4)) == 0)
+            return;
+        locals[node] = local;
+        localDirty[node] = 1;
+    }
+
+    const glm::mat4& Local(int node) const { return locals[node]; }
+    const glm::mat4& World(int node) const { return worlds[node]; }
+
+    void Update()
+    {
+        blocksComposed = 0;
+        worldsUpdated = 0;
+        int count = Size();
+        for (int block = 0; block < count; block += 4) {
+            int end = block + 4 < count ? block + 4 : count;
+            bool dirty = false;
+            for (int i = block; i < end; i++)
+                dirty = dirty || (localDirty[i] && !explicitLocal[i]);
+            if (!dirty)
+                continue;
+            composeBlock(block, end);
+            blocksComposed++;
+        }
+
+        // localDirty doubles as "world is stale": it is inherited from the parent in this pass
+        for (int i = 0; i < count; i++) {
+            int parent = parents[i];
+            if (parent >= 0 && worldDirty(parent))
+                localDirty[i] |= 2;
+            if (!localDirty[i])
+                continue;
+            if (parent < 0)
+                worlds[i] = locals[i];
+            else
+                multiply(worlds[parent], locals[i], worlds[i]);
+            worldsUpdated++;
+        }
+        for (int i = 0; i < count; i++)
+            localDirty[i] = 0;
+    }
+
+private:
+    std::vector<int> parents;
+    std::vector<uint8_t> localDirty;
+    std::vector<uint8_t> explicitLocal;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    // local TRS, one array per component
+    std::vector<float> tx, ty, tz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> sx, sy, sz;
+
+    size_t lanes() const { return tx.size(); }
+    bool worldDirty(int node) const { return localDirty[node] != 0; }
+
+    void update(float& value, float newValue, int node)
+    {
+        if (value == newValue)
+            return;
+        value = newValue;
+        localDirty[node] = 1;
+    }
+
+    // T * R * S of nodes [begin, end), begin is a multiple of 4
+    void composeBlock(int begin, int end)
+    {
+        float columns[4][4][4];   // [column][lane][row]
+#ifdef RG_TRANSFORM_SSE
+        __m128 x = _mm_loadu_ps(&qx[begin]), y = _mm_loadu_ps(&qy[begin]);
+        __m128 z = _mm_loadu_ps(&qz[begin]), w = _mm_loadu_ps(&qw[begin]);
+        __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+        __m128 scaleX = _mm_loadu_ps(&sx[begin]), scaleY = _mm_loadu_ps(&sy[begin]), scaleZ = _mm_loadu_ps(&sz[begin]);
+        __m128 m[4][4];
+        m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+        m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+        m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+        m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+        m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+        m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+        m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+        m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+        m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+        m[3][0] = _mm_loadu_ps(&tx[begin]);
+        m[3][1] = _mm_loadu_ps(&ty[begin]);
+        m[3][2] = _mm_loadu_ps(&tz[begin]);
+        m[0][3] = m[1][3] = m[2][3] = _mm_setzero_ps();
+        m[3][3] = one;
+        // one transpose per column turns "element of 4 nodes" into "column of one node"
+        for (int column = 0; column < 4; column++) {
+            _MM_TRANSPOSE4_PS(m[column][0], m[column][1], m[column][2], m[column][3]);
+            for (int lane = 0; lane < 4; lane++)
+                _mm_storeu_ps(columns[column][lane], m[column][lane]);
+        }
+#else
+        for (int lane = 0; lane < 4; lane++) {
+            int i = begin + lane;
+            float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+            float c[4][4] = {
+                    { (1.0f - 2.0f * (y * y + z * z)) * sx[i], 2.0f * (x * y + w * z) * sx[i], 2.0f * (x * z - w * y) * sx[i], 0.0f },
+                    { 2.0f * (x * y - w * z) * sy[i], (1.0f - 2.0f * (x * x + z * z)) * sy[i], 2.0f * (y * z + w * x) * sy[i], 0.0f },
+                    { 2.0f * (x * z + w * y) * sz[i], 2.0f * (y * z - w * x) * sz[i], (1.0f - 2.0f * (x * x + y * y)) * sz[i], 0.0f },
+                    { tx[i], ty[i], tz[i], 1.0f }
+            };
+            for (int column = 0; column < 4; column++)
+                std::memcpy(columns[column][lane], c[column], sizeof(c[column]));
+        }
+#endif
+        // the clean lanes were computed along but their matrices have not changed
+        for (int i = begin; i < end; i++) {
+            if (!localDirty[i] || explicitLocal[i])
+                continue;
+            glm::mat4& local = locals[i];
+            for (int column = 0; column < 4; column++) {
+                const float *c = columns[column][i - begin];
+                local[column] = glm::vec4(c[0], c[1], c[2], c[3]);
+            }
+        }
+    }
+
+    // result = a * b, result may not alias a or b
+    static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+    {
+#ifdef RG_TRANSFORM_SSE
+        __m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]);
+        __m128 a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+        for (int column = 0; column < 4; column++) {
+            const float *bc = &b[column][0];
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+            _mm_storeu_ps(&result[column][0], r);
+        }
+#else
+        result = a * b;
+#endif
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_TRANSFORMHIERARCHY_H
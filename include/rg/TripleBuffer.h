@@ -0,0 +1,72 @@
+#ifndef PROJECT_BASE_TRIPLEBUFFER_H
+#define PROJECT_BASE_TRIPLEBUFFER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace rg {
+
+// Hands whole values from one producer thread to one consumer thread without either waiting for the
+// other. The producer fills Back() and Publishes it, the consumer Acquires the newest published value
+// and reads it through Front() for as long as it likes; the third slot sits in the middle between
+// them. A value that is published again before the consumer took the previous one replaces it, the
+// consumer only ever sees the latest. Slots are reused, so vectors inside T keep their capacity.
+template<typename T>
+class TripleBuffer {
+public:
+    // producer side
+    T& Back() { return slots[back]; }
+
+    void Publish()
+    {
+        unsigned int previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+        }
+        published.notify_one();
+    }
+
+    // whether the consumer took the last published value
+    bool Consumed() const { return (middle.load(std::memory_order_acquire) & FRESH) == 0; }
+
+    // consumer side: swaps in the newest published value, false when nothing new was published
+    bool Acquire()
+    {
+        if (Consumed())
+            return false;
+        unsigned int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX;
+        return true;
+    }
+
+    // Acquire, waiting up to `timeout` for the producer
+    bool WaitAcquire(std::chrono::milliseconds timeout)
+    {
+        if (Acquire())
+            return true;
+        std::unique_lock<std::mutex> guard(lock);
+        published.wait_for(guard, timeout, [this] { return !Consumed(); });
+        guard.unlock();
+        return Acquire();
+    }
+
+    const T& Front() const { return slots[front]; }
+
+private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;
+
+    T slots[3];
+    unsigned int back = 0;     // only touched by the producer
+    unsigned int front = 1;    // only touched by the consumer
+    std::atomic<unsigned int> middle{2};
+    std::mutex lock;
+    std::condition_variable published;
+};
+
+}
+
+#endif //PROJECT_BASE_TRIPLEBUFFER_H
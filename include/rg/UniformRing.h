@@ -0,0 +1,181 @@
+#ifndef PROJECT_BASE_UNIFORMRING_H
+#define PROJECT_BASE_UNIFORMRING_H
+
+#include <glad/glad.h>
+#include <rg/ResourceRegistry.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// glad is generated for the 3.3 core profile, ARB_buffer_storage (core in 4.4) is loaded by hand
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif
+
+namespace rg {
+
+// Per draw uniform data, written by the CPU once per frame into slices of one uniform buffer that the
+// draws bind with glBindBufferRange. The buffer is split into FRAMES_IN_FLIGHT segments used in turn;
+// a fence placed after the last draw reading a segment is waited on before the segment is written
+// again, which with a few frames of latency never actually waits. With ARB_buffer_storage the buffer
+// is mapped once, persistently and coherently, and writing a slice is a plain memory write; without
+// it the slices are written to a copy in client memory and uploaded with one glBufferSubData.
+class UniformRing {
+public:
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    // BeginFrame calls that had to wait for the GPU and the time spent waiting, since creation
+    unsigned int stalls = 0;
+    double stallMilliseconds = 0.0;
+
+    // `load` is the loader glad was initialized with, slices are at least sliceSize bytes
+    UniformRing(GLADloadproc load, GLsizeiptr sliceSize)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        stride = (sliceSize + alignment - 1) / alignment * alignment;
+        if (hasBufferStorage())
+            bufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+        glGenBuffers(1, &buffer);
+        allocate(1024);
+    }
+
+    ~UniformRing()
+    {
+        deleteFences();
+        glDeleteBuffers(1, &buffer);
+    }
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    bool Persistent() const { return mapped != nullptr; }
+    GLuint Buffer() const { return buffer; }
+    GLsizeiptr Stride() const { return stride; }
+    // bytes of one segment, the most one frame can write
+    GLsizeiptr SegmentSize() const { return segmentSize; }
+
+    // Switches to the next segment, waiting until the GPU finished the frame that used it last, and
+    // grows the buffer when sliceCount slices do not fit
+    void BeginFrame(uint32_t sliceCount)
+    {
+        if ((GLsizeiptr)sliceCount * stride > segmentSize) {
+            // the old buffer lives on until the draws still reading it are done, no need to wait
+            deleteFences();
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            uint32_t slices = (uint32_t)(segmentSize / stride);
+            while (slices < sliceCount)
+                slices *= 2;
+            allocate(slices);
+        }
+        segment = (segment + 1) % FRAMES_IN_FLIGHT;
+        GLsync& fence = fences[segment];
+        if (!fence)
+            return;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            stalls++;
+            stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    // CPU address of slice `index` of this frame; any thread may write distinct slices
+    template<typename T>
+    T *Slice(uint32_t index)
+    {
+        char *base = mapped ? mapped + segment * segmentSize : staging.data();
+        return (T *)(base + index * stride);
+    }
+
+    // offset of slice `index` of this frame in Buffer(), for glBindBufferRange
+    GLintptr Offset(uint32_t index) const { return segment * segmentSize + index * stride; }
+
+    // makes the first sliceCount slices visible to the GPU; the mapping is coherent, so only the
+    // fallback has to upload anything
+    void Flush(uint32_t sliceCount)
+    {
+        if (mapped || sliceCount == 0)
+            return;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, Offset(0), sliceCount * stride, staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // after the last draw reading this frame's slices
+    void EndFrame()
+    {
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+private:
+    PFNGLBUFFERSTORAGEPROC bufferStorage = nullptr;
+    GLuint buffer = 0;
+    GLsizeiptr stride = 0;
+    GLsizeiptr segmentSize = 0;
+    int segment = 0;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    char *mapped = nullptr;
+    std::vector<char> staging;
+
+    static bool hasBufferStorage()
+    {
+        if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4))
+            return true;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+            if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0)
+                return true;
+        return false;
+    }
+
+    void allocate(uint32_t slicesPerFrame)
+    {
+        segmentSize = slicesPerFrame * stride;
+        mapped = nullptr;
+        GLsizeiptr size = segmentSize * FRAMES_IN_FLIGHT;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+            // glBufferStorage does not go through the registry's glBufferData wrapper
+            resourceRegistry().BufferData(buffer, GL_UNIFORM_BUFFER, size, GL_STREAM_DRAW);
+            mapped = (char *)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+            if (!mapped) {
+                std::cout << "ERROR::UNIFORM_RING:: persistent mapping failed, falling back to glBufferSubData" << std::endl;
+                bufferStorage = nullptr;
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            }
+        }
+        if (!mapped) {
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            staging.resize(segmentSize);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void deleteFences()
+    {
+        for (GLsync& fence : fences) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_UNIFORMRING_H
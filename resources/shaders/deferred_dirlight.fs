@@ -0,0 +1,73 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform DirLight dirLight;
+uniform vec3 clearColor;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform bool blinn;
+
+vec3 DecodeNormal(vec2 f)
+{
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 WorldPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+float Specular(vec3 normal, vec3 lightDir, vec3 viewDir)
+{
+    if(blinn){
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        return pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+    }
+    vec3 reflectDir = reflect(-lightDir, normal);
+    return pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+}
+
+void main()
+{
+    float depth = texture(gDepth, TexCoords).r;
+    if(depth == 1.0){
+        FragColor = vec4(clearColor, 1.0);
+        gl_FragDepth = 1.0;
+        return;
+    }
+
+    vec3 fragPos = WorldPosition(TexCoords, depth);
+    vec3 normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec4 albedoSpec = texture(gAlbedoSpec, TexCoords);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = Specular(normal, lightDir, viewDir);
+
+    vec3 ambient = dirLight.ambient * albedoSpec.rgb;
+    vec3 diffuse = dirLight.diffuse * diff * albedoSpec.rgb;
+    vec3 specular = dirLight.specular * spec * albedoSpec.a;
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    gl_FragDepth = depth;
+}
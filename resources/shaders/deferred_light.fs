@@ -0,0 +1,117 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in int LightIndex;
+
+// light list layout, must match rg::LightData
+#define LIGHT_DATA_TEXELS 6
+#define LIGHT_TYPE_SPOT 1.0
+// must match rg::SpotShadowAtlas
+#define SHADOW_ATLAS_TILES_PER_ROW 2
+#define MAX_SHADOWED_SPOTLIGHTS 4
+
+uniform samplerBuffer lightData;
+uniform vec2 screenSize;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform bool blinn;
+
+uniform sampler2DShadow spotShadowAtlas;
+uniform mat4 spotShadowMatrices[MAX_SHADOWED_SPOTLIGHTS];
+uniform bool spotShadows = false;
+
+vec3 DecodeNormal(vec2 f)
+{
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 WorldPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+float SpotShadow(int tile, vec3 fragPos, vec3 normal)
+{
+    // small offset along the normal on top of the polygon offset used when rendering the atlas
+    vec4 lightSpace = spotShadowMatrices[tile] * vec4(fragPos + normal * 0.02, 1.0);
+    vec3 coords = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(lightSpace.w <= 0.0 || coords.z > 1.0)
+        return 1.0;
+
+    // 2x2 taps of the hardware filtered comparison, kept inside the light's tile
+    vec2 tileOrigin = vec2(tile % SHADOW_ATLAS_TILES_PER_ROW, tile / SHADOW_ATLAS_TILES_PER_ROW);
+    vec2 texel = 1.0 / vec2(textureSize(spotShadowAtlas, 0));
+    vec2 inset = texel * float(SHADOW_ATLAS_TILES_PER_ROW) * 1.5;
+    float shadow = 0.0;
+    for(int x = 0; x < 2; x++){
+        for(int y = 0; y < 2; y++){
+            vec2 uv = clamp(coords.xy + (vec2(x, y) - 0.5) * texel * float(SHADOW_ATLAS_TILES_PER_ROW), inset, 1.0 - inset);
+            shadow += texture(spotShadowAtlas, vec3((tileOrigin + uv) / float(SHADOW_ATLAS_TILES_PER_ROW), coords.z));
+        }
+    }
+    return shadow * 0.25;
+}
+
+float Specular(vec3 normal, vec3 lightDir, vec3 viewDir)
+{
+    if(blinn){
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        return pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+    }
+    vec3 reflectDir = reflect(-lightDir, normal);
+    return pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    float depth = texture(gDepth, uv).r;
+    if(depth == 1.0)
+        discard;
+
+    int base = LightIndex * LIGHT_DATA_TEXELS;
+    vec4 positionType = texelFetch(lightData, base);
+    vec4 directionCutOff = texelFetch(lightData, base + 1);
+    vec4 ambientOuterCutOff = texelFetch(lightData, base + 2);
+    vec4 diffuseConstant = texelFetch(lightData, base + 3);
+    vec4 specularLinear = texelFetch(lightData, base + 4);
+    vec4 quadraticRange = texelFetch(lightData, base + 5);
+
+    vec3 fragPos = WorldPosition(uv, depth);
+    float distance = length(positionType.xyz - fragPos);
+    if(distance > quadraticRange.y)
+        discard;
+
+    vec3 normal = DecodeNormal(texture(gNormal, uv).rg);
+    vec4 albedoSpec = texture(gAlbedoSpec, uv);
+    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 lightDir = normalize(positionType.xyz - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = Specular(normal, lightDir, viewDir);
+    float attenuation = 1.0 / (diffuseConstant.w + specularLinear.w * distance + quadraticRange.x * (distance * distance));
+
+    float intensity = 1.0;
+    if(positionType.w == LIGHT_TYPE_SPOT){
+        float theta = dot(lightDir, normalize(-directionCutOff.xyz));
+        float epsilon = directionCutOff.w - ambientOuterCutOff.w;
+        intensity = clamp((theta - ambientOuterCutOff.w) / epsilon, 0.0, 1.0);
+        if(spotShadows && quadraticRange.z >= 0.0)
+            intensity *= SpotShadow(int(quadraticRange.z), fragPos, normal);
+    }
+
+    vec3 ambient = ambientOuterCutOff.xyz * albedoSpec.rgb;
+    vec3 diffuse = diffuseConstant.xyz * diff * albedoSpec.rgb;
+    vec3 specular = specularLinear.xyz * spec * albedoSpec.a;
+    FragColor = vec4((ambient + diffuse + specular) * attenuation * intensity, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aSphere;
+layout (location = 2) in float aLightIndex;
+
+flat out int LightIndex;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+    LightIndex = int(aLightIndex);
+    // the tessellated sphere lies inside the unit sphere, grow it a bit so it encloses the light
+    vec3 position = aSphere.xyz + aPos * aSphere.w * 1.05;
+    gl_Position = viewProjection * vec4(position, 1.0);
+}
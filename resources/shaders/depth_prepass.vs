@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 5) in mat4 instanceModel;
+
+// per draw data, declared exactly like in rb_bear_shader.fs
+layout(std140) uniform DrawData {
+    mat4 model;
+    float transparency;
+    bool hasNormalMap;
+    int objectLightCount;
+    bool instanced;
+    ivec4 objectLights[4];
+};
+uniform mat4 view;
+uniform mat4 projection;
+
+// the colour pass runs with GL_EQUAL depth testing, so the position has to be computed
+// exactly like in rb_bear_shader.vs
+invariant gl_Position;
+
+void main()
+{
+    mat4 world = instanced ? instanceModel : model;
+    vec3 fragPos = vec3(world * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,125 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec2 gNormal;
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+    sampler2D texture_normal1;
+    sampler2D texture_height1;
+
+    float shininess;
+};
+
+in VS_OUT{
+    vec2 TexCoords;
+    vec3 Normal;
+    vec3 FragPos;
+    mat3 TBN;
+} fs_in;
+
+in tangent_space{
+    vec3 TangentNormalDir;
+
+    vec3 TangentViewPos;
+    vec3 TangentFragPos;
+} ts_in;
+
+uniform Material material;
+
+// per draw data, declared exactly like in rb_bear_shader.fs
+layout(std140) uniform DrawData {
+    mat4 model;
+    float transparency;
+    bool hasNormalMap;
+    int objectLightCount;
+    bool instanced;
+    ivec4 objectLights[4];
+};
+uniform bool hasParallaxMapping = false;
+
+uniform float heightScale;
+
+vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
+{
+    // number of depth layers
+    const float minLayers = 8.0;
+    const float maxLayers = 32.0;
+    float numLayers = mix(maxLayers, minLayers, abs(dot(ts_in.TangentNormalDir, viewDir)));
+    // calculate the size of each layer
+    float layerDepth = 1.0 / numLayers;
+    // depth of current layer
+    float currentLayerDepth = 0.0;
+    // the amount to shift the texture coordinates per layer (from vector P)
+    vec2 P = viewDir.xy / viewDir.z * heightScale;
+    vec2 deltaTexCoords = P / numLayers;
+
+    // get initial values
+    vec2  currentTexCoords     = texCoords;
+    float currentDepthMapValue = texture(material.texture_height1, currentTexCoords).r;
+
+    while(currentLayerDepth < currentDepthMapValue)
+    {
+        // shift texture coordinates along direction of P
+        currentTexCoords -= deltaTexCoords;
+        // get depthmap value at current texture coordinates
+        currentDepthMapValue = texture(material.texture_height1, currentTexCoords).r;
+        // get depth of next layer
+        currentLayerDepth += layerDepth;
+    }
+
+    // get texture coordinates before collision (reverse operations)
+    vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
+
+    // get depth after and before collision for linear interpolation
+    float afterDepth  = currentDepthMapValue - currentLayerDepth;
+    float beforeDepth = texture(material.texture_height1, prevTexCoords).r - currentLayerDepth + layerDepth;
+
+    // interpolation of texture coordinates
+    float weight = afterDepth / (afterDepth - beforeDepth);
+    vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
+
+    return finalTexCoords;
+}
+
+// octahedral normal encoding, two signed components are enough for a unit vector
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+}
+
+void main()
+{
+    vec3 tangentViewDir = normalize(ts_in.TangentViewPos - ts_in.TangentFragPos);
+
+    // parallax is resolved here so the lighting passes only see the final texture coordinates
+    vec2 texCoords;
+    if(hasParallaxMapping){
+        texCoords = ParallaxMapping(fs_in.TexCoords, tangentViewDir);
+    }
+    else{
+        texCoords = fs_in.TexCoords;
+    }
+
+    vec3 norm;
+    vec2 materialTexCoords;
+    if(!hasNormalMap){
+        norm = normalize(fs_in.Normal);
+        materialTexCoords = fs_in.TexCoords;
+    }
+    else{
+        norm = texture(material.texture_normal1, texCoords).rgb;
+        norm = normalize(fs_in.TBN * normalize(norm * 2.0 - 1.0));
+        materialTexCoords = texCoords;
+    }
+
+    gAlbedoSpec.rgb = texture(material.texture_diffuse1, materialTexCoords).rgb;
+    gAlbedoSpec.a = texture(material.texture_specular1, materialTexCoords).g;
+    gNormal = EncodeNormal(norm);
+}
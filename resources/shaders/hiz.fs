@@ -0,0 +1,23 @@
+#version 330 core
+// One level of the Hi-Z pyramid (rg::DepthPyramid): the farthest depth of the texels this texel
+// covers in the level before it, or in the depth buffer for level 0.
+layout (location = 0) out float farthest;
+
+// the level read is the texture's base level, the one written is outside of its enabled levels
+uniform sampler2D source;
+// source texels per target texel along x and y, at most 2 for level 0 and exactly 2 (or 1 once an
+// axis is down to one texel) for the others
+uniform vec2 scale;
+
+void main()
+{
+    ivec2 target = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(source, 0);
+    ivec2 first = ivec2(vec2(target) * scale);
+    ivec2 last = min(ivec2(ceil(vec2(target + 1) * scale)) - 1, size - 1);
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+    farthest = depth;
+}
@@ -44,8 +44,17 @@ struct SpotLight {
     vec3 diffuse;
     vec3 specular;
 };
-#define NR_POINT_LIGHTS 1
-#define NR_SPOT_LIGHTS 4
+// light list layout, must match rg::ClusteredLights / rg::LightData
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define LIGHT_DATA_TEXELS 6
+#define LIGHT_TYPE_SPOT 1.0
+// must match rg::ObjectLightCuller::MAX_OBJECT_LIGHTS
+#define MAX_OBJECT_LIGHTS 16
+// must match rg::SpotShadowAtlas
+#define SHADOW_ATLAS_TILES_PER_ROW 2
+#define MAX_SHADOWED_SPOTLIGHTS 4
 
 in VS_OUT{
     vec2 TexCoords;
@@ -55,14 +64,6 @@ in VS_OUT{
 } fs_in;
 
 in tangent_space{
-// Direcional light direction
-    vec3 TangentDirlightDir;
-// Spotlight position & direction
-    vec3 TangentSpotlightPos[NR_SPOT_LIGHTS];
-    vec3 TangentSpotlightDir[NR_SPOT_LIGHTS];
-// Pointlight position
-    vec3 TangentPointlightPos[NR_POINT_LIGHTS];
-
     vec3 TangentNormalDir;
 
     vec3 TangentViewPos;
@@ -70,20 +71,42 @@ in tangent_space{
 } ts_in;
 
 uniform vec3 viewPos;
+uniform mat4 view;
 uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight[NR_SPOT_LIGHTS];
 uniform Material material;
 
+// point and spot lights binned into froxels on the CPU
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+uniform vec2 clusterTileSize;
+uniform float clusterSliceScale;
+uniform float clusterSliceBias;
+
+// per draw data, this draw's slice of the uniform ring (rg::DrawData in main.cpp); the block has
+// to be declared the same way in every shader that uses it
+layout(std140) uniform DrawData {
+    mat4 model;
+    float transparency;
+    bool hasNormalMap;
+    // lights reaching the object of this draw, culled on the CPU; -1 means use the froxel lists
+    int objectLightCount;
+    // the model matrix comes from the instanceModel attribute (GPU-driven draws, rb_bear_shader.vs)
+    bool instanced;
+    ivec4 objectLights[4];   // MAX_OBJECT_LIGHTS indices, four per element
+};
+
+// spotlight shadow maps, one atlas tile per lamp
+uniform sampler2DShadow spotShadowAtlas;
+uniform mat4 spotShadowMatrices[MAX_SHADOWED_SPOTLIGHTS];
+uniform bool spotShadows = false;
+
 uniform int hasPointLight = 0;
 uniform int hasSpotLight = 0;
 uniform int hasDirLight = 0;
 
-uniform int checkSpotlight[4];
-uniform float transparency = 1.0;
 uniform bool blinn;
 
-uniform bool hasNormalMap = false;
 uniform bool hasParallaxMapping = false;
 
 uniform float heightScale;
@@ -137,10 +160,79 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 TexCoords);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 TexCoords);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 TexCoords);
 
-// Tangent lights applied only if hasNormalMap is true
-SpotLight tangentSpotlights[NR_SPOT_LIGHTS];
-DirLight tangentDirlight;
-PointLight tangentPointlights[NR_POINT_LIGHTS];
+float SpotShadow(int tile, vec3 fragPos, vec3 normal)
+{
+    // small offset along the normal on top of the polygon offset used when rendering the atlas
+    vec4 lightSpace = spotShadowMatrices[tile] * vec4(fragPos + normal * 0.02, 1.0);
+    vec3 coords = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(lightSpace.w <= 0.0 || coords.z > 1.0)
+        return 1.0;
+
+    // 2x2 taps of the hardware filtered comparison, kept inside the light's tile
+    vec2 tileOrigin = vec2(tile % SHADOW_ATLAS_TILES_PER_ROW, tile / SHADOW_ATLAS_TILES_PER_ROW);
+    vec2 texel = 1.0 / vec2(textureSize(spotShadowAtlas, 0));
+    vec2 inset = texel * float(SHADOW_ATLAS_TILES_PER_ROW) * 1.5;
+    float shadow = 0.0;
+    for(int x = 0; x < 2; x++){
+        for(int y = 0; y < 2; y++){
+            vec2 uv = clamp(coords.xy + (vec2(x, y) - 0.5) * texel * float(SHADOW_ATLAS_TILES_PER_ROW), inset, 1.0 - inset);
+            shadow += texture(spotShadowAtlas, vec3((tileOrigin + uv) / float(SHADOW_ATLAS_TILES_PER_ROW), coords.z));
+        }
+    }
+    return shadow * 0.25;
+}
+
+int ClusterIndex()
+{
+    float depth = -(view * vec4(fs_in.FragPos, 1.0)).z;
+    int slice = clamp(int(log(depth) * clusterSliceScale - clusterSliceBias), 0, CLUSTER_SLICES - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), ivec2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+    return tile.x + CLUSTER_TILES_X * (tile.y + CLUSTER_TILES_Y * slice);
+}
+
+vec3 CalcClusterLight(int index, vec3 normal, vec3 viewDir, vec2 TexCoords)
+{
+    int base = index * LIGHT_DATA_TEXELS;
+    vec4 positionType = texelFetch(lightData, base);
+    vec4 quadraticRange = texelFetch(lightData, base + 5);
+    if (length(positionType.xyz - fs_in.FragPos) > quadraticRange.y)
+        return vec3(0.0);
+
+    bool spot = positionType.w == LIGHT_TYPE_SPOT;
+    if ((spot && hasSpotLight == 0) || (!spot && hasPointLight == 0))
+        return vec3(0.0);
+
+    vec4 directionCutOff = texelFetch(lightData, base + 1);
+    vec4 ambientOuterCutOff = texelFetch(lightData, base + 2);
+    vec4 diffuseConstant = texelFetch(lightData, base + 3);
+    vec4 specularLinear = texelFetch(lightData, base + 4);
+    if (spot) {
+        SpotLight light;
+        light.position = positionType.xyz;
+        light.direction = directionCutOff.xyz;
+        light.cutOff = directionCutOff.w;
+        light.outerCutOff = ambientOuterCutOff.w;
+        light.constant = diffuseConstant.w;
+        light.linear = specularLinear.w;
+        light.quadratic = quadraticRange.x;
+        light.ambient = ambientOuterCutOff.xyz;
+        light.diffuse = diffuseConstant.xyz;
+        light.specular = specularLinear.xyz;
+        float shadow = 1.0;
+        if (spotShadows && quadraticRange.z >= 0.0)
+            shadow = SpotShadow(int(quadraticRange.z), fs_in.FragPos, normal);
+        return CalcSpotLight(light, normal, fs_in.FragPos, viewDir, TexCoords) * shadow;
+    }
+    PointLight light;
+    light.position = positionType.xyz;
+    light.constant = diffuseConstant.w;
+    light.linear = specularLinear.w;
+    light.quadratic = quadraticRange.x;
+    light.ambient = ambientOuterCutOff.xyz;
+    light.diffuse = diffuseConstant.xyz;
+    light.specular = specularLinear.xyz;
+    return CalcPointLight(light, normal, fs_in.FragPos, viewDir, TexCoords);
+}
 
 void main()
 {
@@ -156,80 +248,36 @@ void main()
         texCoords = fs_in.TexCoords;
     }
 
+    // all lighting is done in world space, normal maps are brought over with the TBN matrix
     vec3 norm;
+    vec2 lightTexCoords;
     if(!hasNormalMap){
         norm = normalize(fs_in.Normal);
+        lightTexCoords = fs_in.TexCoords;
     }
     else{
         norm = texture(material.texture_normal1, texCoords).rgb;
-        norm = normalize(norm * 2.0 - 1.0);
+        norm = normalize(fs_in.TBN * normalize(norm * 2.0 - 1.0));
+        lightTexCoords = texCoords;
     }
 
     vec3 result = vec3(0.0f);
     if(hasDirLight == 1){
-            if(hasNormalMap){
-                tangentDirlight.direction = ts_in.TangentDirlightDir;
-                tangentDirlight.ambient = dirLight.ambient;
-                tangentDirlight.diffuse = dirLight.diffuse;
-                tangentDirlight.specular = dirLight.specular;
-                result += CalcDirLight(tangentDirlight, norm, tangentViewDir, texCoords);
-            }
-            else{
-                result += CalcDirLight(dirLight, norm, viewDir, fs_in.TexCoords);
-            }
+        result += CalcDirLight(dirLight, norm, viewDir, lightTexCoords);
     }
-    if (hasPointLight == 1){
-        for (int i = 0; i < NR_POINT_LIGHTS; i++){
-            if(hasNormalMap){
-                tangentPointlights[i].position = ts_in.TangentPointlightPos[i];
-
-                tangentPointlights[i].ambient = pointLights[i].ambient;
-                tangentPointlights[i].diffuse = pointLights[i].diffuse;
-                tangentPointlights[i].specular = pointLights[i].specular;
-
-                tangentPointlights[i].linear = pointLights[i].linear;
-                tangentPointlights[i].quadratic = pointLights[i].quadratic;
-                tangentPointlights[i].constant = pointLights[i].constant;
-
-                result += CalcPointLight(tangentPointlights[i], norm, ts_in.TangentFragPos, tangentViewDir, texCoords);
-            }
-            else{
-                result += CalcPointLight(pointLights[i], norm, fs_in.FragPos, viewDir, fs_in.TexCoords);
-            }
-        }
+
+    if(objectLightCount >= 0){
+        for (int i = 0; i < objectLightCount; i++)
+            result += CalcClusterLight(objectLights[i / 4][i % 4], norm, viewDir, lightTexCoords);
     }
-    if(hasSpotLight == 1){
-        for (int i = 0; i < NR_SPOT_LIGHTS; i++){
-            if (checkSpotlight[i] == 1){
-                if(hasNormalMap){
-                    tangentSpotlights[i].position = ts_in.TangentSpotlightPos[i];
-                    tangentSpotlights[i].direction = ts_in.TangentSpotlightDir[i];
-
-                    tangentSpotlights[i].ambient = spotLight[i].ambient;
-                    tangentSpotlights[i].diffuse = spotLight[i].diffuse;
-                    tangentSpotlights[i].specular = spotLight[i].specular;
-
-                    tangentSpotlights[i].linear = spotLight[i].linear;
-                    tangentSpotlights[i].quadratic = spotLight[i].quadratic;
-                    tangentSpotlights[i].constant = spotLight[i].constant;
-
-                    tangentSpotlights[i].cutOff = spotLight[i].cutOff;
-                    tangentSpotlights[i].outerCutOff = spotLight[i].outerCutOff;
-
-                    result += CalcSpotLight(tangentSpotlights[i], norm, ts_in.TangentFragPos, tangentViewDir, texCoords);
-                }
-                else{
-                    result += CalcSpotLight(spotLight[i], norm, fs_in.FragPos, viewDir, fs_in.TexCoords);
-                }
-            }
+    else{
+        uvec2 cluster = texelFetch(clusterGrid, ClusterIndex()).xy;
+        for (uint i = 0u; i < cluster.y; i++){
+            int index = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+            result += CalcClusterLight(index, norm, viewDir, lightTexCoords);
         }
     }
     FragColor = vec4(result, transparency);
-
-    //FragColor = vec4(1.0);
-
-    //FragColor = texture(material.texture_diffuse1, fs_in.TexCoords);
-
 }
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 TexCoords)
 {
@@ -252,7 +300,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     // combine results
     vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * texture(material.texture_specular1, TexCoords).xxx;
+    vec3 specular = light.specular * spec * texture(material.texture_specular1, TexCoords).ggg;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -0,0 +1,301 @@
+// Global allocation hooks of rg::AllocTracker, see include/rg/AllocTracker.h.
+#ifdef RG_ALLOC_TRACKER
+
+#include <rg/AllocTracker.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <execinfo.h>
+
+namespace {
+
+const int SAMPLE_DEPTH = 12;
+const int MAX_SAMPLES = 4096;
+const int MAX_SITES = 512;
+
+struct Sample {
+    void *frames[SAMPLE_DEPTH];
+    int depth;
+    uint64_t size;
+};
+
+std::atomic<uint64_t> totalAllocations{ 0 };
+std::atomic<uint64_t> totalBytes{ 0 };
+std::atomic<uint64_t> totalFrees{ 0 };
+
+rg::AllocationCounters frameStart;
+rg::AllocationCounters lastFrame;
+uint64_t frameIndex = 0;
+uint64_t noAllocationsFrom = UINT64_MAX;
+
+std::atomic<uint32_t> sampleInterval{ 0 };
+std::atomic<uint64_t> sampleCount{ 0 };
+Sample samples[MAX_SAMPLES];
+
+thread_local uint64_t threadAllocations = 0;
+thread_local uint64_t threadBytes = 0;
+thread_local uint64_t threadFrees = 0;
+// set while the tracker itself runs, whatever it allocates then is not counted
+thread_local bool inTracker = false;
+
+void countAllocation(size_t size)
+{
+    if (inTracker)
+        return;
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+    threadAllocations++;
+    threadBytes += size;
+
+    uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+    if (interval == 0 || (threadAllocations % interval) != 0)
+        return;
+    inTracker = true;
+    Sample& sample = samples[sampleCount.fetch_add(1, std::memory_order_relaxed) % MAX_SAMPLES];
+    sample.depth = backtrace(sample.frames, SAMPLE_DEPTH);
+    sample.size = size;
+    inTracker = false;
+}
+
+void countFree()
+{
+    if (inTracker)
+        return;
+    totalFrees.fetch_add(1, std::memory_order_relaxed);
+    threadFrees++;
+}
+
+}
+
+#if defined(__GLIBC__)
+
+// glibc's own entry points, the interposed malloc family below forwards to them
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    if (ptr)
+        countAllocation(size);
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    void *ptr = __libc_calloc(count, size);
+    if (ptr)
+        countAllocation(count * size);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *result = __libc_realloc(ptr, size);
+    if (ptr && !size) {
+        // realloc(ptr, 0) frees ptr
+        countFree();
+        return result;
+    }
+    // a block grown or shrunk in place is neither a new allocation nor a free
+    if (result && result != ptr) {
+        countAllocation(size);
+        if (ptr)
+            countFree();
+    }
+    return result;
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+        countFree();
+    __libc_free(ptr);
+}
+}
+
+// operator new goes through the interposed malloc and is counted there
+static void *trackedMalloc(size_t size) { return std::malloc(size); }
+static void trackedFree(void *ptr) { std::free(ptr); }
+
+#else
+
+static void *trackedMalloc(size_t size)
+{
+    void *ptr = std::malloc(size);
+    if (ptr)
+        countAllocation(size);
+    return ptr;
+}
+
+static void trackedFree(void *ptr)
+{
+    if (ptr)
+        countFree();
+    std::free(ptr);
+}
+
+#endif
+
+static void *allocateOrThrow(size_t size)
+{
+    if (size == 0)
+        size = 1;
+    for (;;) {
+        if (void *ptr = trackedMalloc(size))
+            return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *operator new(size_t size) { return allocateOrThrow(size); }
+void *operator new[](size_t size) { return allocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t&) noexcept { return trackedMalloc(size ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedMalloc(size ? size : 1); }
+void operator delete(void *ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+
+namespace rg {
+
+AllocationCounters AllocTracker::Totals()
+{
+    AllocationCounters counters;
+    counters.allocations = totalAllocations.load(std::memory_order_relaxed);
+    counters.bytes = totalBytes.load(std::memory_order_relaxed);
+    counters.frees = totalFrees.load(std::memory_order_relaxed);
+    return counters;
+}
+
+AllocationCounters AllocTracker::ThreadTotals()
+{
+    AllocationCounters counters;
+    counters.allocations = threadAllocations;
+    counters.bytes = threadBytes;
+    counters.frees = threadFrees;
+    return counters;
+}
+
+void AllocTracker::FrameMark()
+{
+    AllocationCounters now = Totals();
+    lastFrame.allocations = now.allocations - frameStart.allocations;
+    lastFrame.bytes = now.bytes - frameStart.bytes;
+    lastFrame.frees = now.frees - frameStart.frees;
+    frameStart = now;
+
+    if (frameIndex >= noAllocationsFrom && lastFrame.allocations > 0) {
+        std::printf("ERROR::ALLOC_TRACKER:: steady state frame %llu made %llu allocations (%llu bytes)\n",
+                    (unsigned long long)frameIndex, (unsigned long long)lastFrame.allocations,
+                    (unsigned long long)lastFrame.bytes);
+        PrintCallSites();
+        std::fflush(stdout);
+        std::abort();
+    }
+    frameIndex++;
+}
+
+AllocationCounters AllocTracker::LastFrame() { return lastFrame; }
+uint64_t AllocTracker::FrameIndex() { return frameIndex; }
+
+void AllocTracker::SetSampleInterval(uint32_t interval)
+{
+    if (interval) {
+        // backtrace loads libgcc on its first call, which must not happen inside a sampled malloc
+        void *frame;
+        bool wasInTracker = inTracker;
+        inTracker = true;
+        backtrace(&frame, 1);
+        inTracker = wasInTracker;
+    }
+    sampleInterval.store(interval, std::memory_order_relaxed);
+}
+
+uint32_t AllocTracker::SampleInterval() { return sampleInterval.load(std::memory_order_relaxed); }
+
+void AllocTracker::PrintCallSites(int maxSites)
+{
+    // identical stacks are merged; fixed tables so that nothing here allocates
+    static int siteSample[MAX_SITES];
+    static uint64_t siteCount[MAX_SITES];
+    static uint64_t siteBytes[MAX_SITES];
+    bool wasInTracker = inTracker;
+    inTracker = true;
+
+    uint64_t recorded = sampleCount.load(std::memory_order_relaxed);
+    int sampleTotal = (int)(recorded < (uint64_t)MAX_SAMPLES ? recorded : (uint64_t)MAX_SAMPLES);
+    int sites = 0;
+    for (int i = 0; i < sampleTotal; i++) {
+        const Sample& sample = samples[i];
+        int site = 0;
+        for (; site < sites; site++) {
+            const Sample& other = samples[siteSample[site]];
+            if (other.depth == sample.depth && std::memcmp(other.frames, sample.frames, sizeof(void *) * sample.depth) == 0)
+                break;
+        }
+        if (site == sites) {
+            if (sites == MAX_SITES)
+                continue;
+            siteSample[sites] = i;
+            siteCount[sites] = 0;
+            siteBytes[sites] = 0;
+            sites++;
+        }
+        siteCount[site]++;
+        siteBytes[site] += sample.size;
+    }
+
+    std::printf("ALLOC_TRACKER:: %d sampled allocations (every %u), %d call sites\n",
+                sampleTotal, SampleInterval(), sites);
+    for (int printed = 0; printed < maxSites && printed < sites; printed++) {
+        int best = printed;
+        for (int site = printed + 1; site < sites; site++)
+            if (siteCount[site] > siteCount[best])
+                best = site;
+        std::swap(siteSample[printed], siteSample[best]);
+        std::swap(siteCount[printed], siteCount[best]);
+        std::swap(siteBytes[printed], siteBytes[best]);
+
+        const Sample& sample = samples[siteSample[printed]];
+        std::printf("-- %llu samples, %llu bytes\n", (unsigned long long)siteCount[printed], (unsigned long long)siteBytes[printed]);
+        std::fflush(stdout);
+        backtrace_symbols_fd(sample.frames, sample.depth, 1);
+    }
+    std::fflush(stdout);
+    inTracker = wasInTracker;
+}
+
+void AllocTracker::ClearCallSites()
+{
+    sampleCount.store(0, std::memory_order_relaxed);
+}
+
+void AllocTracker::ExpectNoAllocationsFrom(uint64_t frame)
+{
+    noAllocationsFrom = frame;
+    if (frame != UINT64_MAX) {
+        // keep every call site so the failing frame can be explained
+        ClearCallSites();
+        SetSampleInterval(1);
+    }
+}
+
+bool AllocTracker::ExpectingNoAllocations() { return noAllocationsFrom != UINT64_MAX; }
+
+}
+
+#endif
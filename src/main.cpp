@@ -14,7 +14,38 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include <rg/ClusteredLights.h>
+#include <rg/CommandBuffer.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/EntityStore.h>
+#include <rg/LightCulling.h>
+#include <rg/GpuDrivenScene.h>
+#include <rg/GpuProfiler.h>
+#include <rg/GpuQuery.h>
+#include <rg/HitchDetector.h>
+#include <rg/JobSystem.h>
+#include <rg/InputRecording.h>
+#include <rg/ShadowAtlas.h>
+#include <rg/SoftwareOcclusion.h>
+#include <rg/StressScene.h>
+#include <rg/TransformHierarchy.h>
+#include <rg/TripleBuffer.h>
+#include <rg/UniformRing.h>
+#include <rg/DrawStats.h>
+#include <rg/AllocTracker.h>
+#include <rg/Benchmark.h>
+#include <rg/Profiler.h>
+#include <rg/ProfilerView.h>
+#include <rg/ResourceRegistry.h>
+#include <rg/SceneFile.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <type_traits>
 
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -31,6 +62,10 @@ void renderQuad();
 const unsigned int SCR_WIDTH = 1920;
 const unsigned int SCR_HEIGHT = 1080;
 
+// framebuffer size, the froxel grid of the clustered lights is laid over it
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
 // camera
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
@@ -75,15 +110,6 @@ struct PointLight {
     }
 };
 
-struct Prozor{
-    glm::vec3 position;
-    float rotateX;
-    float rotateY;
-    float rotateZ;
-
-    float windowScaleFactor;
-};
-
 struct DirLight {
     glm::vec3 direction;
 
@@ -101,6 +127,25 @@ struct ProgramState {
     DirLight dirLight;
     SpotLight spotLight;
     PointLight pointLight;
+    bool pointLightEnabled = false;
+    // decorative point lights scattered around the arena, binned by the clustered renderer
+    int extraLightCount = 0;
+    // deferred shading instead of the clustered forward pass for opaque objects (L key)
+    bool deferredShading = false;
+    // forward draws get a CPU culled light list instead of walking the froxel lists
+    bool perObjectLightLists = true;
+    // depth only pass over the opaque objects before the forward colour pass
+    bool depthPrepass = false;
+    // cached shadow maps of the four lamps
+    bool spotShadows = true;
+    // model entities culled by a compute shader and drawn with multi-draw-indirect (--gpu-driven, GL 4.3)
+    bool gpuDriven = false;
+    // the recorded entity draws skip the meshlets that are off screen or face away from the camera
+    bool meshletCulling = true;
+    // draws hidden behind the floor and the nearest models in a software depth buffer are skipped
+    bool occlusionCulling = true;
+    // procedural copies of the models, panes and lights (--stress-* options, "Stress scene" in the GUI)
+    rg::StressSceneOptions stress;
 
     glm::vec3 platformPosition = glm::vec3(0.0f, 0.4321f, 0.0f);
     glm::vec3 bearPosition = glm::vec3(0.0f, 1.205f, 0.45f);
@@ -111,7 +156,6 @@ struct ProgramState {
     bool hasNormalMapping = false;
     bool hasParallaxMapping = false;
 
-    std::vector<Prozor> prozori;
     float heightScale = 0.05;
 
     glm::vec3 spotlightPositions[4] = {
@@ -136,7 +180,78 @@ struct ProgramState {
     void LoadFromFile(std::string filename);
 };
 
-void initializeTransparentWindows(vector<Prozor> &prozori);
+// everything main() loads once and draws every frame
+struct SceneAssets {
+    Model circusBear;
+    Model pipe;
+    Model platform;
+    Model seesawModel;
+    Model flower;
+    Model lamp;
+    Model circle;
+
+    unsigned int bearTextureDiffuse, bearTextureSpecular, bearTextureNormal;
+    unsigned int platformTextureDiffuse, platformTextureSpecular, platformTextureNormal;
+    unsigned int seeSawTextureDiffuse, seeSawTextureSpecular, seeSawTextureNormal;
+    unsigned int textureLamp;
+    unsigned int floorTextureDiffuse, floorTextureSpecular, floorTextureNormal, floorTextureHeigth;
+    unsigned int transparentTexture;
+    unsigned int cubemapTexture;
+
+    unsigned int lightCubeVAO, transparentVAO, skyboxVAO;
+
+    // local space bounds used for per object light culling
+    rg::BoundingSphere bearBounds, pipeBounds, platformBounds, seesawBounds, flowerBounds, lampBounds;
+    rg::BoundingSphere quadBounds, windowBounds;
+    // models referenced by rg::MeshComponent::mesh, indexed like rg::StressModel
+    Model *meshTable[rg::STRESS_MODEL_COUNT];
+
+    SceneAssets();
+};
+
+struct DrawRecording;
+void createSceneEntities(SceneAssets& scene);
+rg::Entity createModelEntity(rg::StressModel mesh, const glm::mat4& model, int node);
+rg::Entity createWindowEntity(const glm::mat4& model);
+bool loadSceneFile(const std::string& path);
+void generateStressScene();
+void startEntityTransforms();
+void startEntityCulling(const glm::mat4& projection, const glm::mat4& view, glm::vec3 cameraPosition);
+void finishEntityCulling();
+void occlusionCullDraws(const glm::mat4& projection, const glm::mat4& view);
+void recordMeshCommands(SceneAssets& scene);
+void startDrawRecording(DrawRecording& recording, GLuint program, bool textures, rg::ObjectLightCuller *lightCuller);
+void replayDrawRecording(DrawRecording& recording);
+void bindDrawDataBlock(const Shader& shader);
+void beginDrawData();
+void writeFrameDrawData(SceneAssets& scene);
+void bindDrawData(uint32_t slice);
+void setSceneUniforms(Shader& shader, const glm::mat4& projection, const glm::mat4& view);
+void setDirLight(Shader& shader, const DirLight& dirLight);
+glm::mat4 bearModelMatrix();
+glm::mat4 seesawModelMatrix();
+glm::mat4 lampModelMatrix(int i);
+glm::mat4 flowerModelMatrix();
+glm::mat4 pipeModelMatrix();
+glm::mat4 floorModelMatrix();
+glm::mat4 platformModelMatrix();
+void buildSceneTransforms();
+void animateSceneTransforms(float currentFrame);
+void collectShadowCasters(float currentFrame, vector<glm::mat4>& staticCasters, vector<glm::mat4>& dynamicCasters);
+void drawShadowCasters(SceneAssets& scene, Shader& depthShader, float currentFrame, bool dynamic);
+rg::BoundingSphere modelBounds(const Model& model);
+void drawOpaqueScene(SceneAssets& scene, Shader& shader, DrawRecording& entityDraws);
+void createGpuDrivenScene(SceneAssets& scene, GLADloadproc load);
+void updateGpuInstances();
+void drawGpuDrivenModels(SceneAssets& scene, Shader& shader, bool textures);
+void drawReflectiveObjects(SceneAssets& scene, Shader& skyShader, const glm::mat4& projection, const glm::mat4& view, float currentFrame);
+void drawLightMarkers(SceneAssets& scene, Shader& spotlightShader, const glm::mat4& projection, const glm::mat4& view);
+void drawSkybox(SceneAssets& scene, Shader& skyboxShader, const glm::mat4& projection);
+void drawTransparentWindows(SceneAssets& scene, Shader& shader);
+glm::vec3 spotlightDirection(const ProgramState& state, int i);
+rg::LightData makeLightData(const PointLight& light);
+rg::LightData makeLightData(const SpotLight& light, glm::vec3 position, glm::vec3 direction);
+void collectSceneLights(ProgramState *programState, vector<rg::LightData> &lights);
 
 void ProgramState::SaveToFile(std::string filename) {
     std::ofstream out(filename);
@@ -179,48 +294,300 @@ bool allLightsActivated = false;
 bool antialiasing=true;
 ProgramState *programState;
 Shader *shader_rb_bear;
+rg::ClusteredLights *clusteredLights;
+// worker threads for the per frame CPU work, the GL calls stay on the thread that renders
+rg::JobSystem *jobSystem;
+rg::DeferredRenderer *deferredRenderer;
+rg::ObjectLightCuller objectLightCuller;
+// GPU cost of the opaque passes, shown in the GUI
+rg::GpuQuery *depthPrepassTime, *opaquePassTime, *opaqueSamples;
+// GPU time per pass for the "GPU passes" window
+rg::GpuPassProfiler *gpuPasses;
+rg::HitchDetector hitchDetector;
+rg::SpotShadowAtlas *spotShadowAtlas;
+rg::StressScene stressScene;
+// model matrices of the hand placed objects; only the turntable (platform with the bear on it) and the
+// bear's spin change per frame, everything else is computed once
+rg::TransformHierarchy sceneTransforms;
+struct SceneNodes {
+    int turntable, platform, bear, bearSpin, seesaw, lamps[4], flower, pipe, floor;
+} sceneNodes;
+// bear, seesaw, platform, lamps and flower, the scene file's models, windows and lights and the stress
+// copies and lights; the pipe, the floor and the lights edited in the GUI are still drawn and collected by hand
+rg::EntityStore sceneEntities;
+const uint32_t MODEL_ENTITY = rg::COMPONENT_TRANSFORM | rg::COMPONENT_MESH | rg::COMPONENT_MATERIAL | rg::COMPONENT_BOUNDS;
+const uint32_t WINDOW_ENTITY = rg::COMPONENT_TRANSFORM | rg::COMPONENT_BOUNDS | rg::COMPONENT_TRANSPARENCY;
+// what a new entity of each mesh starts with, taken from SceneAssets by createSceneEntities
+struct MeshPrototype {
+    rg::MaterialComponent material;
+    rg::BoundingSphere bounds;
+    glm::mat4 upright;   // stands the model up before it is placed
+} meshPrototypes[rg::STRESS_MODEL_COUNT];
+rg::BoundingSphere windowPrototypeBounds;
+// destroyed and recreated by generateStressScene and loadSceneFile
+vector<rg::Entity> stressEntities;
+vector<rg::Entity> sceneFileEntities;
+struct SceneFileStats {
+    std::string path;
+    double loadMilliseconds = 0.0;
+    bool compiled = false;
+    unsigned int models = 0, windows = 0, lights = 0;
+} sceneFileStats;
+// output of the culling jobs; the pointers refer into sceneEntities and stay valid until its next Create/Destroy
+struct OpaqueDraw {
+    uint64_t sortKey;   // mesh, then material
+    uint32_t mesh;
+    const rg::MaterialComponent *material;
+    const glm::mat4 *model;
+    const rg::BoundingSphere *bounds;
+};
+struct TransparentDraw {
+    float viewDistance;
+    const glm::mat4 *model;
+    const rg::BoundingSphere *bounds;
+};
+vector<OpaqueDraw> opaqueDraws;
+vector<TransparentDraw> transparentDraws;
+std::atomic<unsigned int> culledEntities{0};
+// The frame's entity jobs: transform sync, then culling of fixed size row ranges ("chunks") of every
+// archetype into the chunk's own lists, which finishEntityCulling joins in chunk order so the result
+// does not depend on which thread ran what.
+const uint32_t TRANSFORM_JOB_ROWS = 1024;
+const uint32_t CULL_JOB_ROWS = 512;
+struct CullChunk {
+    vector<OpaqueDraw> opaque;
+    vector<TransparentDraw> transparent;
+};
+struct CullBatch {
+    rg::Archetype *archetype;
+    uint32_t firstChunk;
+};
+vector<CullChunk> cullChunks;   // only the first cullChunkCount are this frame's
+uint32_t cullChunkCount = 0;
+vector<CullBatch> cullBatches;
+rg::Frustum cullFrustum;
+glm::vec3 cullCameraPosition;
+rg::JobCounter transformJobs, cullJobs;
+// Occlusion culling of the draws the frustum kept, on the CPU: the floor and the MAX_OCCLUDERS opaque
+// draws covering the most of the screen are rasterized by the workers into occlusionBuffer, each model as
+// its OCCLUDER_TRIANGLES largest triangles, then the bounding sphere of every draw is tested against it.
+const size_t MAX_OCCLUDERS = 16;
+const size_t OCCLUDER_TRIANGLES = 256;
+const uint32_t OCCLUSION_JOB_DRAWS = 256;
+rg::OcclusionBuffer occlusionBuffer;
+rg::OccluderMesh occluderMeshes[rg::STRESS_MODEL_COUNT];
+rg::OccluderMesh floorOccluder;
+vector<unsigned char> occlusionVisible;   // opaqueDraws, then transparentDraws
+vector<std::pair<float, uint32_t>> occluderCandidates;
+unsigned int occludedDraws = 0;
+// The sorted opaque draws of a pass are recorded by jobs into command buffers, RECORD_JOB_DRAWS draws
+// per chunk, while the GL thread renders the shadow atlas; the pass then only replays the chunks in order.
+const uint32_t RECORD_JOB_DRAWS = 256;
+struct RecordChunk {
+    rg::CommandBuffer commands;
+    // for the object light culler's statistics
+    unsigned int draws, clusteredDraws, assignedLights;
+    rg::MeshletSet::CullStats meshlets;
+    vector<rg::MeshletSet::Range> visibleRanges;   // scratch of MeshletSet::Cull
+};
+struct DrawRecording {
+    GLuint program = 0;
+    bool textures = false;   // material and mesh textures; also writes the entities' DrawData slices
+    rg::ObjectLightCuller *lightCuller = nullptr;
+    vector<RecordChunk> chunks;   // only the first chunkCount are this frame's
+    uint32_t chunkCount = 0;
+};
+DrawRecording depthPrepassDraws, opaquePassDraws;
+rg::JobCounter recordJobs;
+rg::CommandReplay commandReplay;
+// what drawing one entity of each mesh records after its material and DrawData slice: per mesh of the
+// model its texture binds, then the mesh, whole or the index ranges of its visible meshlets
+struct MeshPart {
+    rg::CommandBuffer textures;
+    const Mesh *mesh;
+};
+vector<MeshPart> meshParts[rg::STRESS_MODEL_COUNT];
+// this frame's frustum and camera in the model space of one draw, for MeshletSet::Cull
+struct MeshletView {
+    glm::vec4 planes[6];
+    glm::vec3 camera;
+    bool cones;   // only while back faces are culled, the cones say nothing about front faces
+};
+
+// Per draw data of the material shaders, the std140 DrawData block of rb_bear_shader.fs. Every draw
+// of a frame has its own slice of drawDataRing: the pipe, the floor tiles, the opaque entities in
+// opaqueDraws order and the windows in transparentDraws order, written once per frame and bound with
+// glBindBufferRange by all passes drawing them.
+struct DrawData {
+    glm::mat4 model;
+    float transparency;
+    int hasNormalMap;
+    int objectLightCount;   // -1: the froxel lists
+    int instanced;          // the model matrix is the instanceModel attribute of a GpuDrivenScene draw
+    int objectLights[rg::ObjectLightCuller::MAX_OBJECT_LIGHTS];
+};
+static_assert(offsetof(DrawData, objectLights) == 80 && sizeof(DrawData) == 144, "std140 layout of the DrawData block");
+const GLuint DRAW_DATA_BINDING = 0;
+const uint32_t FLOOR_TILES = 50 * 50;
+rg::UniformRing *drawDataRing;
+struct DrawDataSlices {
+    uint32_t pipe, floor, entities, windows, gpuModels, count;
+} drawDataSlices;
+
+// --gpu-driven: the model entities are instances of gpuScene, culled on the GPU against the frustum and
+// the previous frame's depthPyramid instead of by the culling jobs. The instances mirror the entities
+// and are rebuilt when sceneEntities' version changes; those following a TransformHierarchy node come
+// first and are uploaded every frame. Both stay null without a GL 4.3 context.
+rg::GpuDrivenScene *gpuScene = nullptr;
+rg::DepthPyramid *depthPyramid = nullptr;
+bool gpuDrivenFrame = false;
+uint64_t gpuInstancesVersion = ~0ull;
+struct GpuDynamicInstance {
+    const glm::mat4 *model;
+    const rg::BoundingSphere *bounds;
+};
+vector<GpuDynamicInstance> gpuDynamicInstances;
 
 Shader *skyShader;
 bool colorSky = false;
 
+// Everything the render side of a frame reads. The simulation copies its state into a snapshot once
+// per frame, the renderer (a thread of its own with --pipelined) draws the newest one, so neither
+// reads what the other writes.
+struct FrameSnapshot {
+    float time = 0.0f;
+    ProgramState state;
+    bool spotlights[4];
+    bool faceculling, blinn, antialiasing, colorSky;
+    int framebufferWidth, framebufferHeight;
+    glm::mat4 projection, view;
+    vector<glm::mat4> nodeWorlds;      // sceneTransforms world matrices by node
+    vector<rg::LightData> lights;      // collectSceneLights
+};
+rg::TripleBuffer<FrameSnapshot> frameSnapshots;
+// the snapshot being rendered
+const FrameSnapshot *frame = nullptr;
+void takeFrameSnapshot(FrameSnapshot& snapshot, float currentFrame);
+
 
 void DrawImGui(ProgramState *programState);
+unsigned int createBenchmarkFramebuffer(int width, int height);
+rg::CameraSpline benchmarkCameraPath();
+void aimCamera(Camera& camera, glm::vec3 position, glm::vec3 target);
 
-int main() {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+// framebuffer the scene is drawn into: the window's, or an offscreen one in --bench mode
+unsigned int sceneFramebuffer = 0;
+
+// ProgramState fields the GUI edits, recorded with the input so a replay reproduces the edits
+struct ReplaySettings {
+    glm::vec3 clearColor;
+    DirLight dirLight;
+    SpotLight spotLight;
+    PointLight pointLight;
+    int extraLightCount;
+    rg::StressSceneOptions stress;
+    float heightScale;
+    bool ImGuiEnabled;
+    bool CameraMouseMovementUpdateEnabled;
+    bool pointLightEnabled;
+    bool deferredShading;
+    bool perObjectLightLists;
+    bool depthPrepass;
+    bool spotShadows;
+    bool gpuDriven;
+    bool meshletCulling;
+    bool occlusionCulling;
+    bool hasNormalMapping;
+    bool hasParallaxMapping;
+};
+static_assert(std::is_trivially_copyable<ReplaySettings>::value && std::is_trivially_copyable<Camera>::value,
+              "the input recording stores them as raw bytes");
+
+// --record/--replay
+rg::InputRecorder inputRecorder;
+rg::InputReplay inputReplay;
+bool replaying = false;
+// set while the replay calls the GLFW callbacks, live events are ignored during a replay
+bool dispatchingReplay = false;
+// keys processInput polls, their state is recorded as a bit mask per frame in this order
+const int polledKeys[] = { GLFW_KEY_ESCAPE, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+
+void captureReplaySettings(const ProgramState& state, ReplaySettings& settings);
+void applyReplaySettings(const ReplaySettings& settings, ProgramState& state);
+bool keyDown(GLFWwindow *window, int key);
+uint32_t heldKeyMask(GLFWwindow *window);
+void exchangeRecordedInput(GLFWwindow *window, ReplaySettings& settings);
+
+int main(int argc, char **argv) {
+    std::chrono::steady_clock::time_point startupBegin = std::chrono::steady_clock::now();
+    rg::BenchmarkOptions bench = rg::parseBenchmarkOptions(argc, argv);
+    rg::HeadlessContext headlessContext;
+    GLFWwindow *window = NULL;
+    // also loads the entry points glad's 3.3 profile does not know about
+    GLADloadproc glLoader;
+    if (bench.enabled) {
+        // --bench: no window, the scene goes into an offscreen framebuffer
+        // --gpu-driven needs 4.3, without it the benchmark runs the regular path
+        if (!(bench.gpuDriven && headlessContext.Create(4, 3)) && !headlessContext.Create(3, 3))
+            return -1;
+        glLoader = (GLADloadproc) eglGetProcAddress;
+        if (!gladLoadGLLoader(glLoader)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        framebufferWidth = bench.width;
+        framebufferHeight = bench.height;
+        glViewport(0, 0, bench.width, bench.height);
+    }
+    else {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, bench.gpuDriven ? 4 : 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SAMPLES, 4);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw init, create window, glad && callback functions
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        // glfw init, create window, glad && callback functions
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL && bench.gpuDriven) {
+            // no 4.3 context, --gpu-driven falls back to the regular path
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        }
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        // tell GLFW to capture our mouse
+
+
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        glLoader = (GLADloadproc) glfwGetProcAddress;
+        if (!gladLoadGLLoader(glLoader)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetKeyCallback(window, key_callback);
-    // tell GLFW to capture our mouse
-
-
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    rg::installDrawCounters();
+    rg::installResourceTracking();
+    if (bench.enabled) {
+        rg::ResourceOwnerScope owner("benchmark framebuffer");
+        sceneFramebuffer = createBenchmarkFramebuffer(bench.width, bench.height);
     }
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
@@ -229,20 +596,52 @@ int main() {
     programState = new ProgramState;
     shader_rb_bear = new Shader("resources/shaders/rb_bear_shader.vs", "resources/shaders/rb_bear_shader.fs");
     skyShader = new Shader("resources/shaders/sky_shader.vs","resources/shaders/sky_shader.fs");
-
-    programState->LoadFromFile("resources/program_state.txt");
-    if (programState->ImGuiEnabled) {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    {
+        rg::ResourceOwnerScope owner("clustered lights");
+        clusteredLights = new rg::ClusteredLights;
+    }
+    jobSystem = new rg::JobSystem(bench.jobThreads);
+    depthPrepassTime = new rg::GpuQuery(GL_TIME_ELAPSED);
+    opaquePassTime = new rg::GpuQuery(GL_TIME_ELAPSED);
+    opaqueSamples = new rg::GpuQuery(GL_SAMPLES_PASSED);
+    gpuPasses = new rg::GpuPassProfiler();
+    {
+        rg::ResourceOwnerScope owner("spotlight shadow atlas");
+        spotShadowAtlas = new rg::SpotShadowAtlas;
+    }
+    {
+        rg::ResourceOwnerScope owner("deferred G-buffer");
+        deferredRenderer = new rg::DeferredRenderer;
+    }
+    {
+        rg::ResourceOwnerScope owner("per draw uniform ring");
+        drawDataRing = new rg::UniformRing(glLoader, sizeof(DrawData));
+    }
+    vector<glm::mat4> staticShadowCasters, dynamicShadowCasters;
+
+    if (bench.enabled) {
+        // the saved state is skipped so every run renders the same scene
+        programState->extraLightCount = bench.extraLights;
+        programState->deferredShading = bench.deferredShading;
+        programState->depthPrepass = bench.depthPrepass;
+        programState->meshletCulling = bench.meshletCulling;
+        programState->occlusionCulling = bench.occlusionCulling;
     }
-    // Init Imgui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO &io = ImGui::GetIO();
-    (void) io;
+    else {
+        programState->LoadFromFile("resources/program_state.txt");
+        if (programState->ImGuiEnabled) {
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        }
+        // Init Imgui
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO();
+        (void) io;
 
 
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
 
     // configure global opengl state
     //2/ -----------------------------
@@ -252,53 +651,22 @@ int main() {
 
     Shader skyboxShader("resources/shaders/skybox_shader.vs","resources/shaders/skybox_shader.fs");
     Shader spotlightShader("resources/shaders/spotlightShader.vs","resources/shaders/spotlightShader.fs");
-
-    //model bear
-    Model circusBear("resources/objects/circus_bear/14089_Circus_Bear_Standing_on_large_ball_v1_l2.obj");
-    circusBear.SetShaderTextureNamePrefix("material.");
-    unsigned int bearTextureDiffuse = loadTexture("resources/objects/circus_bear/14089_Circus_bear_standing_on_large_ball_diffuse.jpg");
-    unsigned int bearTextureSpecular = loadTexture("resources/objects/circus_bear/ball_diffuse.jpg");
-    unsigned int bearTextureNormal = loadTexture("resources/objects/circus_bear/cap_diffuse2.jpg");
-
-    //model pipe
-    Model pipe("resources/objects/tube/tube.obj");
-    pipe.SetShaderTextureNamePrefix("material.");
-
-    //model platform
-    Model platform("resources/objects/platform/Rotating_Light_Platform_Final.fbx");
-    platform.SetShaderTextureNamePrefix("material.");
-    unsigned int platformTextureDiffuse = loadTexture("resources/objects/platform/lambert1_metallic.jpg");
-    unsigned int platformTextureSpecular = loadTexture("resources/objects/platform/lambert1_roughness.jpg");
-    unsigned int platformTextureNormal = loadTexture("resources/objects/platform/lambert1_normal.png");
-
-    //model seesaw
-    Model seesawModel("resources/objects/seesaw/10547_Childrens_Seesaw_v2-L3.obj");
-    seesawModel.SetShaderTextureNamePrefix("material.");
-    unsigned int seeSawTextureDiffuse = loadTexture("resources/objects/seesaw/seesaw.jpg");
-    unsigned int seeSawTextureSpecular = loadTexture("resources/objects/seesaw/seesaw.jpg");
-    unsigned int seeSawTextureNormal = loadTexture("resources/objects/seesaw/seesaw.jpg");
-
-    //model flower
-    Model flower("resources/objects/flower/12974_crocus_flower_v1_l3.obj");
-    flower.SetShaderTextureNamePrefix("material.");
-
-
-    //model lamp
-    Model lamp("resources/objects/lamp/Euro Spot LED czarny 1f.obj");
-    lamp.SetShaderTextureNamePrefix("material.");
-    unsigned int textureLamp = loadTexture("resources/objects/lamp/metal.jpg");
-
-    unsigned int floorTextureDiffuse = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture.jpg");
-    unsigned int floorTextureSpecular = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_SPECULAR.jpg");
-    unsigned int floorTextureNormal = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_NORMAL.jpg");
-    unsigned int floorTextureHeigth = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_DISP.jpg");
-
-    //model circle
-    Model circle("resources/objects/circle-obj/circle.obj");
-    circle.SetShaderTextureNamePrefix("material.");
-
-    vector<Prozor> &prozori = programState->prozori;
-    initializeTransparentWindows(prozori);
+    Shader depthPrepassShader("resources/shaders/depth_prepass.vs","resources/shaders/depth_prepass.fs");
+    bindDrawDataBlock(*shader_rb_bear);
+    bindDrawDataBlock(depthPrepassShader);
+    bindDrawDataBlock(deferredRenderer->GeometryShader());
+
+    SceneAssets scene;
+
+    buildSceneTransforms();
+    createSceneEntities(scene);
+    recordMeshCommands(scene);
+    if (bench.gpuDriven)
+        createGpuDrivenScene(scene, glLoader);
+    programState->gpuDriven = gpuScene != nullptr;
+    loadSceneFile(bench.scenePath);
+    programState->stress = bench.stress;
+    generateStressScene();
 
     SpotLight& spotLight = programState->spotLight;
     spotLight.direction = glm::normalize(programState->bearPosition - programState->spotLight.position);
@@ -326,589 +694,965 @@ int main() {
     dirLight.diffuse = glm::vec3(0.3f);
     dirLight.specular = glm::vec3(0.4f);
 
-    // cube data
-    float cubeVertices[] = {
-            // positions          // normals           // texture coords
-            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-            0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-            -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
 
-            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-            0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-            -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
+    skyboxShader.use();
+    skyboxShader.setInt("skybox", 0);
 
-            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+    skyShader->use();
+    skyShader->setInt("skybox", 0);
 
-            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-            0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-            0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+    // Brzina pomeranja na tastaturi
+    programState->camera.MovementSpeed = 7.0f;
 
-            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-            0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
+    // the recording stores the camera and GUI settings the session started with, a replay starts from them
+    ReplaySettings replaySettings;
+    captureReplaySettings(*programState, replaySettings);
+    if (!bench.replayPath.empty()) {
+        if (!inputReplay.Open(bench.replayPath, &programState->camera, sizeof(Camera), &replaySettings, sizeof(ReplaySettings)))
+            return -1;
+        applyReplaySettings(replaySettings, *programState);
+        replaying = true;
+        if (window)
+            glfwSetInputMode(window, GLFW_CURSOR, programState->ImGuiEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+    }
+    else if (!bench.recordPath.empty())
+        inputRecorder.Open(bench.recordPath, &programState->camera, sizeof(Camera), &replaySettings, sizeof(ReplaySettings));
+
+    rg::CameraSpline benchCameraPath = benchmarkCameraPath();
+    rg::BenchmarkRecorder *benchRecorder = bench.enabled ? new rg::BenchmarkRecorder(bench.warmupFrames) : nullptr;
+    int benchFrame = 0;
+    // the counters only go to the log from the first frame on, not the loading before it
+    bool statsStarted = false;
+    // a dump would write a file in the middle of the measured frames
+    hitchDetector.enabled = !bench.enabled;
+#ifdef RG_ALLOC_TRACKER
+    // FrameMark at the start of iteration i closes iteration i - 1
+    if (bench.allocAssert)
+        rg::AllocTracker::ExpectNoAllocationsFrom((uint64_t)bench.warmupFrames + 1);
+#else
+    if (bench.allocAssert)
+        std::cout << "WARNING::BENCHMARK:: --alloc-assert needs a build with RG_ALLOC_TRACKER" << std::endl;
+#endif
 
-            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-    };
+    // everything drawn from one frame snapshot, on the main thread or on the render thread with --pipelined
+    auto renderFrame = [&](){
+        float currentFrame = frame->time;
+        const glm::mat4& projection = frame->projection;
+        const glm::mat4& view = frame->view;
+        rg::beginDrawStatsFrame(statsStarted);
+        statsStarted = true;
+        hitchDetector.FrameMark();
+        gpuPasses->BeginFrame();
+        commandReplay.ResetStatistics();
+        // the callbacks only flip the toggles, their GL state is applied by the thread owning the context
+        glViewport(0, 0, frame->framebufferWidth, frame->framebufferHeight);
+        if(frame->antialiasing)
+            glEnable(GL_MULTISAMPLE);
+        else
+            glDisable(GL_MULTISAMPLE);
 
-    // lightCubeVAO with cube data
-    unsigned int VBO, lightCubeVAO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glGenBuffers(1, &VBO);
+        {
+            RG_PROFILE_ZONE("Scene transforms");
+            startEntityTransforms();
+        }
 
-    glBindVertexArray(lightCubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+        // frustum culling runs on the workers once the transforms are synced, next to the light binning
+        gpuDrivenFrame = frame->state.gpuDriven && gpuScene;
+        startEntityCulling(projection, view, frame->state.camera.Position);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+        // point lights and spotlights are binned into the froxel grid
+        {
+            RG_PROFILE_ZONE("Light clustering");
+            clusteredLights->Build(frame->lights, view, glm::radians(frame->state.camera.Zoom),
+                                   (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f, jobSystem);
+            clusteredLights->Upload();
+            objectLightCuller.SetLights(clusteredLights->Lights());
+            objectLightCuller.enabled = frame->state.perObjectLightLists;
+        }
 
-    // windows transparent data
-    float transparentVertices[] = {
-            // positions         // texture Coords (swapped y coordinates because texture is flipped upside down)
-            0.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  1.0f,
-            1.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  1.0f,
+        // opaque draws grouped by mesh and material, windows sorted back to front
+        {
+            RG_PROFILE_ZONE("Cull and sort entities");
+            finishEntityCulling();
+        }
+        if(frame->state.occlusionCulling){
+            RG_PROFILE_ZONE("Occlusion culling");
+            occlusionCullDraws(projection, view);
+        }
+        if(gpuDrivenFrame){
+            RG_PROFILE_ZONE("GPU culling");
+            rg::GpuPassScope gpuPass(*gpuPasses, "GPU culling");
+            updateGpuInstances();
+            gpuScene->Cull(cullFrustum, frame->colorSky, depthPyramid);
+        }
+        {
+            RG_PROFILE_ZONE("Draw data");
+            beginDrawData();
+        }
+        bool depthPrepass = frame->state.depthPrepass && !frame->state.deferredShading;
+        // recorded by the jobs while the shadow atlas is rendered, replayed by the passes
+        depthPrepassDraws.chunkCount = 0;
+        if(depthPrepass)
+            startDrawRecording(depthPrepassDraws, depthPrepassShader.ID, false, nullptr);
+        if(frame->state.deferredShading)
+            startDrawRecording(opaquePassDraws, deferredRenderer->GeometryShader().ID, true, nullptr);
+        else
+            startDrawRecording(opaquePassDraws, shader_rb_bear->ID, true, &objectLightCuller);
+        // the slices of the draws that are not recorded, next to the recording jobs writing the entities'
+        {
+            RG_PROFILE_ZONE("Draw data");
+            writeFrameDrawData(scene);
+        }
 
-            0.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  0.0f,
-            1.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  1.0f,
-            1.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  0.0f
-    };
+        // spotlight shadow maps, only the tiles whose light or casters moved are re-rendered
+        if(frame->state.spotShadows){
+            RG_PROFILE_ZONE("Shadow atlas");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Shadow atlas");
+            glm::mat4 lightMatrices[rg::SpotShadowAtlas::MAX_LIGHTS];
+            for(int i = 0; i < 4; i++)
+                lightMatrices[i] = rg::spotLightMatrix(makeLightData(frame->state.spotLight, frame->state.spotlightPositions[i], spotlightDirection(frame->state, i)));
+            collectShadowCasters(currentFrame, staticShadowCasters, dynamicShadowCasters);
+            spotShadowAtlas->Update(lightMatrices, frame->spotlights, staticShadowCasters, dynamicShadowCasters,
+                                    [&](Shader& depthShader, bool dynamic){
+                                        drawShadowCasters(scene, depthShader, currentFrame, dynamic);
+                                    });
+        }
 
-    // transparent VAO with transparent data
-    unsigned int transparentVAO, transparentVBO;
-    glGenVertexArrays(1, &transparentVAO);
-    glGenBuffers(1, &transparentVBO);
-    glBindVertexArray(transparentVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+        // forward shading config, also used by the transparent windows in the deferred path
+        {
+            RG_PROFILE_ZONE("Scene uniforms");
+            shader_rb_bear->use();
+            shader_rb_bear->setBool("blinn", frame->blinn);
+            hasLights(*shader_rb_bear, true, true, true);
+            setSceneUniforms(*shader_rb_bear, projection, view);
+            clusteredLights->Bind(*shader_rb_bear, 8, (float) frame->framebufferWidth, (float) frame->framebufferHeight);
+            setDirLight(*shader_rb_bear, frame->state.dirLight);
+            shader_rb_bear->setBool("spotShadows", frame->state.spotShadows);
+            spotShadowAtlas->Bind(*shader_rb_bear, 11);
+        }
 
-    unsigned int transparentTexture = loadTexture("resources/textures/window.png");
+        // all DrawData slices are written once the recording jobs are done
+        {
+            RG_PROFILE_ZONE("Wait for draw recording");
+            jobSystem->Wait(recordJobs);
+            drawDataRing->Flush(drawDataSlices.count);
+        }
 
-    // skybox data
-    float skyboxVertices[] = {
-            // positions
-            -1.0f,  1.0f, -1.0f,
-            -1.0f, -1.0f, -1.0f,
-            1.0f, -1.0f, -1.0f,
-            1.0f, -1.0f, -1.0f,
-            1.0f,  1.0f, -1.0f,
-            -1.0f,  1.0f, -1.0f,
+        // color and depth
 
-            -1.0f, -1.0f,  1.0f,
-            -1.0f, -1.0f, -1.0f,
-            -1.0f,  1.0f, -1.0f,
-            -1.0f,  1.0f, -1.0f,
-            -1.0f,  1.0f,  1.0f,
-            -1.0f, -1.0f,  1.0f,
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+        glClearColor(frame->state.clearColor.r, frame->state.clearColor.g, frame->state.clearColor.b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            1.0f, -1.0f, -1.0f,
-            1.0f, -1.0f,  1.0f,
-            1.0f,  1.0f,  1.0f,
-            1.0f,  1.0f,  1.0f,
-            1.0f,  1.0f, -1.0f,
-            1.0f, -1.0f, -1.0f,
+        if(depthPrepass){
+            RG_PROFILE_ZONE("Depth pre-pass");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Depth pre-pass");
+            // lay down the nearest depth first so the expensive fragment shader only runs once per pixel
+            depthPrepassTime->Begin();
+            depthPrepassShader.use();
+            depthPrepassShader.setMat4("projection", projection);
+            depthPrepassShader.setMat4("view", view);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            drawOpaqueScene(scene, depthPrepassShader, depthPrepassDraws);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            depthPrepassTime->End();
+
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
 
-            -1.0f, -1.0f,  1.0f,
-            -1.0f,  1.0f,  1.0f,
-            1.0f,  1.0f,  1.0f,
-            1.0f,  1.0f,  1.0f,
-            1.0f, -1.0f,  1.0f,
-            -1.0f, -1.0f,  1.0f,
+        opaquePassTime->Begin();
+        opaqueSamples->Begin();
+        gpuPasses->BeginPass("Opaque pass");
+        if(frame->state.deferredShading){
+            RG_PROFILE_ZONE("Deferred opaque pass");
+            deferredRenderer->Resize(frame->framebufferWidth, frame->framebufferHeight);
+            deferredRenderer->BeginGeometryPass();
+            Shader& geometryShader = deferredRenderer->GeometryShader();
+            geometryShader.use();
+            setSceneUniforms(geometryShader, projection, view);
+            drawOpaqueScene(scene, geometryShader, opaquePassDraws);
+            deferredRenderer->EndGeometryPass(sceneFramebuffer);
+
+            Shader& dirLightShader = deferredRenderer->DirectionalShader();
+            dirLightShader.use();
+            setDirLight(dirLightShader, frame->state.dirLight);
+            Shader& lightVolumeShader = deferredRenderer->LightVolumeShader();
+            lightVolumeShader.use();
+            lightVolumeShader.setBool("spotShadows", frame->state.spotShadows);
+            spotShadowAtlas->Bind(lightVolumeShader, 11);
+            deferredRenderer->LightingPass(*clusteredLights, projection, view, frame->state.camera.Position,
+                                           frame->state.clearColor, frame->blinn);
+        }
+        else{
+            RG_PROFILE_ZONE("Forward opaque pass");
+            shader_rb_bear->use();
+            drawOpaqueScene(scene, *shader_rb_bear, opaquePassDraws);
+        }
+        gpuPasses->EndPass();
+        opaqueSamples->End();
+        opaquePassTime->End();
 
-            -1.0f,  1.0f, -1.0f,
-            1.0f,  1.0f, -1.0f,
-            1.0f,  1.0f,  1.0f,
-            1.0f,  1.0f,  1.0f,
-            -1.0f,  1.0f,  1.0f,
-            -1.0f,  1.0f, -1.0f,
+        if(depthPrepass){
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+        // the GPU culling of the next frame tests against the opaque depth of this one
+        if(gpuDrivenFrame){
+            RG_PROFILE_ZONE("Hi-Z pyramid");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Hi-Z pyramid");
+            depthPyramid->Build(sceneFramebuffer, frame->framebufferWidth, frame->framebufferHeight, projection * view);
+        }
+        else if(depthPyramid)
+            depthPyramid->Invalidate();
+        {
+            RG_PROFILE_ZONE("Reflective objects");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Reflective objects");
+            drawReflectiveObjects(scene, *skyShader, projection, view, currentFrame);
+        }
 
-            -1.0f, -1.0f, -1.0f,
-            -1.0f, -1.0f,  1.0f,
-            1.0f, -1.0f, -1.0f,
-            1.0f, -1.0f, -1.0f,
-            -1.0f, -1.0f,  1.0f,
-            1.0f, -1.0f,  1.0f
+        glDisable(GL_CULL_FACE);
+        {
+            RG_PROFILE_ZONE("Light markers");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Light markers");
+            drawLightMarkers(scene, spotlightShader, projection, view);
+        }
+        {
+            RG_PROFILE_ZONE("Skybox");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Skybox");
+            drawSkybox(scene, skyboxShader, projection);
+        }
+        {
+            RG_PROFILE_ZONE("Transparent windows");
+            rg::GpuPassScope gpuPass(*gpuPasses, "Transparent windows");
+            drawTransparentWindows(scene, *shader_rb_bear);
+        }
+        // the GPU is done with this frame's slices once it passed the fence
+        drawDataRing->EndFrame();
     };
 
-    // skyboxVAO with skybox data and texture loading from resources/textures/skybox/
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    vector<std::string> faces
-            {
-                    FileSystem::getPath("resources/textures/skybox/right.png"),
-                    FileSystem::getPath("resources/textures/skybox/left.png"),
-                    FileSystem::getPath("resources/textures/skybox/top.png"),
-                    FileSystem::getPath("resources/textures/skybox/bottom.png"),
-                    FileSystem::getPath("resources/textures/skybox/front.png"),
-                    FileSystem::getPath("resources/textures/skybox/back.png")
-            };
-
-    unsigned int cubemapTexture = loadCubemap(faces);
-
-    skyboxShader.use();
-    skyboxShader.setInt("skybox", 0);
-
-    skyShader->use();
-    skyShader->setInt("skybox", 0);
+    // --pipelined: a render thread owns the context and draws snapshot N while the main thread handles
+    // the input and simulates N + 1. It only runs while the GUI is closed, ImGui needs the thread that
+    // polls the events, and the entities are only created or destroyed from the GUI meanwhile.
+    bool pipelined = bench.pipelined && !bench.enabled;
+    std::thread renderThread;
+    std::atomic<bool> stopRendering{false};
+    auto startRenderThread = [&](){
+        glfwMakeContextCurrent(NULL);
+        stopRendering = false;
+        renderThread = std::thread([&](){
+            glfwMakeContextCurrent(window);
+            while(!stopRendering){
+                if(!frameSnapshots.WaitAcquire(std::chrono::milliseconds(100)))
+                    continue;
+                // the main thread waits for the snapshot to be taken before it simulates the next one
+                glfwPostEmptyEvent();
+                frame = &frameSnapshots.Front();
+                renderFrame();
+                RG_PROFILE_ZONE("Swap buffers");
+                glfwSwapBuffers(window);
+            }
+            glfwMakeContextCurrent(NULL);
+        });
+    };
+    auto stopRenderThread = [&](){
+        stopRendering = true;
+        renderThread.join();
+        glfwMakeContextCurrent(window);
+    };
 
-    shader_rb_bear->use();
-    shader_rb_bear->setBool("blinn", blinn);
-
-    // Brzina pomeranja na tastaturi
-    programState->camera.MovementSpeed = 7.0f;
-
-    while (!glfwWindowShouldClose(window)) {
-        // FPS lock
-        float currentFrame=(float)glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+    bool benchReplay = bench.enabled && replaying;
+    while (bench.enabled ? (benchReplay || benchFrame < bench.warmupFrames + bench.frames) : !glfwWindowShouldClose(window)) {
+        if(pipelined){
+            if(programState->ImGuiEnabled == renderThread.joinable()){
+                if(programState->ImGuiEnabled)
+                    stopRenderThread();
+                else
+                    startRenderThread();
+            }
+            if(renderThread.joinable() && !frameSnapshots.Consumed()){
+                RG_PROFILE_ZONE("Wait for render thread");
+                glfwWaitEventsTimeout(0.1);
+                continue;
+            }
+        }
+        RG_PROFILE_FRAME();
+#ifdef RG_ALLOC_TRACKER
+        rg::AllocTracker::FrameMark();
+#endif
+        float currentFrame;
+        // a replay supplies the time and held keys the frame was recorded with
+        float replayDeltaTime = 0.0f;
+        uint32_t replayKeys = 0;
+        if (replaying && !inputReplay.NextFrame(currentFrame, replayDeltaTime, replayKeys)) {
+            replaying = false;
+            std::cout << "INPUT_REPLAY:: finished after " << inputReplay.Frame() << " frames" << std::endl;
+            if (benchReplay)
+                break;
+        }
+        if (bench.enabled) {
+            if (benchFrame == 0)
+                benchRecorder->startupMilliseconds = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - startupBegin).count();
+            benchRecorder->BeginFrame();
+            if (!replaying) {
+                // fixed 60 Hz time step and camera spline, warm-up frames stay at the start of the path
+                currentFrame = (float)benchFrame / 60.0f;
+                float t = (float)std::max(0, benchFrame - bench.warmupFrames) / (float)bench.frames;
+                glm::vec3 position, target;
+                benchCameraPath.Sample(t, position, target);
+                aimCamera(programState->camera, position, target);
+            }
+        }
+        else if (!replaying) {
+            // FPS lock
+            currentFrame=(float)glfwGetTime();
+        }
+        deltaTime = replaying ? replayDeltaTime : currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if (inputRecorder.IsOpen())
+            inputRecorder.Frame(currentFrame, deltaTime, heldKeyMask(window));
         // update funkcija
-        processInput(window);
-        // sort transparent objects
-        std::sort(prozori.begin(), prozori.end(),[cameraPosition = programState->camera.Position]
-                (const Prozor a, const Prozor b){
-            float d1 = glm::distance(a.position, cameraPosition);
-            float d2 = glm::distance(b.position, cameraPosition);
-            return  d1 > d2;
-        });
+        if (!bench.enabled || replaying) {
+            RG_PROFILE_ZONE("Input");
+            processInput(window);
+        }
+        {
+            RG_PROFILE_ZONE("Scene transforms");
+            animateSceneTransforms(currentFrame);
+        }
+        {
+            RG_PROFILE_ZONE("Frame snapshot");
+            takeFrameSnapshot(frameSnapshots.Back(), currentFrame);
+            frameSnapshots.Publish();
+        }
 
-        // color and depth
+        if (renderThread.joinable()) {
+            RG_PROFILE_ZONE("Poll events");
+            exchangeRecordedInput(window, replaySettings);
+            glfwPollEvents();
+            continue;
+        }
 
-        glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_CULL_FACE);
-        if(faceculling)
-            glCullFace(GL_FRONT);
-        else
-            glCullFace(GL_BACK);
-
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-
-
-        glm::mat4 model = glm::mat4(1.0f);
-        shader_rb_bear->use();
-        shader_rb_bear->setFloat("transparency", 1.0f);
-        hasLights(*shader_rb_bear, true, false, true);
-        shader_rb_bear->setMat4("projection", projection);
-        shader_rb_bear->setMat4("view", view);
-
-        model = glm::translate(model, programState->bearPosition);
-        model = glm::scale(model, glm::vec3(0.03f, 0.03f, 0.03f));
-        model= glm::rotate(model, 3.6f, glm::vec3(0.0f, 1.0f, 1.0f));
-        shader_rb_bear->use();
-
-        if(rotation1)
-            model = glm::rotate(model, 0.45f* currentFrame, glm::vec3(0.0f,0.0f,1.0f));
-
-        model = glm::translate(model, programState->bearPosition);
-        shader_rb_bear->setMat4("model", model);
-
-        shader_rb_bear->setVec3("pointLights[0].position", programState->pointLight.position);
-        shader_rb_bear->setVec3("pointLights[0].ambient", programState->pointLight.ambient);
-        shader_rb_bear->setVec3("pointLights[0].diffuse", programState->pointLight.diffuse);
-        shader_rb_bear->setVec3("pointLights[0].specular", programState->pointLight.specular);
-        shader_rb_bear->setFloat("pointLights[0].constant", programState->pointLight.constant);
-        shader_rb_bear->setFloat("pointLights[0].linear", programState->pointLight.linear);
-        shader_rb_bear->setFloat("pointLights[0].quadratic",programState->pointLight.quadratic);
-
-
-        shader_rb_bear->setFloat("material.shininess", 32.0f);
-        shader_rb_bear->setVec3("viewPos", programState->camera.Position);
-
-        // spotlight config 1
-        shader_rb_bear->setVec3("spotLight[0].position", programState->spotlightPositions[0]);
-        spotLight.direction = glm::normalize(programState->bearPosition - programState->spotlightPositions[0]);
-        shader_rb_bear->setVec3("spotLight[0].direction", programState->spotLight.direction);
-
-        shader_rb_bear->setVec3("spotLight[0].ambient", programState->spotLight.ambient);
-        shader_rb_bear->setVec3("spotLight[0].diffuse", programState->spotLight.diffuse);
-        shader_rb_bear->setVec3("spotLight[0].specular", programState->spotLight.specular);
-        shader_rb_bear->setFloat("spotLight[0].constant", programState->spotLight.constant);
-        shader_rb_bear->setFloat("spotLight[0].linear", programState->spotLight.linear);
-        shader_rb_bear->setFloat("spotLight[0].quadratic",programState->spotLight.quadratic);
-        shader_rb_bear->setFloat("spotLight[0].cutOff", programState->spotLight.cutOff);
-        shader_rb_bear->setFloat("spotLight[0].outerCutOff", programState->spotLight.outerCutOff);
-
-        // spotlight config 2
-        shader_rb_bear->setVec3("spotLight[1].position", programState->spotlightPositions[1]);
-        spotLight.direction = glm::normalize(programState->bearPosition - programState->spotlightPositions[1]);
-        shader_rb_bear->setVec3("spotLight[1].direction", programState->spotLight.direction);
-
-        shader_rb_bear->setVec3("spotLight[1].ambient", programState->spotLight.ambient);
-        shader_rb_bear->setVec3("spotLight[1].diffuse", programState->spotLight.diffuse);
-        shader_rb_bear->setVec3("spotLight[1].specular", programState->spotLight.specular);
-        shader_rb_bear->setFloat("spotLight[1].constant", programState->spotLight.constant);
-        shader_rb_bear->setFloat("spotLight[1].linear", programState->spotLight.linear);
-        shader_rb_bear->setFloat("spotLight[1].quadratic",programState->spotLight.quadratic);
-        shader_rb_bear->setFloat("spotLight[1].cutOff", programState->spotLight.cutOff);
-        shader_rb_bear->setFloat("spotLight[1].outerCutOff", programState->spotLight.outerCutOff);
-
-        // spotlight config 3
-        shader_rb_bear->setVec3("spotLight[2].position", programState->spotlightPositions[2]);
-        spotLight.direction = glm::normalize(programState->bearPosition - programState->spotlightPositions[2]);
-        shader_rb_bear->setVec3("spotLight[2].direction", programState->spotLight.direction);
-
-        shader_rb_bear->setVec3("spotLight[2].ambient", programState->spotLight.ambient);
-        shader_rb_bear->setVec3("spotLight[2].diffuse", programState->spotLight.diffuse);
-        shader_rb_bear->setVec3("spotLight[2].specular", programState->spotLight.specular);
-        shader_rb_bear->setFloat("spotLight[2].constant", programState->spotLight.constant);
-        shader_rb_bear->setFloat("spotLight[2].linear", programState->spotLight.linear);
-        shader_rb_bear->setFloat("spotLight[2].quadratic",programState->spotLight.quadratic);
-        shader_rb_bear->setFloat("spotLight[2].cutOff", programState->spotLight.cutOff);
-        shader_rb_bear->setFloat("spotLight[2].outerCutOff", programState->spotLight.outerCutOff);
-
-        // spotlight config 4
-        shader_rb_bear->setVec3("spotLight[3].position", programState->spotlightPositions[3]);
-        spotLight.direction = glm::normalize(programState->bearPosition - programState->spotlightPositions[3]);
-        shader_rb_bear->setVec3("spotLight[3].direction", programState->spotLight.direction);
-
-        shader_rb_bear->setVec3("spotLight[3].ambient", programState->spotLight.ambient);
-        shader_rb_bear->setVec3("spotLight[3].diffuse", programState->spotLight.diffuse);
-        shader_rb_bear->setVec3("spotLight[3].specular", programState->spotLight.specular);
-        shader_rb_bear->setFloat("spotLight[3].constant", programState->spotLight.constant);
-        shader_rb_bear->setFloat("spotLight[3].linear", programState->spotLight.linear);
-        shader_rb_bear->setFloat("spotLight[3].quadratic",programState->spotLight.quadratic);
-        shader_rb_bear->setFloat("spotLight[3].cutOff", programState->spotLight.cutOff);
-        shader_rb_bear->setFloat("spotLight[3].outerCutOff", programState->spotLight.outerCutOff);
-
-        // directional light config
-        shader_rb_bear->setVec3("dirLight.direction", dirLight.direction);
-        shader_rb_bear->setVec3("dirLight.ambient", dirLight.ambient);
-        shader_rb_bear->setVec3("dirLight.diffuse", dirLight.diffuse);
-        shader_rb_bear->setVec3("dirLight.specular", dirLight.specular);
-
-        shader_rb_bear->setBool("hasNormalMap", false);
-        circusBear.Draw(*shader_rb_bear);
-
-        //seesaw
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, programState->seeSawPosition);
-        model = glm::scale(model, glm::vec3(0.025f, 0.025f, 0.025f));
-        model= glm::rotate(model, 3.0f, glm::vec3(0.0f, 1.0f, 1.0f));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, seeSawTextureDiffuse);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, seeSawTextureSpecular);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, seeSawTextureNormal);
-        shader_rb_bear->use();
-        shader_rb_bear->setMat4("model", model);
-        shader_rb_bear->setBool("hasNormalMap", programState->hasNormalMapping);
-        seesawModel.Draw(*shader_rb_bear);
-        shader_rb_bear->setBool("hasNormalMap", false);
-
-        // skyShader global config
-        skyShader->use();
-        skyShader->setMat4("projection", projection);
-        skyShader->setMat4("view", view);
-        skyShader->setVec3("cameraPos", programState->camera.Position);
-
-
-        //platform
-        float stara;
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, programState->platformPosition);
-        model = glm::scale(model, glm::vec3(0.12f, 0.12f, 0.12f));
-        model = glm::rotate(model, 0.25f , glm::vec3(0.0f, 1.0f, 0.0f));
-        if(rotation1)
-            model=glm::rotate(model,0.25f*currentFrame,glm::vec3(0.0f, 1.0f, 0.0f));
-
-        if(!colorSky) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, platformTextureDiffuse);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, platformTextureSpecular);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, platformTextureNormal);
+        frameSnapshots.Acquire();
+        frame = &frameSnapshots.Front();
+        renderFrame();
 
-            shader_rb_bear->use();
-            shader_rb_bear->setMat4("model", model);
-            shader_rb_bear->setBool("hasNormalMap", programState->hasNormalMapping);
-            platform.Draw(*shader_rb_bear);
-            shader_rb_bear->setBool("hasNormalMap", false);
+        if (bench.enabled) {
+            exchangeRecordedInput(window, replaySettings);
+            benchRecorder->EndFrame(rg::drawStats().drawCalls);
+            benchFrame++;
+            continue;
         }
-        else{
-            skyShader->use();
-            skyShader->setMat4("model", model);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            platform.Draw(*skyShader);
+
+        // imgui
+
+        if (programState->ImGuiEnabled) {
+            RG_PROFILE_ZONE("ImGui");
+            rg::GpuPassScope gpuPass(*gpuPasses, "ImGui");
+            DrawImGui(programState);
         }
 
-        // lamps
-        shader_rb_bear->use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureLamp);
-        for(int i = 0; i < 4; i++){
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, programState->spotlightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.07f, 0.07f, 0.07f));
-            float rotation;
-            switch(i){
-                case 0:{
-                    rotation = -0.78f;
-                    break;
-                }
-                case 1:{
-                    rotation = 2.35f;
-                    break;
-                }
-                case 2:{
-                    rotation = 0.78f;
-                    break;
-                }
-                case 3:{
-                    rotation = -2.35f;
-                    break;
-                }
-            }
-            model= glm::rotate(model, rotation, glm::vec3(0.0f, 1.0f, 0.0f));
-            shader_rb_bear->setMat4("model", model);
-            shader_rb_bear->setBool("hasNormalMap", false);
-            lamp.Draw(*shader_rb_bear);
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        {
+            RG_PROFILE_ZONE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        {
+            RG_PROFILE_ZONE("Poll events");
+            exchangeRecordedInput(window, replaySettings);
+            glfwPollEvents();
+        }
+    }
+    if (renderThread.joinable())
+        stopRenderThread();
+
+    if (bench.enabled) {
+        benchRecorder->PrintSummary();
+        benchRecorder->WriteJson(bench.output, {
+                {"renderer", programState->deferredShading ? "deferred" : "forward"},
+                {"depth_prepass", programState->depthPrepass ? "on" : "off"},
+                {"gpu_driven", programState->gpuDriven ? "on" : "off"},
+                {"meshlet_culling", programState->meshletCulling ? "on" : "off"},
+                {"occlusion_culling", programState->occlusionCulling ? "on" : "off"},
+                {"extra_lights", std::to_string(programState->extraLightCount)},
+                {"resolution", std::to_string(bench.width) + "x" + std::to_string(bench.height)},
+                {"gl_renderer", (const char *) glGetString(GL_RENDERER)},
+                {"replay", bench.replayPath},
+                {"stress_models", std::to_string(programState->stress.models)},
+                {"stress_instances", std::to_string(stressScene.InstanceCount())},
+                {"stress_windows", std::to_string(programState->stress.windows)},
+                {"stress_lights", std::to_string(programState->stress.lights)},
+                {"stress_seed", std::to_string(programState->stress.seed)},
+                {"job_threads", std::to_string(jobSystem->ThreadCount())}
+        });
+        if (!bench.statsCsv.empty()) {
+            rg::beginDrawStatsFrame();
+            rg::drawStatsLog().WriteCsv(bench.statsCsv);
         }
+        delete benchRecorder;
+    }
+    else
+        programState->SaveToFile("resources/program_state.txt");
+    inputRecorder.Close();
+    delete programState;
+    delete shader_rb_bear;
+    delete clusteredLights;
+    delete deferredRenderer;
+    delete drawDataRing;
+    delete gpuScene;
+    delete depthPyramid;
+    delete depthPrepassTime;
+    delete opaquePassTime;
+    delete opaqueSamples;
+    delete gpuPasses;
+    delete spotShadowAtlas;
+    delete jobSystem;
+    if (bench.enabled)
+        return 0;
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    glfwTerminate();
+    return 0;
+}
 
-        //flower
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, programState->flowerPosition);
-        model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f));
-        model= glm::rotate(model, 3.0f, glm::vec3(0.0f, 1.0f, 1.0f));
-        shader_rb_bear->use();
-        shader_rb_bear->setMat4("model", model);
-        shader_rb_bear->setBool("hasNormalMap", false);
-        flower.Draw(*shader_rb_bear);
+// 4x multisampled colour + depth, like the GLFW_SAMPLES 4 window
+unsigned int createBenchmarkFramebuffer(int width, int height){
+    unsigned int framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Benchmark framebuffer is not complete!" << std::endl;
+    return framebuffer;
+}
 
-        //pipe
+// loop around the arena: close to the bear, over the seesaw and the flower, and a high overview
+rg::CameraSpline benchmarkCameraPath(){
+    rg::CameraSpline path;
+    glm::vec3 bear = programState->bearPosition;
+    path.AddPoint(glm::vec3(0.0f, 3.0f, 9.0f), bear);
+    path.AddPoint(glm::vec3(2.5f, 1.8f, 2.5f), bear);
+    path.AddPoint(glm::vec3(9.0f, 3.0f, -2.0f), programState->seeSawPosition);
+    path.AddPoint(glm::vec3(3.0f, 12.0f, -12.0f), glm::vec3(0.0f));
+    path.AddPoint(glm::vec3(-9.0f, 2.0f, -4.0f), bear);
+    path.AddPoint(glm::vec3(-7.0f, 1.5f, 7.0f), programState->flowerPosition);
+    return path;
+}
 
-        model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(0.000000000000000001f, 0.00000000000001f, 0.00000000000000001f));
-        model = glm::translate(model,programState->pipePosition);
-        model= glm::rotate(model, 1.57f, glm::vec3(1.0f, 0.0f, 0.0f));
-        shader_rb_bear->use();
-        shader_rb_bear->setMat4("model", model);
-        shader_rb_bear->setBool("hasNormalMap", programState->hasNormalMapping);
-        pipe.Draw(*shader_rb_bear);
-        shader_rb_bear->setBool("hasNormalMap", false);
+void aimCamera(Camera& camera, glm::vec3 position, glm::vec3 target){
+    glm::vec3 direction = glm::normalize(target - position);
+    camera.Position = position;
+    camera.Yaw = glm::degrees(atan2f(direction.z, direction.x));
+    camera.Pitch = glm::degrees(asinf(direction.y));
+    camera.ProcessMouseMovement(0.0f, 0.0f);
+}
 
-        glDisable(GL_CULL_FACE);
+void captureReplaySettings(const ProgramState& state, ReplaySettings& settings){
+    // zeroed first so that padding bytes compare equal between snapshots
+    std::memset((void *)&settings, 0, sizeof(ReplaySettings));
+    settings.clearColor = state.clearColor;
+    settings.dirLight = state.dirLight;
+    settings.spotLight = state.spotLight;
+    settings.pointLight = state.pointLight;
+    settings.extraLightCount = state.extraLightCount;
+    settings.stress = state.stress;
+    settings.heightScale = state.heightScale;
+    settings.ImGuiEnabled = state.ImGuiEnabled;
+    settings.CameraMouseMovementUpdateEnabled = state.CameraMouseMovementUpdateEnabled;
+    settings.pointLightEnabled = state.pointLightEnabled;
+    settings.deferredShading = state.deferredShading;
+    settings.perObjectLightLists = state.perObjectLightLists;
+    settings.depthPrepass = state.depthPrepass;
+    settings.spotShadows = state.spotShadows;
+    settings.gpuDriven = state.gpuDriven;
+    settings.meshletCulling = state.meshletCulling;
+    settings.occlusionCulling = state.occlusionCulling;
+    settings.hasNormalMapping = state.hasNormalMapping;
+    settings.hasParallaxMapping = state.hasParallaxMapping;
+}
 
-        spotlightShader.use();
-        spotlightShader.setMat4("view", view);
-        spotlightShader.setMat4("projection", projection);
-        model = glm::mat4(1.0f);
-        for(int i = 0; i < 4; i++){
-            glm::vec3 boja;
-            model = glm::mat4(1.0f);
-            boja = checkSpotlights[i] ? glm::vec3(1.0f) : glm::vec3(0.0f);
-            model = glm::scale(model, glm::vec3(1.2f,1.2f,1.2f));
-            model = glm::translate(model, programState->circlePositions[i]);
-            float rotation;
-            switch(i){
-                case 0:{
-                    rotation = 2.1f;
-                    model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, 1.0f));
-                    break;
-                }
-                case 1:{
-                    rotation = -2.1f;
-                    model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, 1.0f));
-                    break;
-                }
-                case 2:{
-                    rotation = 2.1f;
-                    model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, -1.0f));
-                    break;
-                }
-                case 3:{
-                    rotation = -2.1f;
-                    model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, -1.0f));
+void applyReplaySettings(const ReplaySettings& settings, ProgramState& state){
+    state.clearColor = settings.clearColor;
+    state.dirLight = settings.dirLight;
+    state.spotLight = settings.spotLight;
+    state.pointLight = settings.pointLight;
+    state.extraLightCount = settings.extraLightCount;
+    if (std::memcmp(&state.stress, &settings.stress, sizeof(rg::StressSceneOptions)) != 0) {
+        state.stress = settings.stress;
+        generateStressScene();
+    }
+    state.heightScale = settings.heightScale;
+    state.ImGuiEnabled = settings.ImGuiEnabled;
+    state.CameraMouseMovementUpdateEnabled = settings.CameraMouseMovementUpdateEnabled;
+    state.pointLightEnabled = settings.pointLightEnabled;
+    state.deferredShading = settings.deferredShading;
+    state.perObjectLightLists = settings.perObjectLightLists;
+    state.depthPrepass = settings.depthPrepass;
+    state.spotShadows = settings.spotShadows;
+    state.gpuDriven = settings.gpuDriven;
+    state.meshletCulling = settings.meshletCulling;
+    state.occlusionCulling = settings.occlusionCulling;
+    state.hasNormalMapping = settings.hasNormalMapping;
+    state.hasParallaxMapping = settings.hasParallaxMapping;
+}
 
-                    break;
-                }
-            }
-            if(checkSpotlights[i])
-                boja=glm::vec3 (1.0f);
-            else
-                boja=glm::vec3(0.0f);
-
-            spotlightShader.use();
-            spotlightShader.setVec3("Color",boja);
-            spotlightShader.setMat4("model", model);
-            circle.Draw(spotlightShader);
-        }
+bool keyDown(GLFWwindow *window, int key){
+    if (replaying) {
+        for (uint32_t i = 0; i < sizeof(polledKeys) / sizeof(polledKeys[0]); i++)
+            if (polledKeys[i] == key)
+                return inputReplay.KeyHeld(i);
+        return false;
+    }
+    return window && glfwGetKey(window, key) == GLFW_PRESS;
+}
 
+uint32_t heldKeyMask(GLFWwindow *window){
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < sizeof(polledKeys) / sizeof(polledKeys[0]); i++)
+        if (keyDown(window, polledKeys[i]))
+            mask |= 1u << i;
+    return mask;
+}
 
-        float stranica = 2.0f;
-        if(!colorSky){
-            shader_rb_bear->use();
-            shader_rb_bear->setInt("material.texture_height1", 3);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, floorTextureDiffuse);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, floorTextureSpecular);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, floorTextureNormal);
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, floorTextureHeigth);
-
-
-            shader_rb_bear->setBool("hasNormalMap", programState->hasNormalMapping);
-            shader_rb_bear->setBool("hasParallaxMapping", programState->hasParallaxMapping);
-            shader_rb_bear->setFloat("heightScale", programState->heightScale);
-
-            glm::vec3 firstPosition = glm::vec3(-25.0f * stranica, -25.0f * stranica, 0.0f);
-            model = glm::translate(model, firstPosition);
-            for(int i = 0; i < 50; i++) {
-                for(int j = 0; j < 50; j++){
-                    model = glm::mat4(1.0f);
-                    model = glm::rotate(model, glm::radians(270.0f), glm::normalize(glm::vec3(1.0f,0.0f,0.0f)));
-                    model = glm::translate(model, firstPosition + glm::vec3((float)j * stranica,(float)i * stranica ,0.0f));
-                    shader_rb_bear->setMat4("model", model);
-                    renderQuad();
-                }
-            }
+// end of frame: records the GUI edits of this frame, or replays the edits and events recorded
+// between this frame and the next one
+void exchangeRecordedInput(GLFWwindow *window, ReplaySettings& settings){
+    if (inputRecorder.IsOpen()) {
+        captureReplaySettings(*programState, settings);
+        inputRecorder.Settings(&settings);
+    }
+    if (!replaying)
+        return;
+    dispatchingReplay = true;
+    inputReplay.DispatchEvents([&](const rg::InputEvent& event) {
+        if (event.tag == rg::INPUT_SETTINGS)
+            applyReplaySettings(settings, *programState);
+        else if (event.tag == rg::INPUT_KEY)
+            key_callback(window, event.key, event.scancode, event.action, event.mods);
+        else if (event.tag == rg::INPUT_CURSOR)
+            mouse_callback(window, event.x, event.y);
+        else if (event.tag == rg::INPUT_SCROLL)
+            scroll_callback(window, event.x, event.y);
+    });
+    dispatchingReplay = false;
+}
 
-            shader_rb_bear->setBool("hasNormalMap", false);
-            shader_rb_bear->setBool("hasParallaxMapping", false);
-        }
-        else{
-            skyShader->use();
-            model = glm::mat4(1.0f);
-            model = glm::rotate(model, glm::radians(270.0f), glm::normalize(glm::vec3(1.0f,0.0f,0.0f)));
-            model = glm::scale(model, glm::vec3(25.0f * stranica));
-            skyShader->setMat4("model", model);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            renderQuad();
-        }
+// projection, view and camera uniforms of every shader that is fed by rb_bear_shader.vs
+void setSceneUniforms(Shader& shader, const glm::mat4& projection, const glm::mat4& view){
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    shader.setFloat("material.shininess", 32.0f);
+    shader.setVec3("viewPos", frame->state.camera.Position);
+}
 
+void setDirLight(Shader& shader, const DirLight& dirLight){
+    shader.setVec3("dirLight.direction", dirLight.direction);
+    shader.setVec3("dirLight.ambient", dirLight.ambient);
+    shader.setVec3("dirLight.diffuse", dirLight.diffuse);
+    shader.setVec3("dirLight.specular", dirLight.specular);
+}
 
-        //pointlight
+// all opaque objects drawn with the material shader (forward rb_bear_shader, the G-buffer shader or the
+// depth pre-pass shader), each bound to its DrawData slice
+void drawOpaqueScene(SceneAssets& scene, Shader& shader, DrawRecording& entityDraws){
+    RG_PROFILE_ZONE("drawOpaqueScene");
+    glEnable(GL_CULL_FACE);
+    if(frame->faceculling)
+        glCullFace(GL_FRONT);
+    else
+        glCullFace(GL_BACK);
 
-        model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(10.0f));
-        model = glm::translate(model, programState->pointLight.position);
-        spotlightShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    // bear, seesaw, platform, lamps, flower and their stress copies, recorded by startDrawRecording
+    {
+        RG_PROFILE_ZONE("Replay entity draws");
+        replayDrawRecording(entityDraws);
+    }
+    // or, --gpu-driven, the instances the compute shader kept
+    if(gpuDrivenFrame){
+        RG_PROFILE_ZONE("GPU-driven draws");
+        drawGpuDrivenModels(scene, shader, entityDraws.textures);
+    }
 
+    //pipe
+    bindDrawData(drawDataSlices.pipe);
+    {
+        RG_PROFILE_ZONE("Pipe");
+        scene.pipe.Draw(shader);
+    }
 
-        // cubemap
+    // the floor is drawn without face culling
+    glDisable(GL_CULL_FACE);
+    if(!frame->colorSky){
+        RG_PROFILE_ZONE("Floor");
+        rg::GpuPassScope gpuPass(*gpuPasses, "Floor");
+        shader.setInt("material.texture_height1", 3);
 
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix()));
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-        
-
-        shader_rb_bear->use();
-        shader_rb_bear->setFloat("transparency", 0.5f);
-        hasLights(*shader_rb_bear, true, false, true);
-        glBindVertexArray(transparentVAO);
+        glBindTexture(GL_TEXTURE_2D, scene.floorTextureDiffuse);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, scene.floorTextureSpecular);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, scene.floorTextureNormal);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, scene.floorTextureHeigth);
+
+        shader.setBool("hasParallaxMapping", frame->state.hasParallaxMapping);
+        shader.setFloat("heightScale", frame->state.heightScale);
+
+        for(uint32_t i = 0; i < FLOOR_TILES; i++){
+            bindDrawData(drawDataSlices.floor + i);
+            renderQuad();
+        }
+
+        shader.setBool("hasParallaxMapping", false);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, transparentTexture);
+    }
+}
 
+// binds the textures of a mesh and names their samplers like Mesh::Draw
+void bindMeshTextures(Shader& shader, const Mesh& mesh){
+    unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+    for(unsigned int t = 0; t < mesh.textures.size(); t++){
+        const std::string& type = mesh.textures[t].type;
+        std::string number;
+        if(type == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if(type == "texture_specular")
+            number = std::to_string(specularNr++);
+        else if(type == "texture_normal")
+            number = std::to_string(normalNr++);
+        else if(type == "texture_height")
+            number = std::to_string(heightNr++);
+        shader.setInt(mesh.glslIdentifierPrefix + type + number, (int)t);
+        glActiveTexture(GL_TEXTURE0 + t);
+        glBindTexture(GL_TEXTURE_2D, mesh.textures[t].id);
+    }
+}
 
-        for(int i = 0; i < prozori.size(); ++i){
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, prozori[i].position);
-            model = glm::scale(model, glm::vec3(prozori[i].windowScaleFactor));
-            model = glm::rotate(model, glm::radians(prozori[i].rotateX),glm::vec3(1.0,0.0,0.0));
-            model = glm::rotate(model, glm::radians(prozori[i].rotateY),glm::vec3(0.0,1.0,0.0));
-            model = glm::rotate(model, glm::radians(prozori[i].rotateZ),glm::vec3(0.0,0.0,1.0));
-            shader_rb_bear->use();
-            shader_rb_bear->setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+bool sameMeshTextures(const Mesh& a, const Mesh& b){
+    if(a.textures.size() != b.textures.size())
+        return false;
+    for(size_t t = 0; t < a.textures.size(); t++)
+        if(a.textures[t].id != b.textures[t].id || a.textures[t].type != b.textures[t].type)
+            return false;
+    return true;
+}
+
+// the visible instances of every model, one multi-draw per model and run of meshes sharing their textures;
+// the textures are the mesh prototype's material, which the model entities keep
+void drawGpuDrivenModels(SceneAssets& scene, Shader& shader, bool textures){
+    for(uint32_t m = 0; m < rg::STRESS_MODEL_COUNT; m++){
+        bindDrawData(drawDataSlices.gpuModels + m);
+        const vector<Mesh>& meshes = scene.meshTable[m]->meshes;
+        if(!textures){
+            gpuScene->Draw(m, 0, (uint32_t)meshes.size());
+            continue;
+        }
+        const rg::MaterialComponent& material = meshPrototypes[m].material;
+        const unsigned int materialTextures[3] = { material.diffuse, material.specular, material.normal };
+        for(int unit = 0; unit < 3; unit++)
+            if(materialTextures[unit]){
+                glActiveTexture(GL_TEXTURE0 + unit);
+                glBindTexture(GL_TEXTURE_2D, materialTextures[unit]);
+            }
+        uint32_t first = 0;
+        for(uint32_t i = 1; i <= meshes.size(); i++){
+            if(i < meshes.size() && sameMeshTextures(meshes[i], meshes[first]))
+                continue;
+            bindMeshTextures(shader, meshes[first]);
+            gpuScene->Draw(m, first, i - first);
+            first = i;
         }
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
 
-        // imgui
+// scene graph of the hand placed objects, the bear stands on the rotating platform
+void buildSceneTransforms(){
+    rg::TransformHierarchy& t = sceneTransforms;
+    glm::vec3 uprightAxis(0.0f, 1.0f, 1.0f);
+
+    sceneNodes.turntable = t.AddNode();
+    t.SetTranslation(sceneNodes.turntable, programState->platformPosition);
+    sceneNodes.platform = t.AddNode(sceneNodes.turntable);
+    t.SetRotation(sceneNodes.platform, 0.25f, glm::vec3(0.0f, 1.0f, 0.0f));
+    t.SetScale(sceneNodes.platform, glm::vec3(0.12f));
+    sceneNodes.bear = t.AddNode(sceneNodes.turntable);
+    t.SetTranslation(sceneNodes.bear, programState->bearPosition - programState->platformPosition);
+    t.SetRotation(sceneNodes.bear, 3.6f, uprightAxis);
+    t.SetScale(sceneNodes.bear, glm::vec3(0.03f));
+    // spins about the model's own z axis, offset by bearPosition in model space
+    sceneNodes.bearSpin = t.AddNode(sceneNodes.bear);
+    t.SetTranslation(sceneNodes.bearSpin, programState->bearPosition);
+
+    sceneNodes.seesaw = t.AddNode();
+    t.SetTranslation(sceneNodes.seesaw, programState->seeSawPosition);
+    t.SetRotation(sceneNodes.seesaw, 3.0f, uprightAxis);
+    t.SetScale(sceneNodes.seesaw, glm::vec3(0.025f));
+
+    // every lamp faces the middle of the arena
+    const float lampRotations[4] = { -0.78f, 2.35f, 0.78f, -2.35f };
+    for(int i = 0; i < 4; i++){
+        sceneNodes.lamps[i] = t.AddNode();
+        t.SetTranslation(sceneNodes.lamps[i], programState->spotlightPositions[i]);
+        t.SetRotation(sceneNodes.lamps[i], lampRotations[i], glm::vec3(0.0f, 1.0f, 0.0f));
+        t.SetScale(sceneNodes.lamps[i], glm::vec3(0.07f));
+    }
 
-        if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+    sceneNodes.flower = t.AddNode();
+    t.SetTranslation(sceneNodes.flower, programState->flowerPosition);
+    t.SetRotation(sceneNodes.flower, 3.0f, uprightAxis);
+    t.SetScale(sceneNodes.flower, glm::vec3(0.05f));
+
+    // scaled before it is translated, not a TRS transform
+    glm::mat4 pipe = glm::mat4(1.0f);
+    pipe = glm::scale(pipe, glm::vec3(0.000000000000000001f, 0.00000000000001f, 0.00000000000000001f));
+    pipe = glm::translate(pipe,programState->pipePosition);
+    pipe = glm::rotate(pipe, 1.57f, glm::vec3(1.0f, 0.0f, 0.0f));
+    sceneNodes.pipe = t.AddNode();
+    t.SetLocalMatrix(sceneNodes.pipe, pipe);
+
+    // the 50x50 floor tiles as a single quad, they lie in one plane so its depth is the same
+    float stranica = 2.0f;
+    glm::mat4 floor = glm::mat4(1.0f);
+    floor = glm::rotate(floor, glm::radians(270.0f), glm::normalize(glm::vec3(1.0f,0.0f,0.0f)));
+    floor = glm::translate(floor, glm::vec3(-0.5f * stranica, -0.5f * stranica, 0.0f));
+    floor = glm::scale(floor, glm::vec3(25.0f * stranica, 25.0f * stranica, 1.0f));
+    sceneNodes.floor = t.AddNode();
+    t.SetLocalMatrix(sceneNodes.floor, floor);
+
+    t.Update();
+}
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+// the R key rotation; the setters leave the nodes clean when the angles do not change
+void animateSceneTransforms(float currentFrame){
+    rg::TransformHierarchy& t = sceneTransforms;
+    float turn = rotation1 ? 0.25f * currentFrame : 0.0f;
+    t.SetRotation(sceneNodes.turntable, turn, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    float spin = rotation1 ? 0.45f * currentFrame : 0.0f;
+    glm::vec3 offset = programState->bearPosition;
+    float c = glm::cos(spin), s = glm::sin(spin);
+    t.SetRotation(sceneNodes.bearSpin, spin, glm::vec3(0.0f, 0.0f, 1.0f));
+    t.SetTranslation(sceneNodes.bearSpin, glm::vec3(c * offset.x - s * offset.y, s * offset.x + c * offset.y, offset.z));
+    t.Update();
+}
+
+glm::mat4 bearModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.bearSpin];
+}
+
+glm::mat4 seesawModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.seesaw];
+}
+
+glm::mat4 lampModelMatrix(int i){
+    return frame->nodeWorlds[sceneNodes.lamps[i]];
+}
+
+glm::mat4 flowerModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.flower];
+}
+
+glm::mat4 pipeModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.pipe];
+}
+
+glm::mat4 floorModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.floor];
+}
+
+// model matrices of the shadow casters, only used to detect when the cached shadow maps are stale
+void collectShadowCasters(float currentFrame, vector<glm::mat4>& staticCasters, vector<glm::mat4>& dynamicCasters){
+    staticCasters.clear();
+    staticCasters.push_back(seesawModelMatrix());
+    for(int i = 0; i < 4; i++)
+        staticCasters.push_back(lampModelMatrix(i));
+    staticCasters.push_back(flowerModelMatrix());
+    staticCasters.push_back(pipeModelMatrix());
+    staticCasters.push_back(floorModelMatrix());
+
+    dynamicCasters.clear();
+    dynamicCasters.push_back(bearModelMatrix());
+    dynamicCasters.push_back(platformModelMatrix());
+}
+
+// draws the static (lamps, seesaw, flower, pipe, floor) or the dynamic (bear, platform) shadow casters
+void drawShadowCasters(SceneAssets& scene, Shader& depthShader, float currentFrame, bool dynamic){
+    if(dynamic){
+        depthShader.setMat4("model", bearModelMatrix());
+        scene.circusBear.Draw(depthShader);
+        depthShader.setMat4("model", platformModelMatrix());
+        scene.platform.Draw(depthShader);
+        return;
+    }
+    depthShader.setMat4("model", seesawModelMatrix());
+    scene.seesawModel.Draw(depthShader);
+    for(int i = 0; i < 4; i++){
+        depthShader.setMat4("model", lampModelMatrix(i));
+        scene.lamp.Draw(depthShader);
     }
+    depthShader.setMat4("model", flowerModelMatrix());
+    scene.flower.Draw(depthShader);
+    depthShader.setMat4("model", pipeModelMatrix());
+    scene.pipe.Draw(depthShader);
+    depthShader.setMat4("model", floorModelMatrix());
+    renderQuad();
+}
 
-    programState->SaveToFile("resources/program_state.txt");
-    delete programState;
-    delete shader_rb_bear;
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-    glfwTerminate();
-    return 0;
+glm::mat4 platformModelMatrix(){
+    return frame->nodeWorlds[sceneNodes.platform];
+}
+
+// platform and floor reflecting the skybox (C key)
+void drawReflectiveObjects(SceneAssets& scene, Shader& skyShader, const glm::mat4& projection, const glm::mat4& view, float currentFrame){
+    if(!frame->colorSky)
+        return;
+
+    skyShader.use();
+    skyShader.setMat4("projection", projection);
+    skyShader.setMat4("view", view);
+    skyShader.setVec3("cameraPos", frame->state.camera.Position);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, scene.cubemapTexture);
+
+    glEnable(GL_CULL_FACE);
+    if(frame->faceculling)
+        glCullFace(GL_FRONT);
+    else
+        glCullFace(GL_BACK);
+    skyShader.setMat4("model", platformModelMatrix());
+    scene.platform.Draw(skyShader);
+    glDisable(GL_CULL_FACE);
+
+    float stranica = 2.0f;
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, glm::radians(270.0f), glm::normalize(glm::vec3(1.0f,0.0f,0.0f)));
+    model = glm::scale(model, glm::vec3(25.0f * stranica));
+    skyShader.setMat4("model", model);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, scene.cubemapTexture);
+    renderQuad();
+}
+
+// discs under the lamps (white when the spotlight is on) and the point light cube
+void drawLightMarkers(SceneAssets& scene, Shader& spotlightShader, const glm::mat4& projection, const glm::mat4& view){
+    spotlightShader.use();
+    spotlightShader.setMat4("view", view);
+    spotlightShader.setMat4("projection", projection);
+    glm::mat4 model;
+    for(int i = 0; i < 4; i++){
+        glm::vec3 boja;
+        model = glm::mat4(1.0f);
+        model = glm::scale(model, glm::vec3(1.2f,1.2f,1.2f));
+        model = glm::translate(model, frame->state.circlePositions[i]);
+        float rotation;
+        switch(i){
+            case 0:{
+                rotation = 2.1f;
+                model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, 1.0f));
+                break;
+            }
+            case 1:{
+                rotation = -2.1f;
+                model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, 1.0f));
+                break;
+            }
+            case 2:{
+                rotation = 2.1f;
+                model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, -1.0f));
+                break;
+            }
+            case 3:{
+                rotation = -2.1f;
+                model= glm::rotate(model, rotation, glm::vec3(1.0f, 0.0f, -1.0f));
+
+                break;
+            }
+        }
+        if(frame->spotlights[i])
+            boja=glm::vec3 (1.0f);
+        else
+            boja=glm::vec3(0.0f);
+
+        spotlightShader.setVec3("Color",boja);
+        spotlightShader.setMat4("model", model);
+        scene.circle.Draw(spotlightShader);
+    }
+
+    //pointlight
+    model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(10.0f));
+    model = glm::translate(model, frame->state.pointLight.position);
+    spotlightShader.setVec3("Color", frame->state.pointLightEnabled ? glm::vec3(1.0f) : glm::vec3(0.0f));
+    spotlightShader.setMat4("model", model);
+    glBindVertexArray(scene.lightCubeVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+}
+
+void drawSkybox(SceneAssets& scene, Shader& skyboxShader, const glm::mat4& projection){
+    glDepthFunc(GL_LEQUAL);
+    skyboxShader.use();
+    glm::mat4 view = glm::mat4(glm::mat3(frame->view));
+    skyboxShader.setMat4("view", view);
+    skyboxShader.setMat4("projection", projection);
+    // skybox cube
+    glBindVertexArray(scene.skyboxVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, scene.cubemapTexture);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
+
+// the visible windows, already sorted back to front; shader is rb_bear_shader with the per-frame uniforms set
+void drawTransparentWindows(SceneAssets& scene, Shader& shader){
+    shader.use();
+    hasLights(shader, true, true, true);
+    glBindVertexArray(scene.transparentVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scene.transparentTexture);
+
+    for(uint32_t i = 0; i < transparentDraws.size(); i++){
+        bindDrawData(drawDataSlices.windows + i);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glBindVertexArray(0);
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_ESCAPE) && window)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_W))
         programState->camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_S))
         programState->camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_A))
         programState->camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_D))
         programState->camera.ProcessKeyboard(RIGHT, deltaTime);
 
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+    if (keyDown(window, GLFW_KEY_Q))
     {
         if (programState->heightScale > 0.0f)
             programState->heightScale -= 0.0005f;
         else
             programState->heightScale = 0.0f;
     }
-    else if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+    else if (keyDown(window, GLFW_KEY_E))
     {
         if (programState->heightScale < 1.0f)
             programState->heightScale += 0.0005f;
@@ -919,13 +1663,19 @@ void processInput(GLFWwindow *window) {
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
+// the viewport is set from the frame snapshot by the thread that renders
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
+    if (replaying && !dispatchingReplay)
+        return;
+    if (inputRecorder.IsOpen())
+        inputRecorder.Cursor(xpos, ypos);
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -945,6 +1695,10 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
+    if (replaying && !dispatchingReplay)
+        return;
+    if (inputRecorder.IsOpen())
+        inputRecorder.Scroll(xoffset, yoffset);
     programState->camera.ProcessMouseScroll(yoffset);
 }
 
@@ -977,9 +1731,102 @@ void DrawImGui(ProgramState *programState) {
         ImGui::InputDouble("spotLight.constant", &programState->spotLight.constant);
         ImGui::InputDouble("spotLight.linear", &programState->spotLight.linear);
         ImGui::InputDouble("spotLight.quadratic", &programState->spotLight.quadratic);
+
+        // clustered lights
+        ImGui::Checkbox("Deferred shading", &programState->deferredShading);
+        ImGui::Checkbox("Point light", &programState->pointLightEnabled);
+        ImGui::SliderInt("Extra point lights", &programState->extraLightCount, 0, 1024);
+        if (ImGui::TreeNode("Stress scene")) {
+            // edited here and only applied with the button, generating can take a while
+            static rg::StressSceneOptions stress = programState->stress;
+            ImGui::InputInt("Copies of every model", &stress.models);
+            ImGui::InputInt("Panes", &stress.windows);
+            ImGui::InputInt("Lights", &stress.lights);
+            ImGui::InputScalar("Seed", ImGuiDataType_U32, &stress.seed);
+            ImGui::DragFloat("Extent", &stress.extent, 0.5f, 1.0f, 200.0f);
+            stress.models = std::max(0, stress.models);
+            stress.windows = std::max(0, stress.windows);
+            stress.lights = std::max(0, stress.lights);
+            if (ImGui::Button("Generate")) {
+                programState->stress = stress;
+                generateStressScene();
+            }
+            ImGui::Text("Instances: %zu, panes: %zu, lights: %zu", stressScene.InstanceCount(),
+                        stressScene.panes.size(), stressScene.lights.size());
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Scene file")) {
+            static char path[256] = "";
+            if (path[0] == '\0')
+                std::strncpy(path, sceneFileStats.path.c_str(), sizeof(path) - 1);
+            ImGui::InputText("Path", path, sizeof(path));
+            if (ImGui::Button("Load"))
+                loadSceneFile(path);
+            ImGui::Text("%s: %u models, %u windows, %u lights, loaded in %.2f ms%s", sceneFileStats.path.c_str(),
+                        sceneFileStats.models, sceneFileStats.windows, sceneFileStats.lights,
+                        sceneFileStats.loadMilliseconds, sceneFileStats.compiled ? " (compiled)" : "");
+            ImGui::TreePop();
+        }
+        ImGui::Text("Lights: %u, cluster indices: %u, max per cluster: %u, dropped: %u",
+                    clusteredLights->lightCount, clusteredLights->indexCount,
+                    clusteredLights->maxLightsInCluster, clusteredLights->droppedLights);
+        ImGui::Checkbox("Per-object light lists", &programState->perObjectLightLists);
+        ImGui::Checkbox("Depth pre-pass", &programState->depthPrepass);
+        ImGui::Checkbox("Meshlet culling", &programState->meshletCulling);
+        ImGui::Checkbox("Occlusion culling", &programState->occlusionCulling);
+        ImGui::Checkbox("Spotlight shadows", &programState->spotShadows);
+        if (gpuScene) {
+            ImGui::Checkbox("GPU-driven models", &programState->gpuDriven);
+            ImGui::Text("GPU-driven: %zu instances, %zu meshes, multi-draws: %u, Hi-Z %dx%d",
+                        gpuScene->InstanceCount(), gpuScene->CommandCount(), gpuScene->multiDraws,
+                        depthPyramid->Size().x, depthPyramid->Size().y);
+        }
+        ImGui::Text("Shadow tiles rendered this frame: static %u, dynamic %u",
+                    spotShadowAtlas->staticTilesRendered, spotShadowAtlas->dynamicTilesRendered);
+        ImGui::Text("Depth pre-pass: %.3f ms, opaque pass: %.3f ms, shaded samples: %llu",
+                    programState->depthPrepass && !programState->deferredShading ? depthPrepassTime->Milliseconds() : 0.0,
+                    opaquePassTime->Milliseconds(), (unsigned long long)opaqueSamples->Result());
+        ImGui::Text("Job threads: %d", jobSystem->ThreadCount());
+        ImGui::Text("Entities: %zu in %zu archetypes, opaque draws: %zu, windows: %zu, culled: %u",
+                    sceneEntities.Count(), sceneEntities.ArchetypeCount(), opaqueDraws.size(),
+                    transparentDraws.size(), culledEntities.load());
+        if (programState->occlusionCulling)
+            ImGui::Text("Occlusion: %u occluders, %u triangles in %dx%d, draws hidden: %u", occlusionBuffer.occluders,
+                        occlusionBuffer.triangles, occlusionBuffer.Width(), occlusionBuffer.Height(), occludedDraws);
+        unsigned int recordedChunks = depthPrepassDraws.chunkCount + opaquePassDraws.chunkCount;
+        size_t recordedWords = 0;
+        for(uint32_t i = 0; i < depthPrepassDraws.chunkCount; i++)
+            recordedWords += depthPrepassDraws.chunks[i].commands.Size();
+        for(uint32_t i = 0; i < opaquePassDraws.chunkCount; i++)
+            recordedWords += opaquePassDraws.chunks[i].commands.Size();
+        ImGui::Text("Draw commands: %zu words in %u chunks, redundant commands skipped: %u", recordedWords,
+                    recordedChunks, commandReplay.skipped);
+        rg::MeshletSet::CullStats meshlets;
+        for(uint32_t i = 0; i < opaquePassDraws.chunkCount; i++){
+            meshlets.tested += opaquePassDraws.chunks[i].meshlets.tested;
+            meshlets.frustumCulled += opaquePassDraws.chunks[i].meshlets.frustumCulled;
+            meshlets.coneCulled += opaquePassDraws.chunks[i].meshlets.coneCulled;
+            meshlets.trianglesDrawn += opaquePassDraws.chunks[i].meshlets.trianglesDrawn;
+        }
+        ImGui::Text("Meshlets: %u tested, outside the frustum: %u, facing away: %u, triangles kept: %u",
+                    meshlets.tested, meshlets.frustumCulled, meshlets.coneCulled, meshlets.trianglesDrawn);
+        ImGui::Text("Draw data: %u slices of %ld bytes, %s, fence stalls: %u (%.2f ms)", drawDataSlices.count,
+                    (long)drawDataRing->Stride(), drawDataRing->Persistent() ? "persistently mapped" : "glBufferSubData",
+                    drawDataRing->stalls, drawDataRing->stallMilliseconds);
+        ImGui::Text("Transforms: %d nodes, composed blocks of 4: %u, world updates: %u", sceneTransforms.Size(),
+                    sceneTransforms.blocksComposed, sceneTransforms.worldsUpdated);
+        ImGui::Text("Forward draws: %u, using clusters: %u, avg lights per culled draw: %.2f",
+                    objectLightCuller.draws, objectLightCuller.clusteredDraws,
+                    objectLightCuller.draws > objectLightCuller.clusteredDraws
+                        ? (float)objectLightCuller.assignedLights / (float)(objectLightCuller.draws - objectLightCuller.clusteredDraws)
+                        : 0.0f);
         ImGui::End();
     }
 
+#ifdef RG_PROFILER
+    rg::DrawProfilerWindow();
+#endif
+
     {
         ImGui::Begin("Camera info");
         const Camera& c = programState->camera;
@@ -990,104 +1837,53 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    rg::DrawGpuProfilerWindow(*gpuPasses);
+    rg::DrawStatisticsWindow();
+    rg::DrawResourceWindow();
+    rg::DrawHitchWindow(hitchDetector);
+#ifdef RG_ALLOC_TRACKER
+    rg::DrawAllocationWindow();
+#endif
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (replaying && !dispatchingReplay)
+        return;
+    if (inputRecorder.IsOpen())
+        inputRecorder.Key(key, scancode, action, mods);
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
-        if (programState->ImGuiEnabled) {
-            programState->CameraMouseMovementUpdateEnabled = false;
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-        } else {
-            programState->CameraMouseMovementUpdateEnabled = true;
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        }
+        programState->CameraMouseMovementUpdateEnabled = !programState->ImGuiEnabled;
+        // no window when a --bench run replays a recording
+        if (window)
+            glfwSetInputMode(window, GLFW_CURSOR, programState->ImGuiEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
     }
     if(key == GLFW_KEY_1 && action == GLFW_PRESS){
-        shader_rb_bear->use();
-        if(checkSpotlights[0]) {
-            checkSpotlights[0] = !checkSpotlights[0];
-            shader_rb_bear->setInt("checkSpotlight[0]", 0);
-        }
-        else{
-            checkSpotlights[0] = !checkSpotlights[0];
-            shader_rb_bear->setInt("checkSpotlight[0]", 1);
-        }
+        checkSpotlights[0] = !checkSpotlights[0];
     }
     if(key == GLFW_KEY_2 && action == GLFW_PRESS){
-        shader_rb_bear->use();
-        if(checkSpotlights[1]) {
-            checkSpotlights[1] = !checkSpotlights[1];
-            shader_rb_bear->setInt("checkSpotlight[1]", 0);
-        }
-        else{
-            checkSpotlights[1] = !checkSpotlights[1];
-            shader_rb_bear->setInt("checkSpotlight[1]", 1);
-        }
+        checkSpotlights[1] = !checkSpotlights[1];
     }
     if(key == GLFW_KEY_3 && action == GLFW_PRESS){
-        shader_rb_bear->use();
-        if(checkSpotlights[2]) {
-            checkSpotlights[2] = !checkSpotlights[2];
-            shader_rb_bear->setInt("checkSpotlight[2]", 0);
-        }
-        else{
-            checkSpotlights[2] = !checkSpotlights[2];
-            shader_rb_bear->setInt("checkSpotlight[2]", 1);
-        }
+        checkSpotlights[2] = !checkSpotlights[2];
     }
     if(key == GLFW_KEY_4 && action == GLFW_PRESS){
-        shader_rb_bear->use();
-        if(checkSpotlights[3]) {
-            checkSpotlights[3] = !checkSpotlights[3];
-            shader_rb_bear->setInt("checkSpotlight[3]", 0);
-        }
-        else{
-            checkSpotlights[3] = !checkSpotlights[3];
-            shader_rb_bear->setInt("checkSpotlight[3]", 1);
-        }
+        checkSpotlights[3] = !checkSpotlights[3];
     }
     if(key == GLFW_KEY_M && action == GLFW_PRESS){
-        if (antialiasing) {
-            glDisable(GL_MULTISAMPLE);
-            antialiasing=!antialiasing;
-        }
-        else {
-            glEnable(GL_MULTISAMPLE);
-            antialiasing = !antialiasing;
-        }
-
+        antialiasing = !antialiasing;
     }
 
     if(key == GLFW_KEY_G && action == GLFW_PRESS){
-        shader_rb_bear->use();
-        if(allLightsActivated){
-            allLightsActivated = !allLightsActivated;
-            for(int i = 0; i < 4; i++) {
-                checkSpotlights[i] = false;
-                std::string ime = "checkSpotlight[";
-                ime.append(to_string(i));
-                ime.append("]");
-                shader_rb_bear->setInt(ime,0);
-            }
-        }
-        else{
-            allLightsActivated = !allLightsActivated;
-            for(int i = 0; i < 4; i++){
-                checkSpotlights[i]=true;
-                std::string ime = "checkSpotlight[";
-                ime.append(to_string(i));
-                ime.append("]");
-                shader_rb_bear->setInt(ime,1);
-            }
-        }
+        allLightsActivated = !allLightsActivated;
+        for(int i = 0; i < 4; i++)
+            checkSpotlights[i] = allLightsActivated;
     }
     if(key == GLFW_KEY_B && action == GLFW_PRESS){
-        shader_rb_bear->use();
         blinn = !blinn;
-        shader_rb_bear->setBool("blinn", blinn);
     }
     if(key == GLFW_KEY_F && action == GLFW_PRESS){
         if(faceculling)
@@ -1110,10 +1906,15 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_P && action == GLFW_PRESS){
         programState->hasParallaxMapping = !programState->hasParallaxMapping;
     }
+    if(key == GLFW_KEY_L && action == GLFW_PRESS){
+        programState->deferredShading = !programState->deferredShading;
+    }
 }
 
 unsigned int loadTexture(char const *path)
 {
+    RG_PROFILE_ZONE("loadTexture");
+    rg::ResourceOwnerScope owner(path);
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
@@ -1150,6 +1951,8 @@ unsigned int loadTexture(char const *path)
 
 unsigned int loadCubemap(vector<std::string> &faces)
 {
+    RG_PROFILE_ZONE("loadCubemap");
+    rg::ResourceOwnerScope owner(faces.empty() ? std::string("cubemap") : faces[0]);
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -1202,46 +2005,940 @@ void hasLights(Shader& shader, bool directional, bool pointLight, bool spotlight
     }
 }
 
-void initializeTransparentWindows(vector<Prozor> &prozori){
-    Prozor p1;
-    p1.position = glm::vec3(-5.5f,1.723f,5.69f);
-    p1.windowScaleFactor = 1.2f;
-    p1.rotateX = 0.0f;
-    p1.rotateY = -20.0f;
-    p1.rotateZ = 0.0f;
-    prozori.push_back(p1);
-
-    Prozor p2;
-    p2.position = glm::vec3(-5.950f,1.723f,7.050f);
-    p2.windowScaleFactor = 1.2f;
-    p2.rotateX = 0.0f;
-    p2.rotateY = -20.0f;
-    p2.rotateZ = 0.0f;
-    prozori.push_back(p2);
-
-    Prozor p3;
-    p3.position = glm::vec3(-6.03f,1.723f,6.900f);
-    p3.windowScaleFactor = 1.2f;
-    p3.rotateX = 0.0f;
-    p3.rotateY = 68.5f;
-    p3.rotateZ = 0.0f;
-    prozori.push_back(p3);
-
-    Prozor p4;
-    p4.position = glm::vec3(-4.69f,1.723f,7.350f);
-    p4.windowScaleFactor = 1.2f;
-    p4.rotateX = 0.0f;
-    p4.rotateY = 68.5f;
-    p4.rotateZ = 0.0f;
-    prozori.push_back(p4);
-
-    Prozor p5;
-    p5.position = glm::vec3(-5.8f,2.352f,6.365f);
-    p5.windowScaleFactor = 1.4f;
-    p5.rotateX = 90.0f;
-    p5.rotateY = 0.0f;
-    p5.rotateZ = 20.0f;
-    prozori.push_back(p5);
+SceneAssets::SceneAssets()
+        : circusBear("resources/objects/circus_bear/14089_Circus_Bear_Standing_on_large_ball_v1_l2.obj")
+        , pipe("resources/objects/tube/tube.obj")
+        , platform("resources/objects/platform/Rotating_Light_Platform_Final.fbx")
+        , seesawModel("resources/objects/seesaw/10547_Childrens_Seesaw_v2-L3.obj")
+        , flower("resources/objects/flower/12974_crocus_flower_v1_l3.obj")
+        , lamp("resources/objects/lamp/Euro Spot LED czarny 1f.obj")
+        , circle("resources/objects/circle-obj/circle.obj") {
+    // quad/cube/skybox VAOs, the textures name themselves in loadTexture
+    rg::ResourceOwnerScope owner("scene geometry");
+    //model bear
+    circusBear.SetShaderTextureNamePrefix("material.");
+    bearTextureDiffuse = loadTexture("resources/objects/circus_bear/14089_Circus_bear_standing_on_large_ball_diffuse.jpg");
+    bearTextureSpecular = loadTexture("resources/objects/circus_bear/ball_diffuse.jpg");
+    bearTextureNormal = loadTexture("resources/objects/circus_bear/cap_diffuse2.jpg");
+
+    //model pipe
+    pipe.SetShaderTextureNamePrefix("material.");
+
+    //model platform
+    platform.SetShaderTextureNamePrefix("material.");
+    platformTextureDiffuse = loadTexture("resources/objects/platform/lambert1_metallic.jpg");
+    platformTextureSpecular = loadTexture("resources/objects/platform/lambert1_roughness.jpg");
+    platformTextureNormal = loadTexture("resources/objects/platform/lambert1_normal.png");
+
+    //model seesaw
+    seesawModel.SetShaderTextureNamePrefix("material.");
+    seeSawTextureDiffuse = loadTexture("resources/objects/seesaw/seesaw.jpg");
+    seeSawTextureSpecular = loadTexture("resources/objects/seesaw/seesaw.jpg");
+    seeSawTextureNormal = loadTexture("resources/objects/seesaw/seesaw.jpg");
+
+    //model flower
+    flower.SetShaderTextureNamePrefix("material.");
+
+    //model lamp
+    lamp.SetShaderTextureNamePrefix("material.");
+    textureLamp = loadTexture("resources/objects/lamp/metal.jpg");
+
+    bearBounds = modelBounds(circusBear);
+    pipeBounds = modelBounds(pipe);
+    platformBounds = modelBounds(platform);
+    seesawBounds = modelBounds(seesawModel);
+    flowerBounds = modelBounds(flower);
+    lampBounds = modelBounds(lamp);
+    meshTable[rg::STRESS_BEAR] = &circusBear;
+    meshTable[rg::STRESS_FLOWER] = &flower;
+    meshTable[rg::STRESS_LAMP] = &lamp;
+    meshTable[rg::STRESS_SEESAW] = &seesawModel;
+    meshTable[rg::STRESS_PLATFORM] = &platform;
+    // renderQuad spans [-1, 1] in xy, the window quad [0, 1] x [-0.5, 0.5]
+    quadBounds.radius = glm::sqrt(2.0f);
+    windowBounds.center = glm::vec3(0.5f, 0.0f, 0.0f);
+    windowBounds.radius = glm::sqrt(0.5f);
+
+    floorTextureDiffuse = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture.jpg");
+    floorTextureSpecular = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_SPECULAR.jpg");
+    floorTextureNormal = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_NORMAL.jpg");
+    floorTextureHeigth = loadTexture("resources/textures/beach_texture/Seamless_beach_sand_footsteps_texture_DISP.jpg");
+
+    //model circle
+    circle.SetShaderTextureNamePrefix("material.");
+
+    // cube data
+    float cubeVertices[] = {
+            // positions          // normals           // texture coords
+            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
+            0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
+            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
+            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
+            -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
+            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
+
+            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
+            0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
+            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
+            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
+            -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
+            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
+
+            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+            -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
+            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+            -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
+            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+
+            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+            0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
+            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+            0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
+            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+
+            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
+            0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
+            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
+            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
+            -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
+            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
+
+            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
+            0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
+            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+            -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
+            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
+    };
+
+    // lightCubeVAO with cube data
+    unsigned int VBO;
+    glGenVertexArrays(1, &lightCubeVAO);
+    glGenBuffers(1, &VBO);
+
+    glBindVertexArray(lightCubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // windows transparent data
+    float transparentVertices[] = {
+            // positions         // texture Coords (swapped y coordinates because texture is flipped upside down)
+            0.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  1.0f,
+            1.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  1.0f,
+
+            0.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  0.0f,
+            1.0f, -0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  1.0f,
+            1.0f,  0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  0.0f
+    };
+
+    // transparent VAO with transparent data
+    unsigned int transparentVBO;
+    glGenVertexArrays(1, &transparentVAO);
+    glGenBuffers(1, &transparentVBO);
+    glBindVertexArray(transparentVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    transparentTexture = loadTexture("resources/textures/window.png");
+
+    // skybox data
+    float skyboxVertices[] = {
+            // positions
+            -1.0f,  1.0f, -1.0f,
+            -1.0f, -1.0f, -1.0f,
+            1.0f, -1.0f, -1.0f,
+            1.0f, -1.0f, -1.0f,
+            1.0f,  1.0f, -1.0f,
+            -1.0f,  1.0f, -1.0f,
+
+            -1.0f, -1.0f,  1.0f,
+            -1.0f, -1.0f, -1.0f,
+            -1.0f,  1.0f, -1.0f,
+            -1.0f,  1.0f, -1.0f,
+            -1.0f,  1.0f,  1.0f,
+            -1.0f, -1.0f,  1.0f,
+
+            1.0f, -1.0f, -1.0f,
+            1.0f, -1.0f,  1.0f,
+            1.0f,  1.0f,  1.0f,
+            1.0f,  1.0f,  1.0f,
+            1.0f,  1.0f, -1.0f,
+            1.0f, -1.0f, -1.0f,
+
+            -1.0f, -1.0f,  1.0f,
+            -1.0f,  1.0f,  1.0f,
+            1.0f,  1.0f,  1.0f,
+            1.0f,  1.0f,  1.0f,
+            1.0f, -1.0f,  1.0f,
+            -1.0f, -1.0f,  1.0f,
+
+            -1.0f,  1.0f, -1.0f,
+            1.0f,  1.0f, -1.0f,
+            1.0f,  1.0f,  1.0f,
+            1.0f,  1.0f,  1.0f,
+            -1.0f,  1.0f,  1.0f,
+            -1.0f,  1.0f, -1.0f,
+
+            -1.0f, -1.0f, -1.0f,
+            -1.0f, -1.0f,  1.0f,
+            1.0f, -1.0f, -1.0f,
+            1.0f, -1.0f, -1.0f,
+            -1.0f, -1.0f,  1.0f,
+            1.0f, -1.0f,  1.0f
+    };
+
+    // skyboxVAO with skybox data and texture loading from resources/textures/skybox/
+    unsigned int skyboxVBO;
+    glGenVertexArrays(1, &skyboxVAO);
+    glGenBuffers(1, &skyboxVBO);
+    glBindVertexArray(skyboxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+    vector<std::string> faces
+            {
+                    FileSystem::getPath("resources/textures/skybox/right.png"),
+                    FileSystem::getPath("resources/textures/skybox/left.png"),
+                    FileSystem::getPath("resources/textures/skybox/top.png"),
+                    FileSystem::getPath("resources/textures/skybox/bottom.png"),
+                    FileSystem::getPath("resources/textures/skybox/front.png"),
+                    FileSystem::getPath("resources/textures/skybox/back.png")
+            };
+
+    cubemapTexture = loadCubemap(faces);
+}
+
+// sphere around the bounding box of all mesh vertices
+rg::BoundingSphere modelBounds(const Model& model){
+    glm::vec3 minCorner(std::numeric_limits<float>::max());
+    glm::vec3 maxCorner(-std::numeric_limits<float>::max());
+    for(const Mesh& mesh : model.meshes){
+        for(const Vertex& vertex : mesh.vertices){
+            minCorner = glm::min(minCorner, vertex.Position);
+            maxCorner = glm::max(maxCorner, vertex.Position);
+        }
+    }
+    rg::BoundingSphere bounds;
+    if(minCorner.x > maxCorner.x)
+        return bounds;
+    bounds.center = (minCorner + maxCorner) * 0.5f;
+    for(const Mesh& mesh : model.meshes)
+        for(const Vertex& vertex : mesh.vertices)
+            bounds.radius = glm::max(bounds.radius, glm::length(vertex.Position - bounds.center));
+    return bounds;
+}
+
+// the hand placed models, they follow their sceneTransforms node
+void createSceneEntities(SceneAssets& scene){
+    const rg::BoundingSphere bounds[rg::STRESS_MODEL_COUNT] = {
+            scene.bearBounds, scene.flowerBounds, scene.lampBounds, scene.seesawBounds, scene.platformBounds
+    };
+    for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++)
+        meshPrototypes[m].bounds = bounds[m];
+    // 0 where the model brings its own textures
+    meshPrototypes[rg::STRESS_LAMP].material.diffuse = scene.textureLamp;
+    rg::MaterialComponent& seesaw = meshPrototypes[rg::STRESS_SEESAW].material;
+    seesaw.diffuse = scene.seeSawTextureDiffuse;
+    seesaw.specular = scene.seeSawTextureSpecular;
+    seesaw.normal = scene.seeSawTextureNormal;
+    seesaw.normalMapped = true;
+    rg::MaterialComponent& platform = meshPrototypes[rg::STRESS_PLATFORM].material;
+    platform.diffuse = scene.platformTextureDiffuse;
+    platform.specular = scene.platformTextureSpecular;
+    platform.normal = scene.platformTextureNormal;
+    platform.normalMapped = true;
+    windowPrototypeBounds = scene.windowBounds;
+    for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++)
+        occluderMeshes[m] = rg::buildOccluderMesh(scene.meshTable[m]->meshes, OCCLUDER_TRIANGLES);
+    // the quad renderQuad draws with floorModelMatrix
+    floorOccluder.positions = {
+            glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f),
+            glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f)
+    };
+    const float uprightAngles[rg::STRESS_MODEL_COUNT] = { 3.6f, 3.0f, 0.0f, 3.0f, 0.0f };
+    for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++)
+        meshPrototypes[m].upright = glm::rotate(glm::mat4(1.0f), uprightAngles[m], glm::vec3(0.0f, 1.0f, 1.0f));
+
+    createModelEntity(rg::STRESS_BEAR, sceneTransforms.World(sceneNodes.bearSpin), sceneNodes.bearSpin);
+    createModelEntity(rg::STRESS_SEESAW, sceneTransforms.World(sceneNodes.seesaw), sceneNodes.seesaw);
+    // only the original platform turns into a mirror with the reflective skybox, the stress copies stay textured
+    rg::Entity turntable = createModelEntity(rg::STRESS_PLATFORM, sceneTransforms.World(sceneNodes.platform), sceneNodes.platform);
+    sceneEntities.Get<rg::MaterialComponent>(turntable).replacedByReflection = true;
+    for(int i = 0; i < 4; i++)
+        createModelEntity(rg::STRESS_LAMP, sceneTransforms.World(sceneNodes.lamps[i]), sceneNodes.lamps[i]);
+    createModelEntity(rg::STRESS_FLOWER, sceneTransforms.World(sceneNodes.flower), sceneNodes.flower);
+}
+
+// node is the sceneTransforms node the matrix follows, -1 for a static entity
+rg::Entity createModelEntity(rg::StressModel mesh, const glm::mat4& model, int node){
+    rg::Entity entity = sceneEntities.Create(MODEL_ENTITY);
+    rg::TransformComponent& transform = sceneEntities.Get<rg::TransformComponent>(entity);
+    transform.model = model;
+    transform.node = node;
+    sceneEntities.Get<rg::MeshComponent>(entity).mesh = mesh;
+    sceneEntities.Get<rg::MaterialComponent>(entity) = meshPrototypes[mesh].material;
+    rg::BoundsComponent& bounds = sceneEntities.Get<rg::BoundsComponent>(entity);
+    bounds.local = meshPrototypes[mesh].bounds;
+    bounds.world = rg::transformSphere(model, bounds.local);
+    return entity;
+}
+
+rg::Entity createWindowEntity(const glm::mat4& model){
+    rg::Entity entity = sceneEntities.Create(WINDOW_ENTITY);
+    sceneEntities.Get<rg::TransformComponent>(entity).model = model;
+    rg::BoundsComponent& bounds = sceneEntities.Get<rg::BoundsComponent>(entity);
+    bounds.local = windowPrototypeBounds;
+    bounds.world = rg::transformSphere(model, bounds.local);
+    return entity;
+}
+
+// Replaces the entities of the previously loaded scene file with the ones of `path` (a .scene source
+// or a compiled .rgscene). The records are copied straight out of the mapping, only the mesh names
+// are looked up, once per name. Keeps the old scene when the file can not be loaded.
+bool loadSceneFile(const std::string& path){
+    RG_PROFILE_ZONE("Load scene file");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    rg::MappedScene file;
+    if(!file.Open(path))
+        return false;
+    for(rg::Entity entity : sceneFileEntities)
+        sceneEntities.Destroy(entity);
+    sceneFileEntities.clear();
+
+    static const char *const meshNames[rg::STRESS_MODEL_COUNT] = { "bear", "flower", "lamp", "seesaw", "platform" };
+    const rg::SceneFileHeader& header = file.Header();
+    vector<int> meshes(header.meshNameCount, -1);
+    for(uint32_t i = 0; i < header.meshNameCount; i++){
+        for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++)
+            if(std::strcmp(file.MeshName(i), meshNames[m]) == 0)
+                meshes[i] = m;
+        if(meshes[i] < 0)
+            std::cout << "WARNING::SCENE_FILE:: " << path << ": unknown model " << file.MeshName(i) << ", its instances are skipped" << std::endl;
+    }
+
+    sceneFileEntities.reserve(header.modelCount + header.windowCount + header.lightCount);
+    const rg::SceneModel *models = file.Models();
+    for(uint32_t i = 0; i < header.modelCount; i++){
+        int mesh = meshes[models[i].meshName];
+        if(mesh >= 0)
+            sceneFileEntities.push_back(createModelEntity((rg::StressModel)mesh, models[i].model * meshPrototypes[mesh].upright, -1));
+    }
+    const glm::mat4 *windows = file.Windows();
+    for(uint32_t i = 0; i < header.windowCount; i++)
+        sceneFileEntities.push_back(createWindowEntity(windows[i]));
+    const rg::LightData *lights = file.Lights();
+    for(uint32_t i = 0; i < header.lightCount; i++){
+        rg::Entity entity = sceneEntities.Create(rg::COMPONENT_LIGHT);
+        sceneEntities.Get<rg::LightComponent>(entity).light = lights[i];
+        sceneFileEntities.push_back(entity);
+    }
+
+    sceneFileStats.path = path;
+    sceneFileStats.loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    sceneFileStats.compiled = file.WasCompiled();
+    sceneFileStats.models = header.modelCount;
+    sceneFileStats.windows = header.windowCount;
+    sceneFileStats.lights = header.lightCount;
+    return true;
+}
+
+// regenerates stressScene from programState->stress and replaces the previous stress entities
+void generateStressScene(){
+    stressScene.Generate(programState->stress);
+    for(rg::Entity entity : stressEntities)
+        sceneEntities.Destroy(entity);
+    stressEntities.clear();
+
+    // each model keeps the height, scale and upright rotation of its hand placed original
+    const float heights[rg::STRESS_MODEL_COUNT] = {
+            programState->bearPosition.y, programState->flowerPosition.y, programState->spotlightPositions[0].y,
+            programState->seeSawPosition.y, programState->platformPosition.y
+    };
+    const float scales[rg::STRESS_MODEL_COUNT] = { 0.03f, 0.05f, 0.07f, 0.025f, 0.12f };
+    for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++){
+        for(const rg::StressInstance& instance : stressScene.instances[m]){
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), instance.position + glm::vec3(0.0f, heights[m], 0.0f));
+            model = glm::rotate(model, instance.yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::scale(model, glm::vec3(scales[m] * instance.scale));
+            stressEntities.push_back(createModelEntity((rg::StressModel)m, model * meshPrototypes[m].upright, -1));
+        }
+    }
+
+    for(const rg::StressPane& pane : stressScene.panes)
+        stressEntities.push_back(createWindowEntity(rg::windowModelMatrix(pane.position, pane.scale, pane.rotateX, pane.rotateY, pane.rotateZ)));
+
+    for(const rg::StressLight& stress : stressScene.lights){
+        rg::Entity entity = sceneEntities.Create(rg::COMPONENT_LIGHT);
+        rg::LightData& light = sceneEntities.Get<rg::LightComponent>(entity).light;
+        if(stress.spot){
+            SpotLight spot;
+            spot.ambient = glm::vec3(0.0f);
+            spot.diffuse = stress.color;
+            spot.specular = stress.color;
+            spot.constant = 1.0f;
+            spot.linear = 0.14f;
+            spot.quadratic = 0.07f;
+            spot.cutOff = glm::cos(glm::radians(20.0f));
+            spot.outerCutOff = glm::cos(glm::radians(30.0f));
+            light = makeLightData(spot, stress.position, stress.direction);
+        }
+        else{
+            PointLight point;
+            point.position = stress.position;
+            point.ambient = glm::vec3(0.0f);
+            point.diffuse = stress.color * 0.8f;
+            point.specular = stress.color;
+            point.constant = 1.0f;
+            point.linear = 0.35f;
+            point.quadratic = 0.44f;
+            light = makeLightData(point);
+        }
+        stressEntities.push_back(entity);
+    }
+}
+
+// copies the animated sceneTransforms matrices of rows [begin, end) into the entities that follow a node
+void syncTransformRows(void *data, uint32_t begin, uint32_t end){
+    rg::Archetype& archetype = *(rg::Archetype *)data;
+    for(uint32_t i = begin; i < end; i++){
+        rg::TransformComponent& transform = archetype.transforms[i];
+        if(transform.node < 0)
+            continue;
+        transform.model = frame->nodeWorlds[transform.node];
+        archetype.bounds[i].world = rg::transformSphere(transform.model, archetype.bounds[i].local);
+    }
+}
+
+void startEntityTransforms(){
+    sceneEntities.ForEach(rg::COMPONENT_TRANSFORM | rg::COMPONENT_BOUNDS, [](rg::Archetype& archetype){
+        jobSystem->ParallelFor((uint32_t)archetype.Size(), TRANSFORM_JOB_ROWS, syncTransformRows, &archetype, transformJobs);
+    });
+}
+
+void cullModelRows(void *data, uint32_t begin, uint32_t end){
+    const CullBatch& batch = *(const CullBatch *)data;
+    rg::Archetype& archetype = *batch.archetype;
+    vector<OpaqueDraw>& draws = cullChunks[batch.firstChunk + begin / CULL_JOB_ROWS].opaque;
+    unsigned int culled = 0;
+    for(uint32_t i = begin; i < end; i++){
+        const rg::MaterialComponent& material = archetype.materials[i];
+        if(frame->colorSky && material.replacedByReflection)
+            continue;
+        if(!rg::sphereInFrustum(cullFrustum, archetype.bounds[i].world)){
+            culled++;
+            continue;
+        }
+        uint32_t mesh = archetype.meshes[i].mesh;
+        // texture names past 16 bits only split batches, the submission compares the whole material
+        uint64_t sortKey = (uint64_t)mesh << 56 | (uint64_t)(material.diffuse & 0xffff) << 40
+                         | (uint64_t)(material.specular & 0xffff) << 24 | (uint64_t)(material.normal & 0xffff) << 8
+                         | (uint64_t)material.normalMapped;
+        OpaqueDraw draw = { sortKey, mesh, &material, &archetype.transforms[i].model, &archetype.bounds[i].world };
+        draws.push_back(draw);
+    }
+    culledEntities += culled;
+}
+
+void cullWindowRows(void *data, uint32_t begin, uint32_t end){
+    const CullBatch& batch = *(const CullBatch *)data;
+    rg::Archetype& archetype = *batch.archetype;
+    vector<TransparentDraw>& draws = cullChunks[batch.firstChunk + begin / CULL_JOB_ROWS].transparent;
+    unsigned int culled = 0;
+    for(uint32_t i = begin; i < end; i++){
+        const glm::mat4& model = archetype.transforms[i].model;
+        rg::TransparencyComponent& transparency = archetype.transparencies[i];
+        transparency.viewDistance = glm::distance(glm::vec3(model[3]), cullCameraPosition);
+        if(!rg::sphereInFrustum(cullFrustum, archetype.bounds[i].world)){
+            culled++;
+            continue;
+        }
+        TransparentDraw draw = { transparency.viewDistance, &model, &archetype.bounds[i].world };
+        draws.push_back(draw);
+    }
+    culledEntities += culled;
+}
+
+// queues the frustum culling of the model and window entities after the transform jobs
+void startEntityCulling(const glm::mat4& projection, const glm::mat4& view, glm::vec3 cameraPosition){
+    cullFrustum = rg::makeFrustum(projection * view);
+    cullCameraPosition = cameraPosition;
+    culledEntities = 0;
+
+    // the batches and chunks are laid out before any job starts, the jobs only write into their own chunk
+    cullBatches.clear();
+    uint32_t chunkCount = 0;
+    auto addBatches = [&chunkCount](rg::Archetype& archetype){
+        cullBatches.push_back({ &archetype, chunkCount });
+        chunkCount += ((uint32_t)archetype.Size() + CULL_JOB_ROWS - 1) / CULL_JOB_ROWS;
+    };
+    // the GPU culls the model entities itself
+    if(!gpuDrivenFrame)
+        sceneEntities.ForEach(MODEL_ENTITY, addBatches);
+    size_t modelBatches = cullBatches.size();
+    sceneEntities.ForEach(WINDOW_ENTITY, addBatches);
+    if(cullChunks.size() < chunkCount)
+        cullChunks.resize(chunkCount);
+    cullChunkCount = chunkCount;
+    for(uint32_t i = 0; i < chunkCount; i++){
+        cullChunks[i].opaque.clear();
+        cullChunks[i].transparent.clear();
+    }
+
+    for(size_t i = 0; i < cullBatches.size(); i++)
+        jobSystem->ParallelFor((uint32_t)cullBatches[i].archetype->Size(), CULL_JOB_ROWS,
+                               i < modelBatches ? cullModelRows : cullWindowRows, &cullBatches[i], cullJobs, &transformJobs);
+}
+
+// waits for the culling jobs, joins their chunks and sorts the draw lists
+void finishEntityCulling(){
+    jobSystem->Wait(cullJobs);
+    opaqueDraws.clear();
+    transparentDraws.clear();
+    for(uint32_t i = 0; i < cullChunkCount; i++){
+        const CullChunk& chunk = cullChunks[i];
+        opaqueDraws.insert(opaqueDraws.end(), chunk.opaque.begin(), chunk.opaque.end());
+        transparentDraws.insert(transparentDraws.end(), chunk.transparent.begin(), chunk.transparent.end());
+    }
+    std::sort(opaqueDraws.begin(), opaqueDraws.end(), [](const OpaqueDraw& a, const OpaqueDraw& b){
+        return a.sortKey < b.sortKey;
+    });
+    std::sort(transparentDraws.begin(), transparentDraws.end(), [](const TransparentDraw& a, const TransparentDraw& b){
+        return a.viewDistance > b.viewDistance;
+    });
+}
+
+void testOcclusionRows(void *data, uint32_t begin, uint32_t end){
+    for(uint32_t i = begin; i < end; i++){
+        const rg::BoundingSphere& bounds = i < opaqueDraws.size() ? *opaqueDraws[i].bounds
+                                                                  : *transparentDraws[i - opaqueDraws.size()].bounds;
+        occlusionVisible[i] = occlusionBuffer.Visible(bounds);
+    }
+}
+
+// drops the draws hidden behind the occluders, after finishEntityCulling; keeps the order of both lists
+void occlusionCullDraws(const glm::mat4& projection, const glm::mat4& view){
+    occlusionBuffer.Begin(projection * view, frame->framebufferWidth, frame->framebufferHeight);
+    if(!frame->colorSky)
+        occlusionBuffer.AddOccluder(floorOccluder, floorModelMatrix());
+    // the windows are see-through, the largest models by apparent size occlude
+    occluderCandidates.clear();
+    for(uint32_t i = 0; i < opaqueDraws.size(); i++){
+        const rg::BoundingSphere& bounds = *opaqueDraws[i].bounds;
+        float distance = glm::max(glm::distance(bounds.center, cullCameraPosition), 0.1f);
+        occluderCandidates.push_back({ bounds.radius / distance, i });
+    }
+    size_t occluderCount = std::min(MAX_OCCLUDERS, occluderCandidates.size());
+    std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluderCount, occluderCandidates.end(),
+                      [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b){
+                          return a.first > b.first;
+                      });
+    for(size_t i = 0; i < occluderCount; i++){
+        const OpaqueDraw& draw = opaqueDraws[occluderCandidates[i].second];
+        occlusionBuffer.AddOccluder(occluderMeshes[draw.mesh], *draw.model);
+    }
+    occlusionBuffer.Rasterize(*jobSystem);
+
+    uint32_t drawCount = (uint32_t)(opaqueDraws.size() + transparentDraws.size());
+    occlusionVisible.resize(drawCount);
+    rg::JobCounter testJobs;
+    jobSystem->ParallelFor(drawCount, OCCLUSION_JOB_DRAWS, testOcclusionRows, nullptr, testJobs);
+    jobSystem->Wait(testJobs);
+    size_t opaqueCount = opaqueDraws.size(), kept = 0;
+    for(size_t i = 0; i < opaqueCount; i++)
+        if(occlusionVisible[i])
+            opaqueDraws[kept++] = opaqueDraws[i];
+    opaqueDraws.resize(kept);
+    kept = 0;
+    for(size_t i = 0; i < transparentDraws.size(); i++)
+        if(occlusionVisible[opaqueCount + i])
+            transparentDraws[kept++] = transparentDraws[i];
+    occludedDraws = drawCount - (uint32_t)(opaqueDraws.size() + kept);
+    transparentDraws.resize(kept);
+}
+
+// shares the geometry of the mesh table for --gpu-driven; leaves gpuScene null without GL 4.3
+void createGpuDrivenScene(SceneAssets& scene, GLADloadproc load){
+    rg::ResourceOwnerScope owner("GPU-driven scene");
+    gpuScene = new rg::GpuDrivenScene;
+    if(!gpuScene->Create(load)){
+        delete gpuScene;
+        gpuScene = nullptr;
+        return;
+    }
+    // the groups are numbered like the mesh table
+    for(int m = 0; m < rg::STRESS_MODEL_COUNT; m++)
+        gpuScene->AddModel(scene.meshTable[m]->meshes);
+    gpuScene->BuildGeometry();
+    depthPyramid = new rg::DepthPyramid;
+}
+
+// brings gpuScene's instances up to date with the model entities, after finishEntityCulling
+void updateGpuInstances(){
+    // the culling jobs did not wait for the transforms if there were no windows to cull
+    jobSystem->Wait(transformJobs);
+    if(gpuInstancesVersion != sceneEntities.Version()){
+        gpuInstancesVersion = sceneEntities.Version();
+        gpuDynamicInstances.clear();
+        vector<rg::GpuDrivenScene::Instance> instances;
+        // the ones following a node first, so the per frame upload is one range
+        for(int dynamic = 1; dynamic >= 0; dynamic--)
+            sceneEntities.ForEach(MODEL_ENTITY, [&instances, dynamic](rg::Archetype& archetype){
+                for(size_t i = 0; i < archetype.Size(); i++){
+                    if((archetype.transforms[i].node >= 0) != (dynamic == 1))
+                        continue;
+                    const rg::BoundingSphere& bounds = archetype.bounds[i].world;
+                    rg::GpuDrivenScene::Instance instance;
+                    instance.model = archetype.transforms[i].model;
+                    instance.sphere = glm::vec4(bounds.center, bounds.radius);
+                    instance.flags = archetype.materials[i].replacedByReflection ? rg::GpuDrivenScene::INSTANCE_REPLACED_BY_REFLECTION : 0u;
+                    instance.group = archetype.meshes[i].mesh;
+                    instances.push_back(instance);
+                    if(dynamic)
+                        gpuDynamicInstances.push_back({ &archetype.transforms[i].model, &bounds });
+                }
+            });
+        gpuScene->SetInstances(instances);
+        return;
+    }
+    for(size_t i = 0; i < gpuDynamicInstances.size(); i++){
+        rg::GpuDrivenScene::Instance& instance = gpuScene->InstanceAt(i);
+        const rg::BoundingSphere& bounds = *gpuDynamicInstances[i].bounds;
+        instance.model = *gpuDynamicInstances[i].model;
+        instance.sphere = glm::vec4(bounds.center, bounds.radius);
+    }
+    gpuScene->UploadInstances(0, gpuDynamicInstances.size());
+}
+
+// the texture binds of every mesh of the models in the mesh table, numbered like Mesh::Draw names the samplers
+void recordMeshCommands(SceneAssets& scene){
+    for(int i = 0; i < rg::STRESS_MODEL_COUNT; i++){
+        meshParts[i].clear();
+        for(const Mesh& mesh : scene.meshTable[i]->meshes){
+            meshParts[i].push_back(MeshPart());
+            MeshPart& part = meshParts[i].back();
+            part.mesh = &mesh;
+            unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+            for(unsigned int t = 0; t < mesh.textures.size(); t++){
+                const std::string& type = mesh.textures[t].type;
+                std::string number;
+                if(type == "texture_diffuse")
+                    number = std::to_string(diffuseNr++);
+                else if(type == "texture_specular")
+                    number = std::to_string(specularNr++);
+                else if(type == "texture_normal")
+                    number = std::to_string(normalNr++);
+                else if(type == "texture_height")
+                    number = std::to_string(heightNr++);
+                part.textures.SetInt(commandReplay.Uniform(mesh.glslIdentifierPrefix + type + number), (int)t);
+                part.textures.BindTexture(t, mesh.textures[t].id);
+            }
+        }
+    }
+}
+
+// the frustum planes and the camera of this frame in the space of `model`; the meshlet tests assume
+// a uniform scale, which every entity's model matrix has
+void makeMeshletView(const glm::mat4& model, MeshletView& view){
+    glm::mat4 transposed = glm::transpose(model);
+    for(int p = 0; p < 6; p++){
+        view.planes[p] = transposed * cullFrustum.planes[p];
+        view.planes[p] /= glm::length(glm::vec3(view.planes[p]));
+    }
+    view.camera = glm::vec3(glm::inverse(model) * glm::vec4(cullCameraPosition, 1.0f));
+    view.cones = !frame->faceculling;
+}
+
+// the whole mesh, or with a view the merged index ranges of its meshlets that pass the view's tests
+void recordMeshDraw(rg::CommandBuffer& commands, const Mesh& mesh, const MeshletView *view, RecordChunk& chunk){
+    if(!view || mesh.meshlets.count < 2){
+        commands.DrawElements(mesh.VAO, (uint32_t)mesh.indices.size());
+        return;
+    }
+    mesh.meshlets.Cull(view->planes, view->camera, view->cones, chunk.visibleRanges, chunk.meshlets);
+    for(const rg::MeshletSet::Range& range : chunk.visibleRanges)
+        commands.DrawElementRange(mesh.VAO, range.firstIndex, range.indexCount);
+}
+
+// records opaqueDraws [begin, end) into the chunk they belong to; a new mesh or material rebinds the
+// material textures like the batches of the immediate submission did. The textured recording also
+// writes the draws' DrawData slices.
+void recordDrawRows(void *data, uint32_t begin, uint32_t end){
+    DrawRecording& recording = *(DrawRecording *)data;
+    RecordChunk& chunk = recording.chunks[begin / RECORD_JOB_DRAWS];
+    rg::CommandBuffer& commands = chunk.commands;
+    commands.BindProgram(recording.program);
+    for(uint32_t i = begin; i < end; i++){
+        const OpaqueDraw& draw = opaqueDraws[i];
+        const rg::MaterialComponent& material = *draw.material;
+        if(recording.textures && (i == begin || draw.sortKey != opaqueDraws[i - 1].sortKey
+                                  || draw.material->diffuse != opaqueDraws[i - 1].material->diffuse
+                                  || draw.material->specular != opaqueDraws[i - 1].material->specular
+                                  || draw.material->normal != opaqueDraws[i - 1].material->normal)){
+            if(material.diffuse)
+                commands.BindTexture(0, material.diffuse);
+            if(material.specular)
+                commands.BindTexture(1, material.specular);
+            if(material.normal)
+                commands.BindTexture(2, material.normal);
+        }
+        uint32_t slice = drawDataSlices.entities + i;
+        if(recording.textures){
+            DrawData& drawData = *drawDataRing->Slice<DrawData>(slice);
+            drawData.model = *draw.model;
+            drawData.transparency = 1.0f;
+            drawData.hasNormalMap = material.normalMapped && frame->state.hasNormalMapping;
+            drawData.objectLightCount = -1;
+            drawData.instanced = 0;
+            if(recording.lightCuller){
+                int count = recording.lightCuller->Select(*draw.bounds, drawData.objectLights);
+                drawData.objectLightCount = count;
+                chunk.draws++;
+                if(count < 0)
+                    chunk.clusteredDraws++;
+                else
+                    chunk.assignedLights += count;
+            }
+        }
+        commands.BindUniformRange(DRAW_DATA_BINDING, drawDataRing->Buffer(), drawDataRing->Offset(slice), sizeof(DrawData));
+        // both passes over a draw test the same meshlets, so the pre-pass depth matches the colour pass
+        MeshletView view;
+        if(frame->state.meshletCulling)
+            makeMeshletView(*draw.model, view);
+        for(const MeshPart& part : meshParts[draw.mesh]){
+            if(recording.textures)
+                commands.Append(part.textures);
+            recordMeshDraw(commands, *part.mesh, frame->state.meshletCulling ? &view : nullptr, chunk);
+        }
+    }
+}
+
+// queues the recording of this frame's opaqueDraws for a pass drawn with `program`
+void startDrawRecording(DrawRecording& recording, GLuint program, bool textures, rg::ObjectLightCuller *lightCuller){
+    recording.program = program;
+    recording.textures = textures;
+    recording.lightCuller = lightCuller;
+    uint32_t drawCount = (uint32_t)opaqueDraws.size();
+    recording.chunkCount = (drawCount + RECORD_JOB_DRAWS - 1) / RECORD_JOB_DRAWS;
+    if(recording.chunks.size() < recording.chunkCount)
+        recording.chunks.resize(recording.chunkCount);
+    for(uint32_t i = 0; i < recording.chunkCount; i++){
+        RecordChunk& chunk = recording.chunks[i];
+        chunk.commands.Clear();
+        chunk.draws = chunk.clusteredDraws = chunk.assignedLights = 0;
+        chunk.meshlets = rg::MeshletSet::CullStats();
+    }
+    jobSystem->ParallelFor(drawCount, RECORD_JOB_DRAWS, recordDrawRows, &recording, recordJobs);
+}
+
+void replayDrawRecording(DrawRecording& recording){
+    {
+        RG_PROFILE_ZONE("Wait for draw recording");
+        jobSystem->Wait(recordJobs);
+    }
+    commandReplay.Reset();
+    for(uint32_t i = 0; i < recording.chunkCount; i++){
+        const RecordChunk& chunk = recording.chunks[i];
+        commandReplay.Run(chunk.commands);
+        if(recording.lightCuller)
+            recording.lightCuller->AddStatistics(chunk.draws, chunk.clusteredDraws, chunk.assignedLights);
+    }
+    commandReplay.Finish();
+}
+
+// the DrawData block of a material shader reads the slice bound to DRAW_DATA_BINDING
+void bindDrawDataBlock(const Shader& shader){
+    GLuint block = glGetUniformBlockIndex(shader.ID, "DrawData");
+    if(block != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader.ID, block, DRAW_DATA_BINDING);
+}
+
+// lays this frame's draws out in drawDataRing, after finishEntityCulling
+void beginDrawData(){
+    DrawDataSlices& slices = drawDataSlices;
+    slices.pipe = 0;
+    slices.floor = 1;
+    slices.entities = slices.floor + (frame->colorSky ? 0 : FLOOR_TILES);
+    slices.windows = slices.entities + (uint32_t)opaqueDraws.size();
+    slices.gpuModels = slices.windows + (uint32_t)transparentDraws.size();
+    slices.count = slices.gpuModels + (gpuDrivenFrame ? rg::STRESS_MODEL_COUNT : 0);
+    drawDataRing->BeginFrame(slices.count);
+}
+
+// fills one slice; without a light culler the draw uses the froxel lists
+void setDrawData(uint32_t slice, const glm::mat4& model, float transparency, bool hasNormalMap,
+                 rg::ObjectLightCuller *lightCuller, const rg::BoundingSphere& bounds, const vector<int>* candidates = nullptr){
+    DrawData& drawData = *drawDataRing->Slice<DrawData>(slice);
+    drawData.model = model;
+    drawData.transparency = transparency;
+    drawData.hasNormalMap = hasNormalMap;
+    drawData.objectLightCount = -1;
+    drawData.instanced = 0;
+    if(lightCuller){
+        int count = lightCuller->Select(bounds, drawData.objectLights, candidates);
+        drawData.objectLightCount = count;
+        lightCuller->AddStatistics(1, count < 0 ? 1 : 0, count < 0 ? 0 : count);
+    }
+}
+
+// the slices of the pipe, the floor tiles and the windows; the entities' are written by the recording jobs
+void writeFrameDrawData(SceneAssets& scene){
+    // the G-buffer pass does no lighting, the windows are always shaded forward
+    rg::ObjectLightCuller *lightCuller = frame->state.deferredShading ? nullptr : &objectLightCuller;
+    glm::mat4 model = pipeModelMatrix();
+    setDrawData(drawDataSlices.pipe, model, 1.0f, frame->state.hasNormalMapping, lightCuller,
+                rg::transformSphere(model, scene.pipeBounds));
+
+    if(!frame->colorSky){
+        float stranica = 2.0f;
+        glm::vec3 firstPosition = glm::vec3(-25.0f * stranica, -25.0f * stranica, 0.0f);
+        glm::mat4 floorRotation = glm::rotate(glm::mat4(1.0f), glm::radians(270.0f), glm::normalize(glm::vec3(1.0f,0.0f,0.0f)));
+        // lights are first culled against a whole row of tiles and then per tile against the row's lights
+        static vector<int> rowLights;
+        for(int i = 0; i < 50; i++) {
+            rowLights.clear();
+            if(lightCuller){
+                rg::BoundingSphere row;
+                row.center = firstPosition + glm::vec3(24.5f * stranica, (float)i * stranica, 0.0f);
+                row.radius = glm::sqrt(25.0f * 25.0f + 1.0f) * stranica;
+                lightCuller->Gather(rg::transformSphere(floorRotation, row), rowLights);
+            }
+            for(int j = 0; j < 50; j++){
+                model = glm::translate(floorRotation, firstPosition + glm::vec3((float)j * stranica,(float)i * stranica ,0.0f));
+                setDrawData(drawDataSlices.floor + i * 50 + j, model, 1.0f, frame->state.hasNormalMapping, lightCuller,
+                            rg::transformSphere(model, scene.quadBounds), &rowLights);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < transparentDraws.size(); i++)
+        setDrawData(drawDataSlices.windows + i, *transparentDraws[i].model, 0.5f, false, &objectLightCuller,
+                    *transparentDraws[i].bounds);
+
+    // one slice per model for the GPU-driven draws, the instances bring their matrix and use the froxel lists
+    if(gpuDrivenFrame)
+        for(uint32_t m = 0; m < rg::STRESS_MODEL_COUNT; m++){
+            DrawData& drawData = *drawDataRing->Slice<DrawData>(drawDataSlices.gpuModels + m);
+            drawData.model = glm::mat4(1.0f);
+            drawData.transparency = 1.0f;
+            drawData.hasNormalMap = meshPrototypes[m].material.normalMapped && frame->state.hasNormalMapping;
+            drawData.objectLightCount = -1;
+            drawData.instanced = 1;
+        }
+}
+
+void bindDrawData(uint32_t slice){
+    glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_DATA_BINDING, drawDataRing->Buffer(), drawDataRing->Offset(slice), sizeof(DrawData));
+}
+
+// the lamps are all aimed at the bear
+glm::vec3 spotlightDirection(const ProgramState& state, int i){
+    return glm::normalize(state.bearPosition - state.spotlightPositions[i]);
+}
+
+rg::LightData makeLightData(const PointLight& light){
+    rg::LightData data = {};
+    data.position = light.position;
+    data.type = rg::LIGHT_TYPE_POINT;
+    data.shadowTile = -1.0f;
+    data.ambient = light.ambient;
+    data.diffuse = light.diffuse;
+    data.specular = light.specular;
+    data.constant = (float)light.constant;
+    data.linear = (float)light.linear;
+    data.quadratic = (float)light.quadratic;
+    float maxChannel = glm::max(glm::max(light.diffuse.r, light.diffuse.g), light.diffuse.b);
+    data.range = rg::attenuationRange(data.constant, data.linear, data.quadratic, maxChannel);
+    return data;
+}
+
+rg::LightData makeLightData(const SpotLight& light, glm::vec3 position, glm::vec3 direction){
+    rg::LightData data = {};
+    data.position = position;
+    data.type = rg::LIGHT_TYPE_SPOT;
+    data.shadowTile = -1.0f;
+    data.direction = direction;
+    data.cutOff = light.cutOff;
+    data.outerCutOff = light.outerCutOff;
+    data.ambient = light.ambient;
+    data.diffuse = light.diffuse;
+    data.specular = light.specular;
+    data.constant = (float)light.constant;
+    data.linear = (float)light.linear;
+    data.quadratic = (float)light.quadratic;
+    float maxChannel = glm::max(glm::max(light.diffuse.r, light.diffuse.g), light.diffuse.b);
+    data.range = rg::attenuationRange(data.constant, data.linear, data.quadratic, maxChannel);
+    return data;
+}
+
+void collectSceneLights(ProgramState *programState, vector<rg::LightData> &lights){
+    lights.clear();
+
+    // the four lamps, all aimed at the bear
+    for(int i = 0; i < 4; i++){
+        if(!checkSpotlights[i])
+            continue;
+        rg::LightData light = makeLightData(programState->spotLight, programState->spotlightPositions[i], spotlightDirection(*programState, i));
+        light.shadowTile = (float)i;
+        lights.push_back(light);
+    }
+
+    if(programState->pointLightEnabled)
+        lights.push_back(makeLightData(programState->pointLight));
+
+    sceneEntities.ForEach(rg::COMPONENT_LIGHT, [&lights](rg::Archetype& archetype){
+        for(const rg::LightComponent& light : archetype.lights)
+            lights.push_back(light.light);
+    });
+
+    // extra small coloured lights on a golden angle spiral around the platform
+    for(int i = 0; i < programState->extraLightCount; i++){
+        PointLight extra;
+        float angle = 2.39996f * (float)i;
+        float radius = 3.0f + 1.2f * glm::sqrt((float)i);
+        extra.position = glm::vec3(radius * glm::cos(angle), 0.5f + 0.25f * (float)(i % 4), radius * glm::sin(angle));
+        glm::vec3 color(0.5f + 0.5f * glm::cos(angle), 0.5f + 0.5f * glm::cos(angle + 2.09f), 0.5f + 0.5f * glm::cos(angle + 4.19f));
+        extra.ambient = glm::vec3(0.0f);
+        extra.diffuse = color * 0.8f;
+        extra.specular = color;
+        extra.constant = 1.0f;
+        extra.linear = 0.35f;
+        extra.quadratic = 0.44f;
+        lights.push_back(makeLightData(extra));
+    }
+}
+
+// the snapshot's vectors keep their capacity, after the first frames taking one does not allocate
+void takeFrameSnapshot(FrameSnapshot& snapshot, float currentFrame){
+    snapshot.time = currentFrame;
+    snapshot.state = *programState;
+    std::copy(checkSpotlights, checkSpotlights + 4, snapshot.spotlights);
+    snapshot.faceculling = faceculling;
+    snapshot.blinn = blinn;
+    snapshot.antialiasing = antialiasing;
+    snapshot.colorSky = colorSky;
+    snapshot.framebufferWidth = framebufferWidth;
+    snapshot.framebufferHeight = framebufferHeight;
+    snapshot.projection = glm::perspective(glm::radians(programState->camera.Zoom),
+                                           (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
+    snapshot.view = programState->camera.GetViewMatrix();
+    snapshot.nodeWorlds.resize(sceneTransforms.Size());
+    for(int i = 0; i < sceneTransforms.Size(); i++)
+        snapshot.nodeWorlds[i] = sceneTransforms.World(i);
+    collectSceneLights(programState, snapshot.lights);
 }
 
 unsigned int quadVAO = 0;
@@ -0,0 +1,80 @@
+// Headless checks of rg::OcclusionBuffer (run by ctest): a camera standing on the floor and looking at
+// the horizon must see the floor as an occluder, although both of its triangles cross the near plane.
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <rg/SoftwareOcclusion.h>
+
+#include <iostream>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::cout << "ERROR::OCCLUSION_TEST:: " << what << std::endl;
+        failures++;
+    }
+}
+
+rg::BoundingSphere sphere(glm::vec3 center, float radius) {
+    rg::BoundingSphere bounds;
+    bounds.center = center;
+    bounds.radius = radius;
+    return bounds;
+}
+
+// the floor quad of the scene, as buildSceneTransforms places it
+glm::mat4 floorMatrix() {
+    float stranica = 2.0f;
+    glm::mat4 floor = glm::mat4(1.0f);
+    floor = glm::rotate(floor, glm::radians(270.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 0.0f)));
+    floor = glm::translate(floor, glm::vec3(-0.5f * stranica, -0.5f * stranica, 0.0f));
+    floor = glm::scale(floor, glm::vec3(25.0f * stranica, 25.0f * stranica, 1.0f));
+    return floor;
+}
+
+rg::OccluderMesh floorOccluder() {
+    rg::OccluderMesh mesh;
+    mesh.positions = {
+            glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f),
+            glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f)
+    };
+    return mesh;
+}
+
+void floorOccludesAtTheHorizon(rg::JobSystem& jobs) {
+    glm::vec3 eye(0.0f, 1.7f, 0.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    rg::OcclusionBuffer buffer;
+    buffer.Begin(projection * view, 1920, 1080);
+    buffer.AddOccluder(floorOccluder(), floorMatrix());
+    buffer.Rasterize(jobs);
+
+    check(buffer.triangles > 0, "the floor crossing the near plane was not rasterized");
+    check(!buffer.Visible(sphere(glm::vec3(0.0f, -3.0f, -15.0f), 1.0f)), "a model below the floor is visible");
+    check(!buffer.Visible(sphere(glm::vec3(6.0f, -3.0f, -20.0f), 1.0f)), "a model below the floor off to the side is visible");
+    check(buffer.Visible(sphere(glm::vec3(0.0f, 1.0f, -15.0f), 1.0f)), "a model standing on the floor is hidden");
+    check(buffer.Visible(sphere(glm::vec3(0.0f, -0.5f, -15.0f), 1.0f)), "a model reaching through the floor is hidden");
+}
+
+void nothingOccludesWithoutOccluders(rg::JobSystem& jobs) {
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    rg::OcclusionBuffer buffer;
+    buffer.Begin(projection, 512, 512);
+    buffer.Rasterize(jobs);
+    check(buffer.Visible(sphere(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f)), "a model is hidden by an empty buffer");
+}
+
+}
+
+int main() {
+    rg::JobSystem jobs(4);
+    floorOccludesAtTheHorizon(jobs);
+    nothingOccludesWithoutOccluders(jobs);
+    if (failures == 0)
+        std::cout << "occlusion_test: all checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}